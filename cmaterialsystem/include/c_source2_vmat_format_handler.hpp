@@ -16,6 +16,7 @@ namespace msys {
 	  protected:
 		virtual bool ImportTexture(const std::string &fpath, const std::string &outputPath) override;
 		virtual bool InitializeVMatData(::source2::resource::Resource &resource, ::source2::resource::Material &vmat, ds::Block &rootData, ds::Settings &settings, const std::string &shader, VMatOrigin origin) override;
+		virtual std::string GetConverterName() const override { return "cvmat"; }
 	};
 };
 
@@ -18,6 +18,7 @@ namespace msys {
 		CSourceVmtFormatHandler(util::IAssetManager &assetManager);
 	  protected:
 		virtual bool LoadVMTData(VTFLib::CVMTFile &vmt, const std::string &vmtShader, ds::Block &rootData, std::string &matShader) override;
+		virtual std::string GetConverterName() const override { return "cvmt"; }
 	};
 #ifdef ENABLE_VKV_PARSER
 	class DLLCMATSYS CSourceVmtFormatHandler2 : public SourceVmtFormatHandler2 {
@@ -25,6 +26,7 @@ namespace msys {
 		CSourceVmtFormatHandler2(util::IAssetManager &assetManager);
 	  protected:
 		virtual bool LoadVMTData(ValveKeyValueFormat::KVNode &vmt, const std::string &vmtShader, ds::Block &rootData, std::string &matShader) override;
+		virtual std::string GetConverterName() const override { return "cvmt_kv"; }
 	};
 #endif
 };
@@ -50,7 +50,9 @@ class DLLCMATSYS CMaterial : public Material {
 	void SetTexture(const std::string &identifier, const std::string &texture);
 	void SetTexture(const std::string &identifier, prosper::Texture &texture);
 	const std::shared_ptr<prosper::IDescriptorSetGroup> &GetDescriptorSetGroup(prosper::Shader &shader) const;
+	using Material::GetTextureInfo;
 	virtual TextureInfo *GetTextureInfo(const std::string &key) override;
+	virtual TextureInfo *GetTextureInfo(msys::KeyAtom key) override;
 	bool IsInitialized() const;
 	virtual std::shared_ptr<Material> Copy() const override;
 	void SetDescriptorSetGroup(prosper::Shader &shader, const std::shared_ptr<prosper::IDescriptorSetGroup> &descSetGroup);
@@ -76,6 +78,10 @@ class DLLCMATSYS CMaterial : public Material {
 	CMaterial(msys::MaterialManager &manager, const std::string &shader, const std::shared_ptr<ds::Block> &data);
 	virtual void Initialize(const std::shared_ptr<ds::Block> &data) override;
 	virtual void OnTexturesUpdated() override;
+	virtual uint64_t ComputeTextureSetHash() const override;
+	virtual msys::RenderFeatureFlags ComputeRenderFeatureFlags() const override;
+	virtual bool CanAssignChanges(const Material &other) const override;
+	virtual void OnChangesAssigned(ChangeFlags changes) override;
 	void LoadTexture(const std::shared_ptr<ds::Block> &data, TextureInfo &texInfo, TextureLoadFlags flags = TextureLoadFlags::None, const std::shared_ptr<CallbackInfo> &callbackInfo = nullptr);
 	void ClearDescriptorSets();
 	void InitializeTextures(const std::shared_ptr<ds::Block> &data, const std::function<void(void)> &onAllTexturesLoaded = nullptr, const std::function<void(std::shared_ptr<Texture>)> &onTextureLoaded = nullptr, TextureLoadFlags loadFlags = TextureLoadFlags::None);
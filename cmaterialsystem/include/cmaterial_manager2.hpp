@@ -7,6 +7,8 @@
 
 #include "cmatsysdefinitions.h"
 #include <material_manager2.hpp>
+#include "texturemanager/texture_manager2.hpp"
+#include "material_load_handle.hpp"
 
 namespace prosper {
 	class IPrContext;
@@ -29,7 +31,35 @@ namespace msys {
 		prosper::IPrContext &GetContext() { return m_context; }
 		msys::TextureManager &GetTextureManager() { return *m_textureManager; }
 		virtual void Poll() override;
+		// Same as Poll, but the GPU resources of the loaded textures are only created until the budget has been used up,
+		// the remaining textures are carried over to the next poll (see TextureManager::Poll(const FinalizationBudget&)).
+		FinalizationStats Poll(const FinalizationBudget &budget);
+
+		// Loads the material and all textures it references in parallel. The returned handle (and onComplete) completes once
+		// every texture has been uploaded or has failed to load, see MaterialLoadHandle.
+		std::shared_ptr<MaterialLoadHandle> LoadMaterialAndTextures(const std::string &path, const MaterialLoadHandle::OnComplete &onComplete = nullptr);
+
+		// Textures that are generated from other textures by the importers (e.g. normal maps converted from self-shadowing bump maps)
+		// are tracked in the import cache, keyed by the contents of the source textures and the converter. This way they only have to
+		// be generated once and can be shared by all materials that use the same sources.
+		// The converter name has to include every other input that affects the output (e.g. flags or target resolutions).
+		// Returns std::nullopt if one of the source textures can't be found.
+		std::optional<uint64_t> GetDerivedTextureKey(const std::vector<std::string> &sourceTextures, const std::string &converter);
+		// Name of a texture that is generated for the key. Derived textures are named after the key rather than their sources, so
+		// textures that were generated from different sources (or with different settings) can never overwrite each other.
+		static std::string GetDerivedTextureName(uint64_t key, const std::string &suffix);
+		// Returns the names of the textures that were generated for the key, if all of them still exist
+		std::optional<std::vector<std::string>> FindDerivedTextures(uint64_t key) const;
+		// Returns false if one of the generated texture files couldn't be read
+		bool StoreDerivedTextures(uint64_t key, const std::vector<std::string> &textures);
+		// Path of a generated (DDS) texture, relative to the program directory
+		std::string GetDerivedTextureFilePath(const std::string &texture);
+	  protected:
+		virtual void OnImageFileChanged(const FileWatcher::Change &change, const std::string &identifier) override;
 	  private:
+		void ReloadQueuedShaders();
+		void UpdateMaterialLoadHandles();
+		std::vector<std::shared_ptr<MaterialLoadHandle>> m_materialLoadHandles;
 		CMaterialManager(prosper::IPrContext &context);
 		virtual void InitializeImportHandlers() override;
 		std::function<void(Material *)> m_shaderHandler;
@@ -0,0 +1,74 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef __MSYS_MATERIAL_LOAD_HANDLE_HPP__
+#define __MSYS_MATERIAL_LOAD_HANDLE_HPP__
+
+#include "cmatsysdefinitions.h"
+#include <material.h>
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace msys {
+	class CMaterialManager;
+	class MaterialLoadBatch;
+	// Tracks the load of a material including all of the textures it references, see CMaterialManager::LoadMaterialAndTextures.
+	// The material file is parsed on a worker thread, the texture jobs are queued as soon as the material is available and
+	// the handle is done once every texture has been uploaded to the GPU (or has failed to load).
+	// The handle is updated by CMaterialManager::Poll, all state changes and callbacks happen on the thread that polls the manager.
+#pragma warning(push)
+#pragma warning(disable : 4251)
+	class DLLCMATSYS MaterialLoadHandle {
+	  public:
+		enum class State : uint8_t { LoadingMaterial = 0, LoadingTextures, Complete, Failed };
+		enum class TextureState : uint8_t { Pending = 0, Loaded, Failed };
+		struct DLLCMATSYS TextureStatus {
+			std::string name;
+			TextureState state = TextureState::Pending;
+		};
+		using OnComplete = std::function<void(MaterialLoadHandle &)>;
+
+		State GetState() const { return m_state; }
+		// Returns true if the handle is either complete or has failed
+		bool IsDone() const { return m_state == State::Complete || m_state == State::Failed; }
+		const std::string &GetPath() const { return m_path; }
+		// Only available once the material itself has been loaded
+		const std::shared_ptr<Material> &GetMaterial() const { return m_material; }
+		const std::vector<TextureStatus> &GetTextures() const { return m_textures; }
+		uint32_t GetLoadedTextureCount() const { return m_numLoadedTextures; }
+		uint32_t GetFailedTextureCount() const { return m_numFailedTextures; }
+
+		// Resolves to the material once the handle is complete, or to nullptr if the material could not be loaded.
+		// Since the handle is only updated when the manager is polled, the future must not be waited on from the polling thread (use Wait instead).
+		const std::shared_future<std::shared_ptr<Material>> &GetFuture() const { return m_future; }
+		// Polls the manager until the handle is done
+		void Wait();
+	  private:
+		friend CMaterialManager;
+		MaterialLoadHandle(CMaterialManager &manager, const std::string &path, const std::shared_ptr<MaterialLoadBatch> &batch, const OnComplete &onComplete);
+		// Returns true once the handle is done
+		bool Update();
+		void BeginTextureLoads();
+		void UpdateTextureStates();
+		void SetDone(State state);
+
+		CMaterialManager &m_manager;
+		std::string m_path;
+		std::shared_ptr<MaterialLoadBatch> m_batch;
+		OnComplete m_onComplete;
+		State m_state = State::LoadingMaterial;
+		std::shared_ptr<Material> m_material;
+		std::vector<TextureStatus> m_textures;
+		uint32_t m_numLoadedTextures = 0;
+		uint32_t m_numFailedTextures = 0;
+		std::promise<std::shared_ptr<Material>> m_promise;
+		std::shared_future<std::shared_ptr<Material>> m_future;
+	};
+#pragma warning(pop)
+};
+
+#endif
@@ -15,7 +15,10 @@ namespace msys {
 		virtual bool GetDataPtr(uint32_t layer, uint32_t mipmapIdx, void **outPtr, size_t &outSize) override;
 	  protected:
 		virtual bool LoadData(InputTextureInfo &texInfo) override;
+		virtual void ClearData() override { m_texture = {}; }
 	  private:
+		// Reads the image data directly, using the cached header information
+		bool LoadDataFromCachedHeader(InputTextureInfo &texInfo);
 		gli::texture m_texture;
 	};
 };
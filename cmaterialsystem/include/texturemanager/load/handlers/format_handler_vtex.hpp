@@ -18,6 +18,11 @@ namespace msys {
 		virtual bool GetDataPtr(uint32_t layer, uint32_t mipmapIdx, void **outPtr, size_t &outSize) override;
 	  protected:
 		virtual bool LoadData(InputTextureInfo &texInfo) override;
+		virtual void ClearData() override
+		{
+			m_texture = nullptr;
+			m_mipmapData = {};
+		}
 	  private:
 		std::shared_ptr<source2::resource::Texture> m_texture = nullptr;
 		std::vector<uint8_t> m_mipmapData;
@@ -33,6 +33,7 @@ namespace msys {
 		virtual bool GetDataPtr(uint32_t layer, uint32_t mipmapIdx, void **outPtr, size_t &outSize) override;
 	  protected:
 		virtual bool LoadData(InputTextureInfo &texInfo) override;
+		virtual void ClearData() override { m_texture = nullptr; }
 	  private:
 		std::shared_ptr<VTFLib::CVTFFile> m_texture = nullptr;
 	};
@@ -27,15 +27,25 @@ namespace msys {
 			std::array<prosper::ComponentSwizzle, 4> swizzle = {prosper::ComponentSwizzle::R, prosper::ComponentSwizzle::G, prosper::ComponentSwizzle::B, prosper::ComponentSwizzle::A};
 
 			std::optional<prosper::Format> conversionFormat {};
+			// Offset of the image data in the file, if the data of all layers and mipmaps follows the header as one contiguous block (0 otherwise)
+			uint64_t dataOffset = 0;
 		};
 
 		bool LoadData();
+		// Releases the file and all data that has been decoded so far (e.g. if the load job has been cancelled)
+		void ReleaseData();
 		virtual bool GetDataPtr(uint32_t layer, uint32_t mipmapIdx, void **outPtr, size_t &outSize) = 0;
 		const InputTextureInfo &GetInputTextureInfo() const { return m_inputTextureInfo; }
+		// Header information from a previous load of the same file (see msys::ImageMetadataCache), which handlers may use
+		// to skip parsing the header. Handlers have to verify that it still matches the file.
+		void SetCachedInputTextureInfo(const InputTextureInfo &texInfo) { m_cachedInputTextureInfo = texInfo; }
 	  protected:
 		ITextureFormatHandler(util::IAssetManager &assetManager);
 		virtual bool LoadData(InputTextureInfo &texInfo) = 0;
+		// Releases the decoded data of the handler. Handlers that don't keep any data beyond the file don't need to implement this.
+		virtual void ClearData() {}
 		InputTextureInfo m_inputTextureInfo;
+		std::optional<InputTextureInfo> m_cachedInputTextureInfo {};
 	};
 };
 REGISTER_BASIC_BITWISE_OPERATORS(msys::ITextureFormatHandler::InputTextureInfo::Flags)
@@ -35,12 +35,18 @@ namespace msys {
 		TextureLoader(util::IAssetManager &assetManager, prosper::IPrContext &context);
 		void SetAllowMultiThreadedGpuResourceAllocation(bool b) { m_allowMultiThreadedGpuResourceAllocation = b; }
 		bool DoesAllowMultiThreadedGpuResourceAllocation() const { return m_allowMultiThreadedGpuResourceAllocation; }
+		// If enabled, processors skip the creation of the GPU resources in Finalize, which is then carried out by the texture manager (see TextureManager::Poll(const FinalizationBudget&))
+		void SetDeferFinalization(bool defer) { m_deferFinalization = defer; }
+		bool ShouldDeferFinalization() const { return m_deferFinalization; }
 		prosper::IPrContext &GetContext() { return m_context; }
 
 		const std::shared_ptr<prosper::ISampler> &GetTextureSampler() const { return m_textureSampler; }
 		const std::shared_ptr<prosper::ISampler> &GetTextureSamplerNoMipmap() const { return m_textureSamplerNoMipmap; }
+	  protected:
+		virtual std::unique_ptr<util::IAssetProcessor> CreateAssetProcessor(const std::string &identifier, const std::string &ext, std::unique_ptr<util::IAssetFormatHandler> &&formatHandler) override;
 	  private:
 		bool m_allowMultiThreadedGpuResourceAllocation = true;
+		bool m_deferFinalization = false;
 		prosper::IPrContext &m_context;
 
 		std::shared_ptr<prosper::ISampler> m_textureSampler;
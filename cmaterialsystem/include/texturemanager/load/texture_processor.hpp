@@ -7,6 +7,7 @@
 
 #include "cmatsysdefinitions.h"
 #include "texture_type.h"
+#include "asset_load_queue.hpp"
 #include "texturemanager/load/texture_format_handler.hpp"
 #include <sharedutils/asset_loader/file_asset_processor.hpp>
 #include <prosper_enums.hpp>
@@ -14,6 +15,7 @@
 #include <optional>
 #include <functional>
 #include <memory>
+#include <string>
 
 namespace prosper {
 	class IBuffer;
@@ -54,6 +56,15 @@ namespace msys {
 
 		bool PrepareImage(prosper::IPrContext &context);
 		bool FinalizeImage(prosper::IPrContext &context);
+		// Releases the images, buffers and decoded data that have been created so far
+		void ReleaseData();
+		// Creates the GPU resources, this is what Finalize does unless the finalization has been deferred
+		bool FinalizeResources();
+		bool IsFinalizationDeferred() const { return m_finalizationDeferred; }
+		// Moves the decoded data into a new processor, which can outlive the load job, so FinalizeResources can be called at a later point
+		std::unique_ptr<TextureProcessor> CreateDeferredProcessor();
+		// Size of the decoded image data of all layers and mipmaps, in bytes. Only valid once the data has been loaded.
+		uint64_t GetDataSize() const { return m_dataSize; }
 
 		TextureMipmapMode mipmapMode = TextureMipmapMode::LoadOrGenerate;
 		std::shared_ptr<prosper::IImage> image;
@@ -64,11 +75,19 @@ namespace msys {
 		std::optional<prosper::Format> targetGpuConversionFormat {};
 		std::function<void(const void *, std::shared_ptr<uimg::ImageBuffer> &, uint32_t, uint32_t)> cpuImageConverter = nullptr;
 		std::vector<BufferInfo> buffers {};
+		std::string identifier;
+		std::string formatExtension;
+		// Set if the job has been cancelled through the texture manager, which is checked in between the load stages
+		AssetLoadCancellationToken cancellationToken;
 	  private:
+		bool CheckCancelled();
 		TextureLoader &GetLoader();
 		ITextureFormatHandler &GetHandler();
+		uint64_t ComputeDataSize();
 
 		bool m_generateMipmaps = false;
+		bool m_finalizationDeferred = false;
+		uint64_t m_dataSize = 0;
 		std::vector<std::shared_ptr<uimg::ImageBuffer>> m_tmpImgBuffers {};
 	};
 };
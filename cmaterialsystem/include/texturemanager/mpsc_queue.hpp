@@ -0,0 +1,66 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef __MSYS_MPSC_QUEUE_HPP__
+#define __MSYS_MPSC_QUEUE_HPP__
+
+#include <atomic>
+#include <utility>
+
+namespace msys {
+	// Unbounded lock-free queue for any number of producer threads and a single consumer thread (D. Vyukov's node-based MPSC queue).
+	// Push is wait-free, Pop never blocks. Items pushed by the same thread are popped in the order they were pushed.
+	// Note: An item whose Push is still in progress on another thread may not be visible to Pop yet, even if items that
+	// were pushed after it already are. It will be returned by a later call.
+	template<typename T>
+	class MpscQueue {
+	  public:
+		MpscQueue() : m_head {new Node {}}, m_tail {m_head.load(std::memory_order_relaxed)} {}
+		MpscQueue(const MpscQueue &) = delete;
+		MpscQueue &operator=(const MpscQueue &) = delete;
+		~MpscQueue()
+		{
+			T item;
+			while(Pop(item))
+				;
+			delete m_tail;
+		}
+
+		// May be called from any thread
+		void Push(T item)
+		{
+			auto *node = new Node {};
+			node->value = std::move(item);
+			auto *prev = m_head.exchange(node, std::memory_order_acq_rel);
+			prev->next.store(node, std::memory_order_release);
+		}
+		// Consumer thread only
+		bool Pop(T &outItem)
+		{
+			auto *tail = m_tail;
+			auto *next = tail->next.load(std::memory_order_acquire);
+			if(next == nullptr)
+				return false;
+			// The popped node becomes the new stub node
+			outItem = std::move(next->value);
+			next->value = T {};
+			m_tail = next;
+			delete tail;
+			return true;
+		}
+		// Consumer thread only
+		bool IsEmpty() const { return m_tail->next.load(std::memory_order_acquire) == nullptr; }
+	  private:
+		struct Node {
+			std::atomic<Node *> next = nullptr;
+			T value {};
+		};
+		// Last pushed node, shared by all producers
+		std::atomic<Node *> m_head;
+		// Stub node preceding the next item, only accessed by the consumer
+		Node *m_tail;
+	};
+};
+
+#endif
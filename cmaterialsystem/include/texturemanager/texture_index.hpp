@@ -0,0 +1,67 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef __MSYS_TEXTURE_INDEX_HPP__
+#define __MSYS_TEXTURE_INDEX_HPP__
+
+#include <materialmanager.h>
+#include <fsys/filesystem.h>
+#include <sharedutils/util_file.h>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace msys {
+	// Maps texture names to positions in a texture list, by name and by normalized path without extension.
+	// If multiple textures share a name, the first one that was added is kept, same as with a linear search.
+	class TextureIndex {
+	  public:
+		// Two names map to the same key if FileManager::ComparePath considers them equal after their image extensions have been removed
+		static std::string GetPathKey(std::string name)
+		{
+			ufile::remove_extension_from_filename(name, GetSupportedExtensions());
+			return FileManager::GetNormalizedPath(name);
+		}
+
+		void Add(const std::string &name, size_t idx)
+		{
+			// emplace doesn't replace existing entries
+			m_nameIndex.emplace(name, idx);
+			m_pathIndex.emplace(GetPathKey(name), idx);
+		}
+		std::optional<size_t> Find(const std::string &name) const
+		{
+			auto it = m_nameIndex.find(name);
+			return (it != m_nameIndex.end()) ? it->second : std::optional<size_t> {};
+		}
+		std::optional<size_t> FindByPath(const std::string &path) const
+		{
+			auto it = m_pathIndex.find(GetPathKey(path));
+			return (it != m_pathIndex.end()) ? it->second : std::optional<size_t> {};
+		}
+		void Clear()
+		{
+			m_nameIndex.clear();
+			m_pathIndex.clear();
+		}
+	  private:
+		static const std::vector<std::string> &GetSupportedExtensions()
+		{
+			static auto supportedExtensions = []() {
+				std::vector<std::string> extensions;
+				auto &supportedFormats = MaterialManager::get_supported_image_formats();
+				extensions.reserve(supportedFormats.size());
+				for(auto &format : supportedFormats)
+					extensions.push_back(format.extension);
+				return extensions;
+			}();
+			return supportedExtensions;
+		}
+		std::unordered_map<std::string, size_t> m_nameIndex;
+		std::unordered_map<std::string, size_t> m_pathIndex;
+	};
+};
+
+#endif
@@ -12,7 +12,13 @@
 #include <sharedutils/asset_loader/file_asset_manager.hpp>
 #include <sharedutils/asset_loader/asset_load_info.hpp>
 #include <sharedutils/util_path.hpp>
+#include <asset_load_queue.hpp>
 #include <unordered_set>
+#include <optional>
+#include <chrono>
+#include <deque>
+#include <vector>
+#include <limits>
 
 class Texture;
 namespace prosper {
@@ -36,7 +42,22 @@ namespace msys {
 		TextureMipmapMode mipmapMode;
 	};
 	class TextureLoader;
+	class TextureProcessor;
 	class ITextureFormatHandler;
+	class AssetLoadManifest;
+	// Limits for the amount of GPU work (image creation and uploads) that is carried out per poll. At least one texture is always finalized.
+	struct DLLCMATSYS FinalizationBudget {
+		std::optional<std::chrono::nanoseconds> time {};
+		// Size of the image data that is uploaded
+		std::optional<uint64_t> bytes {};
+	};
+	struct DLLCMATSYS FinalizationStats {
+		uint32_t finalizedCount = 0;
+		uint64_t finalizedBytes = 0;
+		// Work that has been carried over to the next poll
+		uint32_t pendingCount = 0;
+		uint64_t pendingBytes = 0;
+	};
 	class DLLCMATSYS TextureManager : public util::TFileAssetManager<Texture, TextureLoadInfo> {
 	  public:
 		using AssetType = Texture;
@@ -47,13 +68,71 @@ namespace msys {
 		std::shared_ptr<Texture> GetErrorTexture();
 		void SetErrorTexture(const std::shared_ptr<Texture> &tex);
 
+		// While a recorder is set, every texture that is loaded through the manager is added to it, including its mipmap mode (see AssetLoadManifest).
+		// Reloads (util::AssetLoadFlags::DontCache) are not recorded.
+		void SetLoadRecorder(const std::shared_ptr<AssetLoadManifest> &recorder) { m_loadRecorder = recorder; }
+		const std::shared_ptr<AssetLoadManifest> &GetLoadRecorder() const { return m_loadRecorder; }
+		// Queues all textures of the manifest that haven't been loaded yet (see QueueAsset), with priorities that decrease in the order
+		// in which they have been recorded, starting at the number of entries. The requests are handed to the loader by DispatchQueuedAssets.
+		// Returns the number of textures that have been queued.
+		uint32_t PreloadManifest(const AssetLoadManifest &manifest);
+
+		// Adds a load request to the queue of the manager (see AssetLoadQueue). Unlike PreloadAsset, the request is only handed to the loader
+		// once it is dispatched (see DispatchQueuedAssets), so its priority can still be changed in the meantime.
+		void QueueAsset(const std::string &path, AssetLoadQueue::Priority priority = 0, std::unique_ptr<TextureLoadInfo> &&loadInfo = nullptr);
+		// Returns false if there is no queued request for the texture
+		bool SetAssetLoadPriority(const std::string &path, AssetLoadQueue::Priority priority);
+		// Drops the queued request for the texture, or aborts its load job if it has already been dispatched, in which case all data that has been
+		// decoded for it so far is released. Returns false if there was nothing to cancel.
+		bool CancelAssetLoad(const std::string &path);
+		// Hands up to maxCount of the queued requests with the highest priorities to the loader. Returns the number of requests that have been dispatched.
+		uint32_t DispatchQueuedAssets(uint32_t maxCount = std::numeric_limits<uint32_t>::max());
+		size_t GetQueuedAssetCount() const { return m_loadQueue.GetSize(); }
+		// Returns true if the texture is queued, or its load job has been dispatched and hasn't completed yet
+		bool IsAssetLoadPending(const std::string &path) const;
+
+		// Reloads a texture that has already been loaded without blocking. Once the new image has been loaded, it replaces the GPU texture of the
+		// existing texture object (see Texture::SetVkTexture), so everything that refers to the texture picks up the change.
+		// Returns false if the texture hasn't been loaded.
+		bool ReloadAssetAsync(const std::string &path);
+
+		// Textures that have been loaded by a budgeted poll are cached immediately, but are not marked as loaded (see Texture::IsLoaded)
+		// and have no GPU texture until they have been finalized. The remaining textures are finalized by subsequent polls.
+		using util::TFileAssetManager<Texture, TextureLoadInfo>::Poll;
+		FinalizationStats Poll(const FinalizationBudget &budget);
+		// Finalizes all textures that have been carried over by budgeted polls
+		virtual void Poll() override;
+		uint32_t GetPendingFinalizationCount() const { return static_cast<uint32_t>(m_pendingFinalizations.size()); }
+		uint64_t GetPendingFinalizationBytes() const { return m_pendingFinalizationBytes; }
+
 		void Test();
 	  protected:
 		virtual void InitializeProcessor(util::IAssetProcessor &processor) override;
 		virtual util::AssetObject InitializeAsset(const util::Asset &asset, const util::AssetLoadJob &job) override;
+		FinalizationStats FinalizePending(const FinalizationBudget &budget);
+		void FinalizeTexture(Texture &texture, TextureProcessor &processor);
+		struct PendingFinalization {
+			std::weak_ptr<Texture> texture;
+			std::unique_ptr<TextureProcessor> processor;
+			uint64_t byteSize = 0;
+		};
+		std::deque<PendingFinalization> m_pendingFinalizations;
+		uint64_t m_pendingFinalizationBytes = 0;
+
+		void ApplyPendingReloads();
+		struct PendingReload {
+			std::weak_ptr<Texture> texture;
+			std::shared_ptr<Texture> newTexture;
+		};
+		std::vector<PendingReload> m_pendingReloads;
 
 		prosper::IPrContext &m_context;
 		std::shared_ptr<Texture> m_error;
+		std::shared_ptr<AssetLoadManifest> m_loadRecorder;
+		AssetLoadQueue m_loadQueue;
+		// Jobs that have been cancelled after they were dispatched. Their failed results have to be cleared before they can be requested again.
+		std::unordered_set<std::string> m_cancelledLoads;
+		void ClearCancelledLoads();
 	};
 };
 
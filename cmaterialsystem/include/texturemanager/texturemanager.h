@@ -14,10 +14,13 @@
 #include <queue>
 #include <atomic>
 #include <condition_variable>
+#include <chrono>
 #include <fsys/filesystem.h>
 #include "cmatsysdefinitions.h"
 #include "texture.h"
 #include "texture_load_flags.hpp"
+#include "mpsc_queue.hpp"
+#include "texture_index.hpp"
 #include <sharedutils/functioncallback.h>
 
 namespace prosper {
@@ -48,7 +51,11 @@ class DLLCMATSYS TextureManager {
 	TextureManager(prosper::IPrContext &context);
 	~TextureManager();
 	prosper::IPrContext &GetContext() const;
-	void Update();
+	// Creates the images of all textures that have been decoded by the load threads in the meantime (within the limits of the update budget).
+	// Returns the number of textures that have been finalized.
+	uint32_t Update();
+	// Limits the work per Update call, 0 = unlimited. At least one texture is finalized per call, the remaining ones are left for the next call.
+	void SetUpdateBudget(uint32_t maxTextures, std::chrono::microseconds maxTime = std::chrono::microseconds {0});
 	void RegisterCustomSampler(const std::shared_ptr<prosper::ISampler> &sampler);
 	const std::vector<std::weak_ptr<prosper::ISampler>> &GetCustomSamplers() const;
 	std::shared_ptr<Texture> GetErrorTexture();
@@ -58,9 +65,15 @@ class DLLCMATSYS TextureManager {
 	void SetErrorTexture(const std::shared_ptr<Texture> &tex);
 	std::shared_ptr<Texture> CreateTexture(const std::string &name, prosper::Texture &texture);
 	//std::shared_ptr<Texture> CreateTexture(prosper::Context &context,const std::string &name,unsigned int w,unsigned int h);
+	// The handler is called by the load threads as well as the main thread, but never concurrently (calls are serialized by the manager).
+	// It should return quickly, since the load threads have to wait for each other while it's being called.
 	void SetTextureFileHandler(const std::function<VFilePtr(const std::string &)> &fileHandler);
 
 	void WaitForTextures();
+	// Number of threads that decode textures in the background, 0 = number of hardware threads.
+	// If the threads are already running, they're restarted with the new count. Queued textures are kept.
+	void SetLoadThreadCount(uint32_t count);
+	uint32_t GetLoadThreadCount() const;
 	bool Load(prosper::IPrContext &context, const std::string &cacheName, VFilePtr f, const LoadInfo &loadInfo, std::shared_ptr<void> *outTexture = nullptr);
 	bool Load(prosper::IPrContext &context, const std::string &imgFile, const LoadInfo &loadInfo, std::shared_ptr<void> *outTexture = nullptr, bool bAbsolutePath = false);
 	void ReloadTextures(const LoadInfo &loadInfo);
@@ -76,32 +89,45 @@ class DLLCMATSYS TextureManager {
 	bool HasWork();
 	std::weak_ptr<prosper::IPrContext> m_wpContext;
 	std::vector<std::shared_ptr<Texture>> m_textures;
-	std::atomic<bool> m_bBusy = false;
-	std::unique_ptr<std::thread> m_threadLoad;
-	std::unique_ptr<std::mutex> m_queueMutex;
-	std::unique_ptr<std::mutex> m_lockMutex;
-	std::unique_ptr<std::mutex> m_activeMutex;
+	// Indexes into m_textures, by name (FindTexture, CreateTexture) and by normalized path without extension (GetTexture).
+	// The names of managed textures must not be changed.
+	msys::TextureIndex m_textureIndex;
+	// Number of load threads that are currently decoding an item
+	std::atomic<uint32_t> m_numBusyThreads = 0;
+	std::vector<std::thread> m_loadThreads;
+	uint32_t m_loadThreadCount = 0;
+	// Guards m_loadQueue and m_bThreadActive
 	std::unique_ptr<std::mutex> m_loadMutex;
 	std::unique_ptr<std::condition_variable> m_queueVar;
 	std::queue<std::shared_ptr<TextureQueueItem>> m_loadQueue;
-	std::queue<std::shared_ptr<TextureQueueItem>> m_initQueue;
-	std::vector<std::shared_ptr<Texture>> m_texturesTmp;
+	// Decoded items, pushed by the load threads and consumed by the main thread
+	msys::MpscQueue<std::shared_ptr<TextureQueueItem>> m_initQueue;
+	uint32_t m_updateBudgetTextures = 0;
+	std::chrono::microseconds m_updateBudgetTime {0};
+	// Textures that are queued or still being loaded, by name, in the order they were queued
+	std::unordered_map<std::string, std::vector<std::shared_ptr<Texture>>> m_texturesTmp;
 	std::shared_ptr<prosper::ISampler> m_textureSampler;
 	std::shared_ptr<prosper::ISampler> m_textureSamplerNoMipmap;
 	std::vector<std::weak_ptr<prosper::ISampler>> m_customSamplers;
 	std::function<VFilePtr(const std::string &)> m_texFileHandler = nullptr;
+	// Guards m_texFileHandler, see SetTextureFileHandler
+	std::mutex m_texFileHandlerMutex;
 	std::shared_ptr<Texture> m_error;
 	bool m_bThreadActive;
 	void TextureThread();
-	bool CheckTextureThreadLocked();
+	void StartLoadThreads();
+	void StopLoadThreads();
 	std::shared_ptr<Texture> FindTexture(const std::string &imgFile, std::string *cache, bool *bLoading = nullptr);
 	void InitializeTextureData(TextureQueueItem &item);
 	void InitializeImage(TextureQueueItem &item);
 	void PushOnLoadQueue(std::unique_ptr<TextureQueueItem> item);
 	std::shared_ptr<Texture> GetQueuedTexture(TextureQueueItem &item, bool bErase = false);
 	void FinalizeTexture(TextureQueueItem &item);
+	void AddTexture(const std::shared_ptr<Texture> &texture);
 	void ReloadTexture(uint32_t texId, const LoadInfo &loadInfo);
 	VFilePtr OpenTextureFile(const std::string &fpath);
+	bool HasTextureFileHandler();
+	VFilePtr CallTextureFileHandler(const std::string &fpath);
 };
 #pragma warning(pop)
 
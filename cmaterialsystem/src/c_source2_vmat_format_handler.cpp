@@ -87,8 +87,17 @@ bool msys::CSource2VmatFormatHandler::InitializeVMatData(::source2::resource::Re
 
 				std::shared_ptr<void> normalMap = nullptr;
 				auto metalnessReflectancePath = vmat::get_vmat_texture_path(*metalnessMap).GetString();
-				auto pMetalnessReflectanceMap = textureManager.LoadAsset(metalnessReflectancePath);
-				if(pMetalnessReflectanceMap && pMetalnessReflectanceMap->HasValidVkTexture()) {
+				auto key = matManager.GetDerivedTextureKey({metalnessReflectancePath}, "source2_decompose_metalness_reflectance");
+				auto cachedTextures = key.has_value() ? matManager.FindDerivedTextures(*key) : std::nullopt;
+				auto pMetalnessReflectanceMap = cachedTextures.has_value() ? nullptr : textureManager.LoadAsset(metalnessReflectancePath);
+				if(cachedTextures.has_value() && !cachedTextures->empty()) {
+					rootData.AddData("rma_map", std::make_shared<ds::Texture>(settings, cachedTextures->front()));
+					AddGeneratedFile(matManager.GetDerivedTextureFilePath(cachedTextures->front()));
+
+					auto rmaInfo = rootData.AddBlock("rma_info");
+					rmaInfo->AddValue("bool", "requires_ao_update", "1");
+				}
+				else if(pMetalnessReflectanceMap && pMetalnessReflectanceMap->HasValidVkTexture()) {
 					prosper::util::ImageCreateInfo imgCreateInfo {};
 					//imgCreateInfo.flags |= prosper::util::ImageCreateInfo::Flags::FullMipmapChain;
 					imgCreateInfo.format = prosper::Format::R8G8B8A8_UNorm;
@@ -131,14 +140,19 @@ bool msys::CSource2VmatFormatHandler::InitializeVMatData(::source2::resource::Re
 					texInfo.alphaMode = uimg::TextureInfo::AlphaMode::Auto;
 					texInfo.inputFormat = uimg::TextureInfo::InputFormat::R8G8B8A8_UInt;
 					texInfo.outputFormat = uimg::TextureInfo::OutputFormat::ColorMap;
-					auto rmaPath = pathNoExt + "_rma";
+					auto rmaPath = key.has_value() ? matManager.GetDerivedTextureName(*key, "rma") : pathNoExt + "_rma";
 					prosper::util::save_texture((rootPath + ('/' + rmaPath)).GetString(), texRMA->GetImage(), texInfo, errHandler);
 
 					rootData.AddData("rma_map", std::make_shared<ds::Texture>(settings, rmaPath));
+					if(!key.has_value() || !matManager.StoreDerivedTextures(*key, {rmaPath}))
+						m_cacheable = false;
+					AddGeneratedFile(matManager.GetDerivedTextureFilePath(rmaPath));
 
 					auto rmaInfo = rootData.AddBlock("rma_info");
 					rmaInfo->AddValue("bool", "requires_ao_update", "1");
 				}
+				else
+					m_cacheable = false;
 			}
 		}
 	}
@@ -149,9 +163,12 @@ bool msys::CSource2VmatFormatHandler::InitializeVMatData(::source2::resource::Re
 		auto *shaderDecomposePbr = static_cast<msys::source2::ShaderDecomposePBR *>(context.GetShader("source2_decompose_pbr").get());
 		std::string texPath;
 		auto albedoTex = get_texture(matManager, rootData, "albedo_map", &texPath);
-		auto normalTex = get_texture(matManager, rootData, "normal_map");
-		if(normalTex == nullptr)
+		std::string normalTexPath;
+		auto normalTex = get_texture(matManager, rootData, "normal_map", &normalTexPath);
+		if(normalTex == nullptr) {
 			normalTex = load_texture(matManager, "white");
+			normalTexPath = "white";
+		}
 		if(albedoTex && normalTex) {
 			auto &textureManager = matManager.GetTextureManager();
 
@@ -159,6 +176,7 @@ bool msys::CSource2VmatFormatHandler::InitializeVMatData(::source2::resource::Re
 			ufile::remove_extension_from_filename(pathNoExt);
 
 			prosper::Texture *anisoGlossMap = nullptr;
+			std::string anisoGlossTexPath;
 
 			// Decompose Source 2 textures into albedo and metalness-roughness
 			auto *alphaTest = vmat.FindIntParam("F_ALPHA_TEST");
@@ -178,11 +196,15 @@ bool msys::CSource2VmatFormatHandler::InitializeVMatData(::source2::resource::Re
 					path.PopFront();
 
 					anisoGlossMap = load_texture(matManager, path.GetString()).get();
-					if(anisoGlossMap == nullptr)
+					if(anisoGlossMap != nullptr)
+						anisoGlossTexPath = path.GetString();
+					else
 						umath::set_flag(flags, msys::source2::ShaderDecomposePBR::Flags::SpecularWorkflow, false);
 				}
-				else
+				else {
 					anisoGlossMap = normalTex.get();
+					anisoGlossTexPath = normalTexPath;
+				}
 			}
 
 			// Note: While the original roughness and metalness maps have the
@@ -192,12 +214,15 @@ bool msys::CSource2VmatFormatHandler::InitializeVMatData(::source2::resource::Re
 			prosper::Extent2D metallicRoughnessResolution {};
 			auto *s2AoMap = vmat.FindTextureParam("g_tAmbientOcclusion");
 			prosper::Texture *aoTex = nullptr;
+			std::string aoTexPath = "white";
 			if(s2AoMap) {
 				::util::Path path {*s2AoMap};
 				path.RemoveFileExtension();
 				path += ".vtex_c";
 
 				aoTex = load_texture(matManager, path.GetString()).get();
+				if(aoTex != nullptr)
+					aoTexPath = path.GetString();
 			}
 
 			auto hasAoMap = true;
@@ -218,56 +243,77 @@ bool msys::CSource2VmatFormatHandler::InitializeVMatData(::source2::resource::Re
 				auto extents = aoImg.GetExtents();
 				metallicRoughnessResolution = {static_cast<uint32_t>(extents.width), static_cast<uint32_t>(extents.height)};
 			}
-
-			auto pbrSet = shaderDecomposePbr->DecomposePBR(context, *albedoTex, *normalTex, *aoTex, flags, anisoGlossMap);
-
-			auto albedoPath = pathNoExt + "_albedo";
-			uimg::TextureInfo texInfo {};
-			texInfo.containerFormat = uimg::TextureInfo::ContainerFormat::DDS;
-			texInfo.alphaMode = uimg::TextureInfo::AlphaMode::None;
-			texInfo.outputFormat = uimg::TextureInfo::OutputFormat::ColorMap;
-			auto useAlpha = umath::is_flag_set(flags, msys::source2::ShaderDecomposePBR::Flags::TreatAlphaAsTransparency);
-			if(useAlpha) {
-				texInfo.alphaMode = uimg::TextureInfo::AlphaMode::Transparency;
-				texInfo.outputFormat = uimg::TextureInfo::OutputFormat::ColorMapSmoothAlpha;
-			}
-			texInfo.flags = uimg::TextureInfo::Flags::GenerateMipmaps;
-			texInfo.inputFormat = uimg::TextureInfo::InputFormat::R8G8B8A8_UInt;
-			prosper::util::save_texture((rootPath + ('/' + albedoPath)).GetString(), *pbrSet.albedoMap, texInfo, [](const std::string &err) { std::cout << "WARNING: Unable to save albedo image as DDS: " << err << std::endl; });
-
 			// TODO
 			if(metallicRoughnessResolution.width > 1'024)
 				metallicRoughnessResolution.width = 1'024;
 			if(metallicRoughnessResolution.height > 1'024)
 				metallicRoughnessResolution.height = 1'024;
 
-			auto mrExtents = pbrSet.rmaMap->GetExtents();
-			if(g_downScaleRMATextures && mrExtents.width > metallicRoughnessResolution.width && mrExtents.height > metallicRoughnessResolution.height) {
-				std::cout << "Downscaling RMA map from " << mrExtents.width << "x" << mrExtents.height << " to " << metallicRoughnessResolution.width << "x" << metallicRoughnessResolution.height << std::endl;
-				prosper::util::ImageCreateInfo imgCreateInfo {};
-				imgCreateInfo.format = prosper::Format::R8G8B8A8_UNorm;
-				imgCreateInfo.memoryFeatures = prosper::MemoryFeatureFlags::GPUBulk;
-				imgCreateInfo.postCreateLayout = prosper::ImageLayout::TransferDstOptimal;
-				imgCreateInfo.tiling = prosper::ImageTiling::Optimal;
-				imgCreateInfo.usage = prosper::ImageUsageFlags::TransferDstBit;
-
-				imgCreateInfo.width = metallicRoughnessResolution.width;
-				imgCreateInfo.height = metallicRoughnessResolution.height;
-				auto imgRescaled = context.CreateImage(imgCreateInfo);
-				auto &setupCmd = context.GetSetupCommandBuffer();
-				prosper::util::BlitInfo blitInfo {};
-				blitInfo.extentsSrc = mrExtents;
-				blitInfo.extentsDst = metallicRoughnessResolution;
-				setupCmd->RecordImageBarrier(*pbrSet.rmaMap, prosper::ImageLayout::ShaderReadOnlyOptimal, prosper::ImageLayout::TransferSrcOptimal);
-				setupCmd->RecordBlitImage(blitInfo, *pbrSet.rmaMap, *imgRescaled);
-				context.FlushSetupCommandBuffer();
-
-				pbrSet.rmaMap = imgRescaled;
+			// The decomposed textures may already have been generated for another material that uses the same source textures and settings
+			std::vector<std::string> sourceTextures {texPath, normalTexPath, aoTexPath};
+			if(!anisoGlossTexPath.empty())
+				sourceTextures.push_back(anisoGlossTexPath);
+			auto converter = "source2_decompose_pbr_" + std::to_string(umath::to_integral(flags));
+			if(g_downScaleRMATextures)
+				converter += "_downscale_" + std::to_string(metallicRoughnessResolution.width) + 'x' + std::to_string(metallicRoughnessResolution.height);
+			auto key = matManager.GetDerivedTextureKey(sourceTextures, converter);
+			auto cachedTextures = key.has_value() ? matManager.FindDerivedTextures(*key) : std::nullopt;
+
+			auto useAlpha = umath::is_flag_set(flags, msys::source2::ShaderDecomposePBR::Flags::TreatAlphaAsTransparency);
+			std::string albedoPath;
+			std::string metalnessRoughnessPath;
+			if(cachedTextures.has_value() && cachedTextures->size() == 2) {
+				albedoPath = (*cachedTextures)[0];
+				metalnessRoughnessPath = (*cachedTextures)[1];
 			}
+			else {
+				auto pbrSet = shaderDecomposePbr->DecomposePBR(context, *albedoTex, *normalTex, *aoTex, flags, anisoGlossMap);
+
+				albedoPath = key.has_value() ? matManager.GetDerivedTextureName(*key, "albedo") : pathNoExt + "_albedo";
+				uimg::TextureInfo texInfo {};
+				texInfo.containerFormat = uimg::TextureInfo::ContainerFormat::DDS;
+				texInfo.alphaMode = uimg::TextureInfo::AlphaMode::None;
+				texInfo.outputFormat = uimg::TextureInfo::OutputFormat::ColorMap;
+				if(useAlpha) {
+					texInfo.alphaMode = uimg::TextureInfo::AlphaMode::Transparency;
+					texInfo.outputFormat = uimg::TextureInfo::OutputFormat::ColorMapSmoothAlpha;
+				}
+				texInfo.flags = uimg::TextureInfo::Flags::GenerateMipmaps;
+				texInfo.inputFormat = uimg::TextureInfo::InputFormat::R8G8B8A8_UInt;
+				prosper::util::save_texture((rootPath + ('/' + albedoPath)).GetString(), *pbrSet.albedoMap, texInfo, [](const std::string &err) { std::cout << "WARNING: Unable to save albedo image as DDS: " << err << std::endl; });
+
+				auto mrExtents = pbrSet.rmaMap->GetExtents();
+				if(g_downScaleRMATextures && mrExtents.width > metallicRoughnessResolution.width && mrExtents.height > metallicRoughnessResolution.height) {
+					std::cout << "Downscaling RMA map from " << mrExtents.width << "x" << mrExtents.height << " to " << metallicRoughnessResolution.width << "x" << metallicRoughnessResolution.height << std::endl;
+					prosper::util::ImageCreateInfo imgCreateInfo {};
+					imgCreateInfo.format = prosper::Format::R8G8B8A8_UNorm;
+					imgCreateInfo.memoryFeatures = prosper::MemoryFeatureFlags::GPUBulk;
+					imgCreateInfo.postCreateLayout = prosper::ImageLayout::TransferDstOptimal;
+					imgCreateInfo.tiling = prosper::ImageTiling::Optimal;
+					imgCreateInfo.usage = prosper::ImageUsageFlags::TransferDstBit;
 
-			auto metalnessRoughnessPath = pathNoExt + "_rma";
-			texInfo.outputFormat = uimg::TextureInfo::OutputFormat::ColorMap;
-			prosper::util::save_texture((rootPath + ('/' + metalnessRoughnessPath)).GetString(), *pbrSet.rmaMap, texInfo, [](const std::string &err) { std::cout << "WARNING: Unable to save RMA image as DDS: " << err << std::endl; });
+					imgCreateInfo.width = metallicRoughnessResolution.width;
+					imgCreateInfo.height = metallicRoughnessResolution.height;
+					auto imgRescaled = context.CreateImage(imgCreateInfo);
+					auto &setupCmd = context.GetSetupCommandBuffer();
+					prosper::util::BlitInfo blitInfo {};
+					blitInfo.extentsSrc = mrExtents;
+					blitInfo.extentsDst = metallicRoughnessResolution;
+					setupCmd->RecordImageBarrier(*pbrSet.rmaMap, prosper::ImageLayout::ShaderReadOnlyOptimal, prosper::ImageLayout::TransferSrcOptimal);
+					setupCmd->RecordBlitImage(blitInfo, *pbrSet.rmaMap, *imgRescaled);
+					context.FlushSetupCommandBuffer();
+
+					pbrSet.rmaMap = imgRescaled;
+				}
+
+				metalnessRoughnessPath = key.has_value() ? matManager.GetDerivedTextureName(*key, "rma") : pathNoExt + "_rma";
+				texInfo.outputFormat = uimg::TextureInfo::OutputFormat::ColorMap;
+				prosper::util::save_texture((rootPath + ('/' + metalnessRoughnessPath)).GetString(), *pbrSet.rmaMap, texInfo, [](const std::string &err) { std::cout << "WARNING: Unable to save RMA image as DDS: " << err << std::endl; });
+				if(!key.has_value() || !matManager.StoreDerivedTextures(*key, {albedoPath, metalnessRoughnessPath}))
+					m_cacheable = false;
+			}
+			AddGeneratedFile(matManager.GetDerivedTextureFilePath(albedoPath));
+			AddGeneratedFile(matManager.GetDerivedTextureFilePath(metalnessRoughnessPath));
 
 			rootData.AddData("albedo_map", std::make_shared<ds::Texture>(settings, albedoPath));
 			rootData.AddData("rma_map", std::make_shared<ds::Texture>(settings, metalnessRoughnessPath));
@@ -285,6 +331,8 @@ bool msys::CSource2VmatFormatHandler::InitializeVMatData(::source2::resource::Re
 			if(useAlpha)
 				rootData.AddValue("int", "alpha_mode", std::to_string(umath::to_integral(AlphaMode::Blend)));
 		}
+		else
+			m_cacheable = false;
 	}
 
 	auto dsNormalMap = std::dynamic_pointer_cast<ds::Texture>(rootData.GetValue("normal_map"));
@@ -324,8 +372,15 @@ bool msys::CSource2VmatFormatHandler::InitializeVMatData(::source2::resource::Re
 				if(shaderGenerateTangentSpaceNormalMap) {
 					auto &textureManager = matManager.GetTextureManager();
 
-					auto pNormalMap = textureManager.LoadAsset(normalMapPath);
-					if(pNormalMap && pNormalMap->HasValidVkTexture()) {
+					auto key = matManager.GetDerivedTextureKey({normalMapPath}, (isSteamVrMat || isDota2Mat) ? "source2_generate_tangent_space_normal_map_proto" : "source2_generate_tangent_space_normal_map");
+					auto cachedTextures = key.has_value() ? matManager.FindDerivedTextures(*key) : std::nullopt;
+					auto pNormalMap = cachedTextures.has_value() ? nullptr : textureManager.LoadAsset(normalMapPath);
+					if(cachedTextures.has_value() && !cachedTextures->empty()) {
+						load_texture(matManager, cachedTextures->front(), true);
+						rootData.AddData("normal_map", std::make_shared<ds::Texture>(settings, cachedTextures->front()));
+						AddGeneratedFile(matManager.GetDerivedTextureFilePath(cachedTextures->front()));
+					}
+					else if(pNormalMap && pNormalMap->HasValidVkTexture()) {
 						prosper::util::ImageCreateInfo imgCreateInfo {};
 						//imgCreateInfo.flags |= prosper::util::ImageCreateInfo::Flags::FullMipmapChain;
 						imgCreateInfo.format = prosper::Format::R16G16B16A16_SFloat;
@@ -359,6 +414,8 @@ bool msys::CSource2VmatFormatHandler::InitializeVMatData(::source2::resource::Re
 
 						auto normalMapPathNoExt = normalMapPath;
 						ufile::remove_extension_from_filename(normalMapPathNoExt);
+						if(key.has_value())
+							normalMapPathNoExt = matManager.GetDerivedTextureName(*key, "normal");
 
 						auto errHandler = [](const std::string &err) { std::cout << "WARNING: Unable to save normal map image as DDS: " << err << std::endl; };
 
@@ -373,7 +430,12 @@ bool msys::CSource2VmatFormatHandler::InitializeVMatData(::source2::resource::Re
 
 						load_texture(matManager, normalMapPathNoExt, true);
 						rootData.AddData("normal_map", std::make_shared<ds::Texture>(settings, normalMapPathNoExt));
+						if(!key.has_value() || !matManager.StoreDerivedTextures(*key, {normalMapPathNoExt}))
+							m_cacheable = false;
+						AddGeneratedFile(matManager.GetDerivedTextureFilePath(normalMapPathNoExt));
 					}
+					else
+						m_cacheable = false;
 				}
 			}
 #if 0
@@ -29,6 +29,7 @@
 #include <datasystem.h>
 #include <datasystem_vector.h>
 #include <fsys/ifile.hpp>
+#include <array>
 
 #ifndef DISABLE_VMT_SUPPORT
 #include <VMTFile.h>
@@ -86,15 +87,28 @@ bool msys::CSourceVmtFormatHandler::LoadVMTData(VTFLib::CVMTFile &vmt, const std
 		if(shaderDecomposeCornea) {
 			auto &textureManager = matManager.GetTextureManager();
 
-			auto irisMap = textureManager.LoadAsset(irisTexture);
-			if(irisMap == nullptr)
-				irisMap = textureManager.GetErrorTexture();
-
-			auto corneaMap = textureManager.LoadAsset(corneaTexture);
-			if(corneaMap == nullptr)
-				corneaMap = textureManager.GetErrorTexture();
+			// The textures may already have been generated for another material that uses the same iris and cornea textures
+			auto key = matManager.GetDerivedTextureKey({irisTexture, corneaTexture}, "decompose_cornea");
+			auto cachedTextures = key.has_value() ? matManager.FindDerivedTextures(*key) : std::nullopt;
+			if(cachedTextures.has_value() && cachedTextures->size() != 4)
+				cachedTextures = {};
+
+			std::shared_ptr<::Texture> irisMap = nullptr;
+			std::shared_ptr<::Texture> corneaMap = nullptr;
+			if(!cachedTextures.has_value()) {
+				irisMap = textureManager.LoadAsset(irisTexture);
+				if(irisMap == nullptr)
+					irisMap = textureManager.GetErrorTexture();
+
+				corneaMap = textureManager.LoadAsset(corneaTexture);
+				if(corneaMap == nullptr)
+					corneaMap = textureManager.GetErrorTexture();
+			}
 
-			if(irisMap && irisMap->HasValidVkTexture() && corneaMap && corneaMap->HasValidVkTexture()) {
+			std::optional<std::array<std::string, 4>> eyeTextures {};
+			if(cachedTextures.has_value())
+				eyeTextures = std::array<std::string, 4> {(*cachedTextures)[0], (*cachedTextures)[1], (*cachedTextures)[2], (*cachedTextures)[3]};
+			else if(irisMap && irisMap->HasValidVkTexture() && corneaMap && corneaMap->HasValidVkTexture()) {
 				// Prepare output textures (albedo, normal, parallax)
 				prosper::util::ImageCreateInfo imgCreateInfo {};
 				//imgCreateInfo.flags |= prosper::util::ImageCreateInfo::Flags::FullMipmapChain;
@@ -142,10 +156,10 @@ bool msys::CSourceVmtFormatHandler::LoadVMTData(VTFLib::CVMTFile &vmt, const std
 				auto corneaTextureNoExt = corneaTexture;
 				ufile::remove_extension_from_filename(corneaTextureNoExt);
 
-				auto albedoTexName = irisTextureNoExt + "_albedo";
-				auto normalTexName = corneaTextureNoExt + "_normal";
-				auto parallaxTexName = corneaTextureNoExt + "_parallax";
-				auto noiseTexName = corneaTextureNoExt + "_noise";
+				auto albedoTexName = key.has_value() ? matManager.GetDerivedTextureName(*key, "albedo") : irisTextureNoExt + "_albedo";
+				auto normalTexName = key.has_value() ? matManager.GetDerivedTextureName(*key, "normal") : corneaTextureNoExt + "_normal";
+				auto parallaxTexName = key.has_value() ? matManager.GetDerivedTextureName(*key, "parallax") : corneaTextureNoExt + "_parallax";
+				auto noiseTexName = key.has_value() ? matManager.GetDerivedTextureName(*key, "noise") : corneaTextureNoExt + "_noise";
 
 				auto errHandler = [](const std::string &err) { std::cout << "WARNING: Unable to save eyeball image(s) as DDS: " << err << std::endl; };
 
@@ -166,6 +180,17 @@ bool msys::CSourceVmtFormatHandler::LoadVMTData(VTFLib::CVMTFile &vmt, const std
 				texInfo.SetNormalMap();
 				prosper::util::save_texture((rootPath + ('/' + normalTexName)).GetString(), texNormal->GetImage(), texInfo, errHandler);
 
+				eyeTextures = std::array<std::string, 4> {albedoTexName, normalTexName, parallaxTexName, noiseTexName};
+				if(!key.has_value() || !matManager.StoreDerivedTextures(*key, {albedoTexName, normalTexName, parallaxTexName, noiseTexName}))
+					m_cacheable = false;
+			}
+			else
+				m_cacheable = false;
+			if(eyeTextures.has_value()) {
+				auto &[albedoTexName, normalTexName, parallaxTexName, noiseTexName] = *eyeTextures;
+				for(auto &tex : *eyeTextures)
+					AddGeneratedFile(matManager.GetDerivedTextureFilePath(tex));
+
 				// TODO: These should be Material::ALBEDO_MAP_IDENTIFIER/Material::NORMAL_MAP_IDENTIFIER/Material::PARALLAX_MAP_IDENTIFIER, but
 				// for some reason the linker complains about unresolved symbols?
 				rootData.AddData("albedo_map", std::make_shared<ds::Texture>(*settings, albedoTexName));
@@ -326,8 +351,15 @@ bool msys::CSourceVmtFormatHandler::LoadVMTData(VTFLib::CVMTFile &vmt, const std
 		if(shaderSSBumpMapToNormalMap) {
 			auto &textureManager = matManager.GetTextureManager();
 
-			auto bumpMap = textureManager.LoadAsset(bumpMapTexture);
-			if(bumpMap && bumpMap->HasValidVkTexture()) {
+			// The normal map may already have been generated for another material that uses the same bump map
+			auto key = matManager.GetDerivedTextureKey({bumpMapTexture}, "ssbumpmap_to_normalmap");
+			auto cachedTextures = key.has_value() ? matManager.FindDerivedTextures(*key) : std::nullopt;
+			auto bumpMap = cachedTextures.has_value() ? nullptr : textureManager.LoadAsset(bumpMapTexture);
+			if(cachedTextures.has_value() && !cachedTextures->empty()) {
+				rootData.AddData("normal_map", std::make_shared<ds::Texture>(*settings, cachedTextures->front()));
+				AddGeneratedFile(matManager.GetDerivedTextureFilePath(cachedTextures->front()));
+			}
+			else if(bumpMap && bumpMap->HasValidVkTexture()) {
 				// Prepare output texture (normal map)
 				prosper::util::ImageCreateInfo imgCreateInfo {};
 				//imgCreateInfo.flags |= prosper::util::ImageCreateInfo::Flags::FullMipmapChain;
@@ -363,7 +395,7 @@ bool msys::CSourceVmtFormatHandler::LoadVMTData(VTFLib::CVMTFile &vmt, const std
 				auto bumpMapTextureNoExt = bumpMapTexture;
 				ufile::remove_extension_from_filename(bumpMapTexture);
 
-				auto normalTexName = bumpMapTexture + "_normal";
+				auto normalTexName = key.has_value() ? matManager.GetDerivedTextureName(*key, "normal") : bumpMapTexture + "_normal";
 
 				auto errHandler = [](const std::string &err) { std::cout << "WARNING: Unable to save converted ss bumpmap as DDS: " << err << std::endl; };
 
@@ -379,7 +411,12 @@ bool msys::CSourceVmtFormatHandler::LoadVMTData(VTFLib::CVMTFile &vmt, const std
 				// TODO: This should be Material::NORMAL_MAP_IDENTIFIER, but
 				// for some reason the linker complains about unresolved symbols?
 				rootData.AddData("normal_map", std::make_shared<ds::Texture>(*settings, normalTexName));
+				if(!key.has_value() || !matManager.StoreDerivedTextures(*key, {normalTexName}))
+					m_cacheable = false;
+				AddGeneratedFile(matManager.GetDerivedTextureFilePath(normalTexName));
 			}
+			else
+				m_cacheable = false;
 		}
 	}
 	matManager.GetTextureManager().ClearUnused();
@@ -140,6 +140,9 @@ void CMaterial::InitializeSampler()
 		msys::setup_sampler_mipmap_mode(samplerInfo, mipmapMode);
 		m_sampler = GetContext().CreateSampler(samplerInfo);
 	}
+	// The sampler is part of the sort key
+	if(umath::is_flag_set(Material::m_stateFlags, Material::StateFlags::TexturesUpdated))
+		UpdateRenderSortData();
 }
 
 std::shared_ptr<prosper::ISampler> CMaterial::GetSampler() { return m_sampler; }
@@ -178,6 +181,48 @@ void CMaterial::Assign(const Material &other)
 	Material::Assign(other);
 	UpdatePrimaryShader();
 }
+bool CMaterial::CanAssignChanges(const Material &other) const
+{
+	if(!Material::CanAssignChanges(other))
+		return false;
+	// Textures are loaded with the mipmap mode of the material and the sampler is created from the material data,
+	// neither can be updated in place
+	auto otherData = other.GetDataBlock();
+	for(auto *key : {"mipmap_load_mode", "address_mode_u", "address_mode_v", "address_mode_w", "border_color"}) {
+		auto &val = m_data->GetValue(key);
+		auto &otherVal = otherData->GetValue(key);
+		if(!val && !otherVal)
+			continue;
+		if(!val || !otherVal || val->IsBlock() || otherVal->IsBlock() || static_cast<ds::Value &>(*val).GetString() != static_cast<ds::Value &>(*otherVal).GetString())
+			return false;
+	}
+	return true;
+}
+void CMaterial::OnChangesAssigned(ChangeFlags changes)
+{
+	// The settings buffer is written when the shader initializes the descriptor sets, so they have to be
+	// re-initialized for parameter changes as well
+	ClearDescriptorSets();
+	// If only parameters have changed, all textures are kept
+	if(umath::is_flag_set(changes, ChangeFlags::TexturesBit)) {
+		auto texturesLoaded = umath::is_flag_set(m_stateFlags, StateFlags::TexturesLoaded);
+		auto texturesPrecached = umath::is_flag_set(m_stateFlags, StateFlags::TexturesPrecached);
+		umath::set_flag(m_stateFlags, StateFlags::TexturesLoaded | StateFlags::TexturesPrecached, false);
+		// Unchanged texture slots have kept their textures, so only the changed slots are actually loaded
+		if(texturesLoaded) {
+			LoadTextures(false); // Also updates the textures
+			return;
+		}
+		if(texturesPrecached)
+			LoadTextures(true);
+	}
+	Material::OnChangesAssigned(changes);
+	if(!umath::is_flag_set(m_stateFlags, StateFlags::TexturesLoaded))
+		return; // The shader handler is invoked once the textures have been loaded
+	auto &shaderHandler = static_cast<msys::CMaterialManager &>(GetManager()).GetShaderHandler();
+	if(shaderHandler != nullptr)
+		shaderHandler(this);
+}
 void CMaterial::UpdatePrimaryShader()
 {
 	if(m_shader == nullptr && m_shaderInfo.expired()) {
@@ -210,16 +255,23 @@ uint32_t CMaterial::GetMipmapMode(const std::shared_ptr<ds::Block> &data) const
 	return umath::to_integral(mipmapMode);
 }
 void CMaterial::SetLoaded(bool b) { Material::SetLoaded(b); }
-void CMaterial::SetSpriteSheetAnimation(const SpriteSheetAnimation &animInfo) { m_spriteSheetAnimation = animInfo; }
-void CMaterial::ClearSpriteSheetAnimation() { m_spriteSheetAnimation = {}; }
+void CMaterial::SetSpriteSheetAnimation(const SpriteSheetAnimation &animInfo)
+{
+	m_spriteSheetAnimation = animInfo;
+	UpdateRenderSortData();
+}
+void CMaterial::ClearSpriteSheetAnimation()
+{
+	m_spriteSheetAnimation = {};
+	UpdateRenderSortData();
+}
 const SpriteSheetAnimation *CMaterial::GetSpriteSheetAnimation() const { return const_cast<CMaterial *>(this)->GetSpriteSheetAnimation(); }
 SpriteSheetAnimation *CMaterial::GetSpriteSheetAnimation()
 {
 	if(m_spriteSheetAnimation.has_value() == false) {
 		// Lazy initialization
-		auto &data = GetDataBlock();
-		if(data) {
-			auto &anim = data->GetValue("animation");
+		if(m_data) {
+			auto &anim = m_data->GetValue("animation");
 			if(anim && typeid(*anim) == typeid(ds::String)) {
 				auto animFilePath = static_cast<ds::String &>(*anim).GetString();
 				auto f = filemanager::open_file("materials/" + animFilePath + ".psd", filemanager::FileMode::Read | filemanager::FileMode::Binary);
@@ -288,10 +340,9 @@ void CMaterial::SetTexture(const std::string &identifier, Texture *texture)
 	auto dataTex = std::make_shared<ds::Texture>(*dsSettingsTmp, ""); // Data settings will be overwrriten by AddData-call below
 	auto &v = dataTex->GetValue();
 	v.texture = texture->shared_from_this();
-	v.width = texture->GetWidth();
-	v.height = texture->GetHeight();
+	v.SetSize(texture->GetWidth(), texture->GetHeight());
 	v.name = texture->GetName();
-	m_data->AddData(identifier, dataTex);
+	GetMutableDataBlock()->AddData(identifier, dataTex);
 
 	umath::set_flag(Material::m_stateFlags, Material::StateFlags::TexturesUpdated, false);
 	UpdateTextures();
@@ -327,11 +378,26 @@ void CMaterial::OnTexturesUpdated()
 	}
 }
 
+uint64_t CMaterial::ComputeTextureSetHash() const { return msys::hash_combine(Material::ComputeTextureSetHash(), std::hash<const void *> {}(m_sampler.get())); }
+msys::RenderFeatureFlags CMaterial::ComputeRenderFeatureFlags() const
+{
+	auto flags = Material::ComputeRenderFeatureFlags();
+	// The sprite sheet is loaded lazily, so we only check if the material references one
+	auto usesSpriteSheet = m_spriteSheetAnimation.has_value();
+	if(!usesSpriteSheet && m_data) {
+		auto &anim = m_data->GetValue("animation");
+		usesSpriteSheet = (anim && typeid(*anim) == typeid(ds::String));
+	}
+	if(usesSpriteSheet)
+		flags |= msys::RenderFeatureFlags::SpriteSheetBit;
+	return flags;
+}
+
 void CMaterial::SetTexture(const std::string &identifier, const std::string &texture)
 {
 	auto dsSettingsTmp = ds::create_data_settings({});
 	auto dataTex = std::make_shared<ds::Texture>(*dsSettingsTmp, texture); // Data settings will be overwrriten by AddData-call below
-	m_data->AddData(identifier, dataTex);
+	GetMutableDataBlock()->AddData(identifier, dataTex);
 	umath::set_flag(Material::m_stateFlags, Material::StateFlags::TexturesUpdated, false);
 	UpdateTextures();
 
@@ -367,7 +433,7 @@ void CMaterial::LoadTexture(TextureInfo &texInfo, bool precache)
 {
 	if(texInfo.name.empty() || texInfo.texture != nullptr)
 		return;
-	auto mipmapMode = static_cast<TextureMipmapMode>(GetMipmapMode(GetDataBlock()));
+	auto mipmapMode = static_cast<TextureMipmapMode>(GetMipmapMode(m_data));
 	auto &textureManager = GetTextureManager();
 	auto loadInfo = std::make_unique<msys::TextureLoadInfo>();
 	loadInfo->mipmapMode = mipmapMode;
@@ -382,18 +448,25 @@ TextureInfo *CMaterial::GetTextureInfo(const std::string &key)
 	LoadTextures(false);
 	return Material::GetTextureInfo(key);
 }
+TextureInfo *CMaterial::GetTextureInfo(msys::KeyAtom key)
+{
+	LoadTextures(false);
+	return Material::GetTextureInfo(key);
+}
 
 void CMaterial::LoadTextures(bool precache, bool force)
 {
+	if(!m_data)
+		return;
 	if(precache) {
 		if(!force && (umath::is_flag_set(m_stateFlags, StateFlags::TexturesLoaded) || umath::is_flag_set(m_stateFlags, StateFlags::TexturesPrecached)))
 			return;
-		LoadTextures(*GetDataBlock(), precache, force);
+		LoadTextures(*m_data, precache, force);
 		return;
 	}
 	if(!force && umath::is_flag_set(m_stateFlags, StateFlags::TexturesLoaded))
 		return;
-	LoadTextures(*GetDataBlock(), precache, force);
+	LoadTextures(*m_data, precache, force);
 	UpdateTextures();
 	auto &shaderHandler = static_cast<msys::CMaterialManager &>(m_manager).GetShaderHandler();
 	if(shaderHandler)
@@ -412,6 +485,8 @@ void CMaterial::LoadTextures(ds::Block &data, bool precache, bool force)
 		umath::set_flag(m_stateFlags, StateFlags::TexturesLoaded);
 	}
 	auto *values = data.GetData();
+	if(!values)
+		return;
 	const auto &typeTexture = typeid(ds::Texture);
 	for(auto &it : *values) {
 		auto &value = it.second;
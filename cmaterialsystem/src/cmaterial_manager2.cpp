@@ -8,9 +8,11 @@
 #include "impl_texture_formats.h"
 #include "cmaterial_manager2.hpp"
 #include "cmaterial.h"
+#include "material_load_handle.hpp"
 #include "texturemanager/texture_manager2.hpp"
 #include "c_source_vmt_format_handler.hpp"
 #include "c_source2_vmat_format_handler.hpp"
+#include <import_cache.hpp>
 
 #include <shader/prosper_shader_manager.hpp>
 #include "shaders/c_shader_decompose_cornea.hpp"
@@ -75,6 +77,76 @@ void msys::CMaterialManager::Poll()
 {
 	MaterialManager::Poll();
 	m_textureManager->Poll();
+	UpdateMaterialLoadHandles();
+	ReloadQueuedShaders();
+}
+msys::FinalizationStats msys::CMaterialManager::Poll(const FinalizationBudget &budget)
+{
+	MaterialManager::Poll();
+	auto stats = m_textureManager->Poll(budget);
+	UpdateMaterialLoadHandles();
+	ReloadQueuedShaders();
+	return stats;
+}
+void msys::CMaterialManager::OnImageFileChanged(const FileWatcher::Change &change, const std::string &identifier)
+{
+	// Textures that are in use are updated in place, so the materials that use them don't have to be reloaded
+	if(change.type != FileWatcher::ChangeType::Removed)
+		m_textureManager->ReloadAssetAsync(identifier);
+}
+std::shared_ptr<msys::MaterialLoadHandle> msys::CMaterialManager::LoadMaterialAndTextures(const std::string &path, const MaterialLoadHandle::OnComplete &onComplete)
+{
+	auto handle = std::shared_ptr<MaterialLoadHandle> {new MaterialLoadHandle {*this, path, LoadAssets(std::span {&path, 1}), onComplete}};
+	if(!handle->Update())
+		m_materialLoadHandles.push_back(handle);
+	return handle;
+}
+std::optional<uint64_t> msys::CMaterialManager::GetDerivedTextureKey(const std::vector<std::string> &sourceTextures, const std::string &converter)
+{
+	auto key = ImportCache::ComputeKey(nullptr, 0, converter);
+	for(auto &tex : sourceTextures) {
+		auto filePath = m_textureManager->FindAssetFilePath(tex);
+		if(!filePath.has_value())
+			return {};
+		auto path = m_textureManager->GetRootDirectory();
+		path += util::Path::CreateFile(*filePath);
+		auto texKey = ImportCache::ComputeFileKey(path.GetString(), converter);
+		if(!texKey.has_value())
+			return {};
+		key = ImportCache::CombineKeys(key, *texKey);
+	}
+	return key;
+}
+std::string msys::CMaterialManager::GetDerivedTextureName(uint64_t key, const std::string &suffix) { return "derived/" + ImportCache::KeyToString(key) + '_' + suffix; }
+std::optional<std::vector<std::string>> msys::CMaterialManager::FindDerivedTextures(uint64_t key) const
+{
+	auto entry = get_import_cache().Find(key);
+	if(!entry.has_value())
+		return {};
+	return std::move(entry->assets);
+}
+bool msys::CMaterialManager::StoreDerivedTextures(uint64_t key, const std::vector<std::string> &textures)
+{
+	ImportCache::Entry entry {};
+	entry.assets = textures;
+	entry.files.reserve(textures.size());
+	for(auto &tex : textures)
+		entry.files.push_back(GetDerivedTextureFilePath(tex));
+	return get_import_cache().Store(key, std::move(entry));
+}
+std::string msys::CMaterialManager::GetDerivedTextureFilePath(const std::string &texture) { return (GetImportDirectory() + ('/' + texture)).GetString() + ".dds"; }
+void msys::CMaterialManager::UpdateMaterialLoadHandles()
+{
+	// Handles may be added by the completion callbacks
+	auto handles = std::move(m_materialLoadHandles);
+	m_materialLoadHandles.clear();
+	for(auto &handle : handles) {
+		if(!handle->Update())
+			m_materialLoadHandles.push_back(handle);
+	}
+}
+void msys::CMaterialManager::ReloadQueuedShaders()
+{
 	if(!m_reloadShaderQueue.empty()) {
 		std::unordered_set<Material *> traversed;
 		while(!m_reloadShaderQueue.empty()) {
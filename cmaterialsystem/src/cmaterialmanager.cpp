@@ -93,6 +93,9 @@ Material *CMaterialManager::CreateMaterial(const std::string *identifier, const
 		root = std::make_shared<ds::Block>(*dataSettings);
 	}
 	CMaterial *mat = nullptr; // auto *mat = CreateMaterial<CMaterial>(shaderManager.PreRegisterShader(shader),root); // Claims ownership of 'root' and frees the memory at destruction
+	// Materials are constructed by msys::CMaterialManager, which this manager has no access to
+	if(mat == nullptr)
+		return nullptr;
 	mat->SetLoaded(true);
 	mat->SetName(matId);
 	AddMaterial(matId, *mat);
@@ -111,9 +114,9 @@ void CMaterialManager::ReloadMaterialShaders()
 	if(m_shaderHandler == nullptr)
 		return;
 	GetContext().WaitIdle();
-	for(auto &hMat : m_materials) {
-		if(hMat.IsValid() && hMat->IsLoaded() == true)
-			m_shaderHandler(hMat.get());
+	for(auto &record : m_materials) {
+		if(record.material->IsLoaded() == true)
+			m_shaderHandler(record.material);
 	}
 }
 
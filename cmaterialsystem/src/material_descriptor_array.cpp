@@ -67,7 +67,7 @@ std::optional<prosper::IBuffer::SubBufferIndex> MaterialDescriptorArrayManager::
 			matRenderInfo.albedoTextureArrayIndex = *index;
 	}
 
-	auto *pAlbedoMap = loaded ? mat.GetTextureInfo("albedo_map") : errTex;
+	auto *pAlbedoMap = loaded ? mat.GetTextureInfo(msys::key_atoms::AlbedoMap) : errTex;
 	if(pAlbedoMap && pAlbedoMap->texture) {
 		auto index = AddItem(*std::static_pointer_cast<Texture>(pAlbedoMap->texture));
 		if(index.has_value())
@@ -81,14 +81,14 @@ std::optional<prosper::IBuffer::SubBufferIndex> MaterialDescriptorArrayManager::
 			matRenderInfo.normalTextureArrayIndex = *index;
 	}
 
-	pNormalMap = loaded ? mat.GetTextureInfo("normal_map") : errTex;
+	pNormalMap = loaded ? mat.GetTextureInfo(msys::key_atoms::NormalMap) : errTex;
 	if(pNormalMap && pNormalMap->texture) {
 		auto index = AddItem(*std::static_pointer_cast<Texture>(pNormalMap->texture));
 		if(index.has_value())
 			matRenderInfo.normalTextureArrayIndex = *index;
 	}
 
-	auto *pRmaMap = loaded ? mat.GetTextureInfo("rma_map") : errTex;
+	auto *pRmaMap = loaded ? mat.GetTextureInfo(msys::key_atoms::RmaMap) : errTex;
 	if(pRmaMap && pRmaMap->texture) {
 		auto index = AddItem(*std::static_pointer_cast<Texture>(pRmaMap->texture));
 		if(index.has_value())
@@ -0,0 +1,118 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "material_load_handle.hpp"
+#include "cmaterial_manager2.hpp"
+#include "cmaterial.h"
+#include "texturemanager/texture_manager2.hpp"
+#include <material_load_batch.hpp>
+#include <datasystem.h>
+#include <unordered_set>
+#include <thread>
+
+msys::MaterialLoadHandle::MaterialLoadHandle(CMaterialManager &manager, const std::string &path, const std::shared_ptr<MaterialLoadBatch> &batch, const OnComplete &onComplete)
+    : m_manager {manager}, m_path {path}, m_batch {batch}, m_onComplete {onComplete}, m_future {m_promise.get_future().share()}
+{
+}
+
+void msys::MaterialLoadHandle::Wait()
+{
+	while(!IsDone()) {
+		m_manager.Poll();
+		if(!IsDone())
+			std::this_thread::yield();
+	}
+}
+
+static void collect_texture_names(const ds::Block &block, std::vector<std::string> &outNames, std::unordered_set<std::string> &traversed)
+{
+	auto *data = block.GetData();
+	if(!data)
+		return;
+	for(auto &pair : *data) {
+		auto &val = pair.second;
+		if(val->IsBlock()) {
+			collect_texture_names(static_cast<ds::Block &>(*val), outNames, traversed);
+			continue;
+		}
+		if(val->IsContainer() || typeid(*val) != typeid(ds::Texture))
+			continue;
+		auto &name = static_cast<ds::Texture &>(*val).GetValue().name;
+		if(name.empty() || !traversed.insert(name).second)
+			continue;
+		outNames.push_back(name);
+	}
+}
+
+void msys::MaterialLoadHandle::BeginTextureLoads()
+{
+	m_state = State::LoadingTextures;
+	auto data = m_material->GetDataBlock();
+	if(data) {
+		std::vector<std::string> names;
+		std::unordered_set<std::string> traversed;
+		collect_texture_names(*data, names, traversed);
+		m_textures.reserve(names.size());
+		for(auto &name : names)
+			m_textures.push_back({name, TextureState::Pending});
+	}
+	// The textures are usually already being preloaded by the material itself, this makes sure all of them have been requested
+	static_cast<CMaterial &>(*m_material).LoadTextures(true, true);
+}
+
+void msys::MaterialLoadHandle::UpdateTextureStates()
+{
+	auto &texManager = m_manager.GetTextureManager();
+	for(auto &texStatus : m_textures) {
+		if(texStatus.state != TextureState::Pending)
+			continue;
+		auto *asset = texManager.FindCachedAsset(texStatus.name);
+		if(asset) {
+			auto tex = TextureManager::GetAssetObject(*asset);
+			if(tex && tex->IsError())
+				texStatus.state = TextureState::Failed;
+			else if(tex && tex->IsLoaded())
+				texStatus.state = TextureState::Loaded;
+			// Otherwise the texture is still waiting to be uploaded (see TextureManager::Poll(const FinalizationBudget&))
+		}
+		else if(!texManager.IsAssetLoadPending(texStatus.name))
+			texStatus.state = TextureState::Failed; // The load job has failed, or the file doesn't exist
+		if(texStatus.state == TextureState::Loaded)
+			++m_numLoadedTextures;
+		else if(texStatus.state == TextureState::Failed)
+			++m_numFailedTextures;
+	}
+}
+
+bool msys::MaterialLoadHandle::Update()
+{
+	if(IsDone())
+		return true;
+	if(m_state == State::LoadingMaterial) {
+		if(!m_batch->Poll())
+			return false;
+		m_material = m_batch->GetMaterials().front();
+		m_batch = nullptr;
+		if(!m_material || m_material->IsError()) {
+			SetDone(State::Failed);
+			return true;
+		}
+		BeginTextureLoads();
+	}
+	UpdateTextureStates();
+	if(m_numLoadedTextures + m_numFailedTextures < m_textures.size())
+		return false;
+	// Assign the textures to the material, they're all cached at this point
+	static_cast<CMaterial &>(*m_material).LoadTextures(false);
+	SetDone(State::Complete);
+	return true;
+}
+
+void msys::MaterialLoadHandle::SetDone(State state)
+{
+	m_state = state;
+	m_promise.set_value((state == State::Complete) ? m_material : nullptr);
+	if(m_onComplete)
+		m_onComplete(*this);
+}
@@ -4,6 +4,25 @@
 
 #include "texturemanager/load/handlers/format_handler_gli.hpp"
 #include <sharedutils/util_ifile.hpp>
+#include <cstring>
+
+// DDS files store the data of all layers and mipmaps as one block after the header, in the same order as gli does.
+// Returns 0 if that's not the case for the file, or if it's not a DDS file.
+static uint64_t get_dds_data_offset(const std::vector<uint8_t> &data, const gli::texture &texture)
+{
+	constexpr size_t DDS_HEADER_SIZE = 128; // Including the magic number
+	constexpr size_t DDS_HEADER_DX10_SIZE = 20;
+	constexpr size_t DDS_FOURCC_OFFSET = 84;
+	if(data.size() < DDS_HEADER_SIZE || std::memcmp(data.data(), "DDS ", 4) != 0)
+		return 0;
+	// Only 2D textures and cubemaps are supported by the texture manager
+	if((texture.target() != gli::TARGET_2D && texture.target() != gli::TARGET_CUBE) || texture.layers() != 1)
+		return 0;
+	uint64_t offset = DDS_HEADER_SIZE;
+	if(std::memcmp(data.data() + DDS_FOURCC_OFFSET, "DX10", 4) == 0)
+		offset += DDS_HEADER_DX10_SIZE;
+	return (data.size() - offset == texture.size()) ? offset : 0;
+}
 
 bool msys::TextureFormatHandlerGli::GetDataPtr(uint32_t layer, uint32_t mipmapIdx, void **outPtr, size_t &outSize)
 {
@@ -15,8 +34,32 @@ bool msys::TextureFormatHandlerGli::GetDataPtr(uint32_t layer, uint32_t mipmapId
 	return *outPtr != nullptr;
 }
 
+bool msys::TextureFormatHandlerGli::LoadDataFromCachedHeader(InputTextureInfo &texInfo)
+{
+	auto &cachedTexInfo = *m_cachedInputTextureInfo;
+	if(cachedTexInfo.dataOffset == 0)
+		return false;
+	auto cubemap = umath::is_flag_set(cachedTexInfo.flags, InputTextureInfo::Flags::CubemapBit);
+	gli::texture texture {cubemap ? gli::TARGET_CUBE : gli::TARGET_2D, static_cast<gli::format>(cachedTexInfo.format), gli::extent3d {static_cast<int>(cachedTexInfo.width), static_cast<int>(cachedTexInfo.height), 1}, 1, cubemap ? 6u : 1u,
+	  cachedTexInfo.mipmapCount};
+	// The file size would have changed along with the header
+	if(texture.empty() || m_file->GetSize() != cachedTexInfo.dataOffset + texture.size())
+		return false;
+	m_file->Seek(cachedTexInfo.dataOffset, ufile::IFile::Whence::Set);
+	if(m_file->Read(texture.data(), texture.size()) != texture.size())
+		return false;
+	m_texture = std::move(texture);
+	texInfo = cachedTexInfo;
+	return true;
+}
+
 bool msys::TextureFormatHandlerGli::LoadData(InputTextureInfo &texInfo)
 {
+	if(m_cachedInputTextureInfo.has_value()) {
+		if(LoadDataFromCachedHeader(texInfo))
+			return true;
+		m_file->Seek(0, ufile::IFile::Whence::Set);
+	}
 	auto sz = m_file->GetSize();
 	if(sz == 0)
 		return false;
@@ -34,5 +77,6 @@ bool msys::TextureFormatHandlerGli::LoadData(InputTextureInfo &texInfo)
 	texInfo.layerCount = isCubemap ? 6 : 1;
 	texInfo.mipmapCount = m_texture.levels();
 	texInfo.format = static_cast<prosper::Format>(m_texture.format());
+	texInfo.dataOffset = get_dds_data_offset(data, m_texture);
 	return true;
 }
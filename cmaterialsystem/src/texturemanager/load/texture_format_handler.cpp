@@ -7,3 +7,8 @@
 msys::ITextureFormatHandler::ITextureFormatHandler(util::IAssetManager &assetManager) : util::IAssetFormatHandler {assetManager} {}
 
 bool msys::ITextureFormatHandler::LoadData() { return LoadData(m_inputTextureInfo); }
+void msys::ITextureFormatHandler::ReleaseData()
+{
+	m_file = nullptr;
+	ClearData();
+}
@@ -39,3 +39,12 @@ msys::TextureLoader::TextureLoader(util::IAssetManager &assetManager, prosper::I
 	setup_sampler_mipmap_mode(samplerCreateInfo, TextureMipmapMode::Ignore);
 	m_textureSamplerNoMipmap = context.CreateSampler(samplerCreateInfo);
 }
+
+std::unique_ptr<util::IAssetProcessor> msys::TextureLoader::CreateAssetProcessor(const std::string &identifier, const std::string &ext, std::unique_ptr<util::IAssetFormatHandler> &&formatHandler)
+{
+	auto processor = util::TAssetFormatLoader<TextureProcessor>::CreateAssetProcessor(identifier, ext, std::move(formatHandler));
+	auto &texProcessor = static_cast<TextureProcessor &>(*processor);
+	texProcessor.identifier = identifier;
+	texProcessor.formatExtension = ext;
+	return processor;
+}
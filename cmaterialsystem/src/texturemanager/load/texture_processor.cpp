@@ -12,6 +12,9 @@
 #include <image/prosper_image.hpp>
 #include <image/prosper_sampler.hpp>
 #include <util_image_buffer.hpp>
+#include <image_metadata_cache.hpp>
+#include <sharedutils/util_file.h>
+#include <sharedutils/util_string.h>
 
 // If enabled, images and textures will be initialized on a separate thread.
 // Should not be enabled at the moment, as some parts of the memory allocation in Anvil do
@@ -62,10 +65,81 @@ bool msys::TextureProcessor::FinalizeImage(prosper::IPrContext &context)
 
 msys::TextureProcessor::TextureProcessor(util::AssetFormatLoader &loader, std::unique_ptr<util::IAssetFormatHandler> &&handler) : util::FileAssetProcessor {loader, std::move(handler)} {}
 
+void msys::TextureProcessor::ReleaseData()
+{
+	buffers.clear();
+	m_tmpImgBuffers.clear();
+	cpuImageConverter = nullptr;
+	texture = nullptr;
+	convertedImage = nullptr;
+	image = nullptr;
+	GetHandler().ReleaseData();
+}
+
+bool msys::TextureProcessor::CheckCancelled()
+{
+	if(!is_load_cancelled(cancellationToken))
+		return false;
+	ReleaseData();
+	return true;
+}
+
+static msys::ITextureFormatHandler::InputTextureInfo to_input_texture_info(const msys::ImageMetadata &metadata)
+{
+	using Flags = msys::ITextureFormatHandler::InputTextureInfo::Flags;
+	msys::ITextureFormatHandler::InputTextureInfo texInfo {};
+	texInfo.width = metadata.width;
+	texInfo.height = metadata.height;
+	texInfo.format = static_cast<prosper::Format>(metadata.format);
+	texInfo.layerCount = metadata.layerCount;
+	texInfo.mipmapCount = metadata.mipmapCount;
+	umath::set_flag(texInfo.flags, Flags::CubemapBit, umath::is_flag_set(metadata.flags, msys::ImageMetadata::Flags::CubemapBit));
+	umath::set_flag(texInfo.flags, Flags::SrgbBit, umath::is_flag_set(metadata.flags, msys::ImageMetadata::Flags::SrgbBit));
+	texInfo.dataOffset = metadata.dataOffset;
+	return texInfo;
+}
+static msys::ImageMetadata to_image_metadata(const msys::ITextureFormatHandler::InputTextureInfo &texInfo)
+{
+	using Flags = msys::ITextureFormatHandler::InputTextureInfo::Flags;
+	msys::ImageMetadata metadata {};
+	metadata.width = texInfo.width;
+	metadata.height = texInfo.height;
+	metadata.format = umath::to_integral(texInfo.format);
+	metadata.layerCount = texInfo.layerCount;
+	metadata.mipmapCount = texInfo.mipmapCount;
+	metadata.flags = msys::ImageMetadata::Flags::HeaderBit;
+	if(umath::is_flag_set(texInfo.flags, Flags::CubemapBit))
+		metadata.flags |= msys::ImageMetadata::Flags::CubemapBit;
+	if(umath::is_flag_set(texInfo.flags, Flags::SrgbBit))
+		metadata.flags |= msys::ImageMetadata::Flags::SrgbBit;
+	metadata.dataOffset = texInfo.dataOffset;
+	return metadata;
+}
+
 bool msys::TextureProcessor::Load()
 {
-	if(!static_cast<msys::ITextureFormatHandler &>(*handler).LoadData())
+	if(CheckCancelled())
 		return false;
+	auto &texHandler = static_cast<msys::ITextureFormatHandler &>(*handler);
+	if(!identifier.empty()) {
+		// The header information from the last time the file was loaded, if it hasn't changed since
+		auto metadata = get_image_metadata_cache().Find(identifier);
+		if(metadata.has_value() && umath::is_flag_set(metadata->flags, ImageMetadata::Flags::HeaderBit))
+			texHandler.SetCachedInputTextureInfo(to_input_texture_info(*metadata));
+	}
+	if(!texHandler.LoadData() || CheckCancelled())
+		return false;
+	// Determined here, so the size of a deferred texture is known without having to access the (possibly lazily decoded) data on the main thread
+	m_dataSize = ComputeDataSize();
+	if(!identifier.empty() && !formatExtension.empty()) {
+		// Remember the header information, so it doesn't have to be read from the file again the next time around
+		auto metadata = to_image_metadata(texHandler.GetInputTextureInfo());
+		auto filePath = identifier;
+		std::string ext;
+		if(!ufile::get_extension(filePath, &ext) || !ustring::compare<std::string>(ext, formatExtension, false))
+			filePath += '.' + formatExtension;
+		get_image_metadata_cache().Store(identifier, filePath, metadata);
+	}
 	auto &loader = GetLoader();
 #if ENABLE_MT_IMAGE_INITIALIZATION == 1
 	return !loader.DoesAllowMultiThreadedGpuResourceAllocation() || PrepareImage(loader.GetContext());
@@ -74,12 +148,57 @@ bool msys::TextureProcessor::Load()
 #endif
 }
 bool msys::TextureProcessor::Finalize()
+{
+	if(CheckCancelled())
+		return false;
+	if(GetLoader().ShouldDeferFinalization()) {
+		m_finalizationDeferred = true;
+		return true;
+	}
+	return FinalizeResources();
+}
+std::unique_ptr<msys::TextureProcessor> msys::TextureProcessor::CreateDeferredProcessor()
+{
+	auto processor = std::make_unique<TextureProcessor>(m_loader, std::move(handler));
+	processor->mipmapMode = mipmapMode;
+	processor->image = std::move(image);
+	processor->convertedImage = std::move(convertedImage);
+	processor->texture = std::move(texture);
+	processor->imageFormat = imageFormat;
+	processor->mipmapCount = mipmapCount;
+	processor->targetGpuConversionFormat = targetGpuConversionFormat;
+	processor->cpuImageConverter = std::move(cpuImageConverter);
+	processor->buffers = std::move(buffers);
+	processor->identifier = identifier;
+	processor->formatExtension = formatExtension;
+	processor->cancellationToken = cancellationToken;
+	processor->m_generateMipmaps = m_generateMipmaps;
+	processor->m_tmpImgBuffers = std::move(m_tmpImgBuffers);
+	processor->m_dataSize = m_dataSize;
+	return processor;
+}
+uint64_t msys::TextureProcessor::ComputeDataSize()
+{
+	auto &texHandler = GetHandler();
+	auto &inputTexInfo = texHandler.GetInputTextureInfo();
+	uint64_t size = 0;
+	for(auto layer = decltype(inputTexInfo.layerCount) {0u}; layer < inputTexInfo.layerCount; ++layer) {
+		for(auto mipmap = decltype(inputTexInfo.mipmapCount) {0u}; mipmap < inputTexInfo.mipmapCount; ++mipmap) {
+			void *data;
+			size_t dataSize;
+			if(texHandler.GetDataPtr(layer, mipmap, &data, dataSize))
+				size += dataSize;
+		}
+	}
+	return size;
+}
+bool msys::TextureProcessor::FinalizeResources()
 {
 	auto &loader = GetLoader();
 #if ENABLE_MT_IMAGE_INITIALIZATION == 1
-	return (loader.DoesAllowMultiThreadedGpuResourceAllocation() || PrepareImage(loader.GetContext())) && FinalizeImage(loader.GetContext());
+	return (loader.DoesAllowMultiThreadedGpuResourceAllocation() || PrepareImage(loader.GetContext())) && !CheckCancelled() && FinalizeImage(loader.GetContext());
 #else
-	return PrepareImage(loader.GetContext()) && FinalizeImage(loader.GetContext());
+	return PrepareImage(loader.GetContext()) && !CheckCancelled() && FinalizeImage(loader.GetContext());
 #endif
 }
 
@@ -17,11 +17,9 @@
 
 VFilePtr TextureManager::OpenTextureFile(const std::string &fpath)
 {
-	if(m_texFileHandler != nullptr) {
-		auto f = m_texFileHandler(fpath);
-		if(f != nullptr)
-			return f;
-	}
+	auto f = CallTextureFileHandler(fpath);
+	if(f != nullptr)
+		return f;
 	return filemanager::open_file(fpath.c_str(), filemanager::FileMode::Read | filemanager::FileMode::Binary);
 }
 
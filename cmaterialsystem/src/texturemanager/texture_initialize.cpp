@@ -482,7 +482,7 @@ void TextureManager::FinalizeTexture(TextureQueueItem &item)
 	if(texture->IsIndexed() == false && item.addToCache) {
 		if(m_textures.size() == m_textures.capacity())
 			m_textures.reserve(m_textures.size() * 1.5f + 100);
-		m_textures.push_back(texture);
+		AddTexture(texture);
 		texture->SetFlags(texture->GetFlags() | Texture::Flags::Indexed);
 	}
 	texture->SetFlags(texture->GetFlags() | Texture::Flags::Loaded);
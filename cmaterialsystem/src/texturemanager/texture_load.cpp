@@ -74,7 +74,10 @@ bool TextureManager::Load(prosper::IPrContext &context, const std::string &cache
 	if(bLoadInstantly == false)
 		dontCache = false; // This flag only makes sense if we're loading instantly
 	auto found = false;
-	auto path = translate_image_path(cacheName, type, (bAbsolutePath == false) ? (MaterialManager::GetRootMaterialLocation() + "/") : "", m_texFileHandler, &found);
+	std::function<VFilePtr(const std::string &)> fileHandler = nullptr;
+	if(HasTextureFileHandler())
+		fileHandler = [this](const std::string &fpath) { return CallTextureFileHandler(fpath); };
+	auto path = translate_image_path(cacheName, type, (bAbsolutePath == false) ? (MaterialManager::GetRootMaterialLocation() + "/") : "", fileHandler, &found);
 	if(found == false) {
 		// Attempt to determine by file extension
 		auto f = std::dynamic_pointer_cast<VFilePtrInternalReal>(optFile);
@@ -110,16 +113,8 @@ bool TextureManager::Load(prosper::IPrContext &context, const std::string &cache
 	}
 	//if(bReload == true)
 	//	bLoadInstantly = true;
-	if(bLoadInstantly == false && m_threadLoad == nullptr) {
-		m_activeMutex = std::make_unique<std::mutex>();
-		m_bThreadActive = true;
-		m_loadMutex = std::make_unique<std::mutex>();
-
-		m_queueVar = std::make_unique<std::condition_variable>();
-		m_queueMutex = std::make_unique<std::mutex>();
-		m_lockMutex = std::make_unique<std::mutex>();
-		m_threadLoad = std::make_unique<std::thread>(std::bind(&TextureManager::TextureThread, this));
-	}
+	if(bLoadInstantly == false && m_loadThreads.empty())
+		StartLoadThreads();
 	std::unique_ptr<TextureQueueItem> item = nullptr;
 	if(type == TextureType::DDS || type == TextureType::KTX)
 		item = std::make_unique<TextureQueueItemSurface>(type);
@@ -164,7 +159,7 @@ bool TextureManager::Load(prosper::IPrContext &context, const std::string &cache
 	}
 	item->context = context.shared_from_this();
 
-	m_texturesTmp.push_back(std::static_pointer_cast<Texture>(text));
+	m_texturesTmp[item->cache].push_back(std::static_pointer_cast<Texture>(text));
 	if(outTexture != nullptr)
 		*outTexture = text;
 	if(!FileManager::Exists(path.c_str()))
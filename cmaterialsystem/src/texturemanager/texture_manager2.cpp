@@ -12,10 +12,12 @@
 #include "texturemanager/load/handlers/format_handler_vtf.hpp"
 #include "texturemanager/load/texture_processor.hpp"
 #include "texturemanager/texture.h"
+#include <asset_load_manifest.hpp>
 #include <sharedutils/util.h>
 #include <sharedutils/util_file.h>
 #include <fsys/filesystem.h>
 #include <fsys/ifile.hpp>
+#include <algorithm>
 
 // #define ENABLE_VERBOSE_OUTPUT
 
@@ -66,12 +68,98 @@ msys::TextureManager::~TextureManager() { m_error = nullptr; }
 void msys::TextureManager::InitializeProcessor(util::IAssetProcessor &processor)
 {
 	auto &txProcessor = static_cast<TextureProcessor &>(processor);
-	txProcessor.mipmapMode = static_cast<TextureLoadInfo &>(*txProcessor.loadInfo).mipmapMode;
+	auto &loadInfo = static_cast<TextureLoadInfo &>(*txProcessor.loadInfo);
+	txProcessor.mipmapMode = loadInfo.mipmapMode;
+	txProcessor.cancellationToken = m_loadQueue.CreateCancellationToken(ToCacheIdentifier(txProcessor.identifier));
+	if(m_loadRecorder && !umath::is_flag_set(loadInfo.flags, util::AssetLoadFlags::DontCache))
+		m_loadRecorder->Record(txProcessor.identifier, loadInfo.flags, loadInfo.mipmapMode);
+}
+
+uint32_t msys::TextureManager::PreloadManifest(const AssetLoadManifest &manifest)
+{
+	uint32_t numQueued = 0;
+	auto &entries = manifest.GetEntries();
+	// Assets that have been requested earlier get a higher priority, so they're dispatched first
+	auto priority = static_cast<AssetLoadQueue::Priority>(std::min<size_t>(entries.size(), std::numeric_limits<AssetLoadQueue::Priority>::max()));
+	for(auto &entry : entries) {
+		auto entryPriority = priority;
+		if(priority > 0)
+			--priority;
+		if(FindCachedAsset(entry.identifier))
+			continue;
+		auto loadInfo = std::make_unique<TextureLoadInfo>(entry.flags);
+		loadInfo->mipmapMode = entry.mipmapMode;
+		QueueAsset(entry.identifier, entryPriority, std::move(loadInfo));
+		++numQueued;
+	}
+	return numQueued;
+}
+
+void msys::TextureManager::QueueAsset(const std::string &path, AssetLoadQueue::Priority priority, std::unique_ptr<TextureLoadInfo> &&loadInfo)
+{
+	if(!loadInfo)
+		loadInfo = std::make_unique<TextureLoadInfo>();
+	m_loadQueue.Push(ToCacheIdentifier(path), priority, std::move(loadInfo));
+}
+bool msys::TextureManager::SetAssetLoadPriority(const std::string &path, AssetLoadQueue::Priority priority) { return m_loadQueue.SetPriority(ToCacheIdentifier(path), priority); }
+bool msys::TextureManager::CancelAssetLoad(const std::string &path)
+{
+	auto identifier = ToCacheIdentifier(path);
+	if(m_loadQueue.Remove(identifier))
+		return true;
+	if(!m_loadQueue.Cancel(identifier))
+		return false;
+	m_cancelledLoads.insert(identifier);
+	return true;
+}
+bool msys::TextureManager::IsAssetLoadPending(const std::string &path) const
+{
+	auto identifier = ToCacheIdentifier(path);
+	return m_loadQueue.GetPriority(identifier).has_value() || m_loadQueue.IsInFlight(identifier);
+}
+uint32_t msys::TextureManager::DispatchQueuedAssets(uint32_t maxCount)
+{
+	uint32_t numDispatched = 0;
+	while(numDispatched < maxCount) {
+		auto request = m_loadQueue.Pop();
+		if(!request)
+			break;
+		if(FindCachedAsset(request->identifier))
+			continue;
+		// The result of the cancelled job may not have been cleared yet (see ClearCancelledLoads). The identifier is kept
+		// until the job has completed, in case it hasn't yet.
+		if(m_cancelledLoads.count(request->identifier) > 0)
+			ClearCachedResult(GetIdentifierHash(request->identifier));
+		PreloadAsset(request->identifier, util::static_unique_pointer_cast<util::AssetLoadInfo, TextureLoadInfo>(std::move(request->loadInfo)));
+		++numDispatched;
+	}
+	return numDispatched;
+}
+void msys::TextureManager::ClearCancelledLoads()
+{
+	// Cancelled jobs fail, so their results have to be cleared, otherwise later requests for the same asset would fail as well
+	for(auto &identifier : m_loadQueue.PollCompletedCancellations()) {
+		if(m_cancelledLoads.erase(identifier) > 0)
+			ClearCachedResult(GetIdentifierHash(identifier));
+	}
 }
 
 util::AssetObject msys::TextureManager::InitializeAsset(const util::Asset &asset, const util::AssetLoadJob &job)
 {
 	auto &texProcessor = *static_cast<TextureProcessor *>(job.processor.get());
+	if(texProcessor.IsFinalizationDeferred()) {
+		// The GPU resources will be created by a later poll
+		auto texWrapper = std::make_shared<Texture>(m_context);
+		texWrapper->SetFlags(Texture::Flags::Indexed);
+		texWrapper->SetName(job.identifier);
+		PendingFinalization pending {};
+		pending.texture = texWrapper;
+		pending.processor = texProcessor.CreateDeferredProcessor();
+		pending.byteSize = pending.processor->GetDataSize();
+		m_pendingFinalizationBytes += pending.byteSize;
+		m_pendingFinalizations.push_back(std::move(pending));
+		return texWrapper;
+	}
 	auto texture = texProcessor.texture;
 
 	auto texWrapper = std::make_shared<Texture>(m_context, texture);
@@ -87,6 +175,110 @@ util::AssetObject msys::TextureManager::InitializeAsset(const util::Asset &asset
 	return texWrapper;
 }
 
+bool msys::TextureManager::ReloadAssetAsync(const std::string &path)
+{
+	auto identifier = ToCacheIdentifier(path);
+	auto *asset = FindCachedAsset(identifier);
+	if(!asset)
+		return false;
+	std::weak_ptr<Texture> texture = GetAssetObject(*asset);
+	auto loadInfo = std::make_unique<TextureLoadInfo>(util::AssetLoadFlags::IgnoreCache | util::AssetLoadFlags::DontCache);
+	loadInfo->onLoaded = [this, texture](util::Asset &newAsset) {
+		// The new texture may not have been finalized yet (see Poll(const FinalizationBudget&)), so it is only applied by ApplyPendingReloads
+		m_pendingReloads.push_back({texture, GetAssetObject(newAsset)});
+	};
+	PreloadAsset(identifier, std::move(loadInfo));
+	return true;
+}
+
+void msys::TextureManager::ApplyPendingReloads()
+{
+	for(auto it = m_pendingReloads.begin(); it != m_pendingReloads.end();) {
+		auto texture = it->texture.lock();
+		auto &newTexture = it->newTexture;
+		if(texture && newTexture && !newTexture->IsLoaded() && !newTexture->IsError()) {
+			++it;
+			continue;
+		}
+		if(texture && newTexture && newTexture->IsLoaded() && newTexture->HasValidVkTexture()) {
+			auto flags = texture->GetFlags();
+			umath::set_flag(flags, Texture::Flags::SRGB, newTexture->HasFlag(Texture::Flags::SRGB));
+			texture->SetFlags(flags);
+			// Materials that use the texture are notified through Texture::CallOnVkTextureChanged
+			texture->SetVkTexture(newTexture->GetVkTexture());
+		}
+		it = m_pendingReloads.erase(it);
+	}
+}
+
+void msys::TextureManager::Poll()
+{
+	util::TFileAssetManager<Texture, TextureLoadInfo>::Poll();
+	ClearCancelledLoads();
+	if(!m_pendingFinalizations.empty())
+		FinalizePending({});
+	ApplyPendingReloads();
+}
+
+msys::FinalizationStats msys::TextureManager::Poll(const FinalizationBudget &budget)
+{
+	auto &loader = static_cast<TextureLoader &>(GetLoader());
+	loader.SetDeferFinalization(true);
+	util::TFileAssetManager<Texture, TextureLoadInfo>::Poll();
+	loader.SetDeferFinalization(false);
+	ClearCancelledLoads();
+	auto stats = FinalizePending(budget);
+	ApplyPendingReloads();
+	return stats;
+}
+
+msys::FinalizationStats msys::TextureManager::FinalizePending(const FinalizationBudget &budget)
+{
+	FinalizationStats stats {};
+	auto tStart = std::chrono::steady_clock::now();
+	while(!m_pendingFinalizations.empty()) {
+		if(stats.finalizedCount > 0) {
+			if(budget.bytes.has_value() && stats.finalizedBytes + m_pendingFinalizations.front().byteSize > *budget.bytes)
+				break;
+			if(budget.time.has_value() && std::chrono::steady_clock::now() - tStart >= *budget.time)
+				break;
+		}
+		auto pending = std::move(m_pendingFinalizations.front());
+		m_pendingFinalizations.pop_front();
+		m_pendingFinalizationBytes -= pending.byteSize;
+		auto texture = pending.texture.lock();
+		if(!texture)
+			continue; // Texture has been released in the meantime
+		FinalizeTexture(*texture, *pending.processor);
+		++stats.finalizedCount;
+		stats.finalizedBytes += pending.byteSize;
+	}
+	stats.pendingCount = static_cast<uint32_t>(m_pendingFinalizations.size());
+	stats.pendingBytes = m_pendingFinalizationBytes;
+	return stats;
+}
+
+void msys::TextureManager::FinalizeTexture(Texture &texture, TextureProcessor &processor)
+{
+	if(is_load_cancelled(processor.cancellationToken) || !processor.FinalizeResources() || !processor.texture) {
+		processor.ReleaseData();
+		// The texture is still flagged as loaded, so anything that is waiting for it is notified
+		texture.AddFlags(Texture::Flags::Loaded | Texture::Flags::Error);
+		if(m_error)
+			texture.SetVkTexture(m_error->GetVkTexture());
+		// SetVkTexture only runs the callbacks if the texture has actually changed
+		texture.RunOnLoadedCallbacks();
+		return;
+	}
+	auto flags = texture.GetFlags();
+	umath::set_flag(flags, Texture::Flags::SRGB, processor.texture->GetImage().IsSrgb());
+	flags |= Texture::Flags::Loaded;
+	flags &= ~Texture::Flags::Error;
+	texture.SetFlags(flags);
+	// This also runs the pending on-loaded callbacks of the texture
+	texture.SetVkTexture(processor.texture);
+}
+
 std::shared_ptr<Texture> msys::TextureManager::GetErrorTexture() { return m_error; }
 
 void msys::TextureManager::SetErrorTexture(const std::shared_ptr<Texture> &tex)
@@ -5,30 +5,62 @@
 #include "texturemanager/texturemanager.h"
 #include "texturemanager/texturequeue.h"
 #include "textureinfo.h"
+#include <mathutil/umath.h>
 
-bool TextureManager::CheckTextureThreadLocked()
+void TextureManager::StartLoadThreads()
 {
-	bool bContinue = false;
-	m_activeMutex->lock();
-	if(m_bThreadActive == false)
-		bContinue = true;
-	m_activeMutex->unlock();
-	if(bContinue == false) {
-		m_loadMutex->lock();
-		bContinue = !m_loadQueue.empty();
-		m_loadMutex->unlock();
+	if(m_loadMutex == nullptr) {
+		m_loadMutex = std::make_unique<std::mutex>();
+		m_queueVar = std::make_unique<std::condition_variable>();
 	}
-	return bContinue;
+	auto numThreads = m_loadThreadCount;
+	if(numThreads == 0)
+		numThreads = umath::max(std::thread::hardware_concurrency(), 1u);
+	m_loadMutex->lock();
+	m_bThreadActive = true;
+	m_loadMutex->unlock();
+	m_loadThreads.reserve(numThreads);
+	for(auto i = decltype(numThreads) {0u}; i < numThreads; ++i)
+		m_loadThreads.push_back(std::thread {&TextureManager::TextureThread, this});
 }
 
-void TextureManager::Update()
+void TextureManager::StopLoadThreads()
 {
-	if(m_queueMutex == NULL)
+	if(m_loadThreads.empty())
 		return;
-	m_queueMutex->lock();
-	if(!m_initQueue.empty()) {
-		auto item = m_initQueue.front();
-		m_initQueue.pop();
+	m_loadMutex->lock();
+	m_bThreadActive = false;
+	m_loadMutex->unlock();
+	m_queueVar->notify_all();
+	for(auto &thread : m_loadThreads)
+		thread.join();
+	m_loadThreads.clear();
+}
+
+void TextureManager::SetLoadThreadCount(uint32_t count)
+{
+	if(count == m_loadThreadCount)
+		return;
+	m_loadThreadCount = count;
+	if(m_loadThreads.empty())
+		return;
+	StopLoadThreads();
+	StartLoadThreads();
+}
+uint32_t TextureManager::GetLoadThreadCount() const { return m_loadThreadCount; }
+
+void TextureManager::SetUpdateBudget(uint32_t maxTextures, std::chrono::microseconds maxTime)
+{
+	m_updateBudgetTextures = maxTextures;
+	m_updateBudgetTime = maxTime;
+}
+
+uint32_t TextureManager::Update()
+{
+	uint32_t n = 0;
+	auto tStart = std::chrono::steady_clock::now();
+	std::shared_ptr<TextureQueueItem> item = nullptr;
+	while(m_initQueue.Pop(item)) {
 		if(!item->initialized)
 			InitializeImage(*item);
 
@@ -42,8 +74,14 @@ void TextureManager::Update()
 		}*/
 		if(item->mipmapid == -1)
 			FinalizeTexture(*item);
+		item = nullptr;
+		++n;
+		if(m_updateBudgetTextures > 0 && n >= m_updateBudgetTextures)
+			break;
+		if(m_updateBudgetTime.count() > 0 && std::chrono::steady_clock::now() - tStart >= m_updateBudgetTime)
+			break;
 	}
-	m_queueMutex->unlock();
+	return n;
 }
 
 void TextureManager::PushOnLoadQueue(std::unique_ptr<TextureQueueItem> item)
@@ -56,35 +94,35 @@ void TextureManager::PushOnLoadQueue(std::unique_ptr<TextureQueueItem> item)
 
 std::shared_ptr<Texture> TextureManager::GetQueuedTexture(TextureQueueItem &item, bool bErase)
 {
-	std::shared_ptr<Texture> texture = nullptr;
-	for(unsigned int i = 0; i < m_texturesTmp.size(); i++) {
-		if(m_texturesTmp[i]->GetName() == item.cache) {
-			texture = m_texturesTmp[i];
-			if(bErase == true)
-				m_texturesTmp.erase(m_texturesTmp.begin() + i);
-			break;
-		}
+	auto it = m_texturesTmp.find(item.cache);
+	if(it == m_texturesTmp.end())
+		return nullptr;
+	// Items with the same name are finalized in the order they were queued
+	auto &textures = it->second;
+	auto texture = textures.front();
+	if(bErase == true) {
+		textures.erase(textures.begin());
+		if(textures.empty())
+			m_texturesTmp.erase(it);
 	}
 	return texture;
 }
 
 void TextureManager::TextureThread()
 {
-	std::unique_lock<std::mutex> lock(*m_lockMutex);
-	auto n = std::bind(&TextureManager::CheckTextureThreadLocked, this);
+	// Every load thread pulls the next item from the shared load queue, decodes it on the CPU and hands it over
+	// to the main thread (see Update), which is responsible for creating the GPU resources.
 	for(;;) {
-		m_queueVar->wait(lock, n);
-		m_activeMutex->lock();
-		if(m_bThreadActive == false) {
-			m_activeMutex->unlock();
-			break;
+		std::shared_ptr<TextureQueueItem> item = nullptr;
+		{
+			std::unique_lock<std::mutex> lock(*m_loadMutex);
+			m_queueVar->wait(lock, [this]() { return m_bThreadActive == false || !m_loadQueue.empty(); });
+			if(m_bThreadActive == false)
+				break;
+			item = std::move(m_loadQueue.front());
+			m_loadQueue.pop();
+			++m_numBusyThreads;
 		}
-		m_activeMutex->unlock();
-		m_loadMutex->lock();
-		auto item = std::move(m_loadQueue.front());
-		m_loadQueue.pop();
-		m_bBusy = true;
-		m_loadMutex->unlock();
 		if(item->mipmapid == -1) {
 			InitializeTextureData(*item);
 			//if(InitializeMipmaps(item) == true)
@@ -92,9 +130,8 @@ void TextureManager::TextureThread()
 		}
 		else
 			; //GenerateNextMipmap(item);
-		m_queueMutex->lock();
-		m_initQueue.push(item);
-		m_bBusy = false;
-		m_queueMutex->unlock();
+		m_initQueue.Push(std::move(item));
+		// Has to happen after the item has been pushed, otherwise HasWork could miss it
+		--m_numBusyThreads;
 	}
 }
@@ -40,17 +40,14 @@ bool TextureManager::HasWork()
 {
 	if(m_bThreadActive == false)
 		return false;
-	if(m_bBusy)
-		return true;
 	m_loadMutex->lock();
-	auto hasLoadItem = (m_loadQueue.empty() == false);
+	// The busy count has to be read under the same lock as the queue, otherwise an item that has just been
+	// taken off the load queue could be missed
+	auto hasLoadItem = (m_loadQueue.empty() == false) || m_numBusyThreads > 0;
 	m_loadMutex->unlock();
 	if(hasLoadItem)
 		return true;
-	m_queueMutex->lock();
-	auto hasInitItem = (m_initQueue.empty() == false);
-	m_queueMutex->unlock();
-	return hasInitItem;
+	return m_initQueue.IsEmpty() == false;
 }
 
 void TextureManager::WaitForTextures()
@@ -87,20 +84,40 @@ const std::vector<std::weak_ptr<prosper::ISampler>> &TextureManager::GetCustomSa
 
 prosper::IPrContext &TextureManager::GetContext() const { return *m_wpContext.lock(); }
 
-void TextureManager::SetTextureFileHandler(const std::function<VFilePtr(const std::string &)> &fileHandler) { m_texFileHandler = fileHandler; }
+void TextureManager::SetTextureFileHandler(const std::function<VFilePtr(const std::string &)> &fileHandler)
+{
+	std::scoped_lock lock {m_texFileHandlerMutex};
+	m_texFileHandler = fileHandler;
+}
+bool TextureManager::HasTextureFileHandler()
+{
+	std::scoped_lock lock {m_texFileHandlerMutex};
+	return m_texFileHandler != nullptr;
+}
+VFilePtr TextureManager::CallTextureFileHandler(const std::string &fpath)
+{
+	std::scoped_lock lock {m_texFileHandlerMutex};
+	return (m_texFileHandler != nullptr) ? m_texFileHandler(fpath) : nullptr;
+}
 
 std::shared_ptr<Texture> TextureManager::CreateTexture(const std::string &name, prosper::Texture &texture)
 {
-	auto it = std::find_if(m_textures.begin(), m_textures.end(), [&name](std::shared_ptr<Texture> &tex) { return (tex->GetName() == name) ? true : false; });
-	if(it != m_textures.end())
-		return *it;
+	auto idx = m_textureIndex.Find(name);
+	if(idx)
+		return m_textures[*idx];
 	auto tex = std::make_shared<Texture>(GetContext());
 	tex->SetVkTexture(texture.shared_from_this());
 	tex->SetName(name);
-	m_textures.push_back(tex);
+	AddTexture(tex);
 	return tex;
 }
 
+void TextureManager::AddTexture(const std::shared_ptr<Texture> &texture)
+{
+	m_textures.push_back(texture);
+	m_textureIndex.Add(texture->GetName(), m_textures.size() - 1);
+}
+
 std::shared_ptr<Texture> TextureManager::GetErrorTexture() { return m_error; }
 
 /*std::shared_ptr<Texture> TextureManager::CreateTexture(prosper::Context &context,const std::string &name,unsigned int w,unsigned int h)
@@ -134,21 +151,8 @@ std::shared_ptr<Texture> TextureManager::GetErrorTexture() { return m_error; }
 
 std::shared_ptr<Texture> TextureManager::GetTexture(const std::string &name)
 {
-	auto nameNoExt = name;
-	static std::vector<std::string> supportedExtensions;
-	if(supportedExtensions.empty()) {
-		auto &supportedFormats = MaterialManager::get_supported_image_formats();
-		supportedExtensions.reserve(supportedFormats.size());
-		for(auto &format : supportedFormats)
-			supportedExtensions.push_back(format.extension);
-	}
-	ufile::remove_extension_from_filename(nameNoExt, supportedExtensions);
-	auto it = std::find_if(m_textures.begin(), m_textures.end(), [&nameNoExt](const std::shared_ptr<Texture> &tex) {
-		auto texNoExt = tex->GetName();
-		ufile::remove_extension_from_filename(texNoExt, supportedExtensions);
-		return FileManager::ComparePath(nameNoExt, texNoExt);
-	});
-	return (it != m_textures.end()) ? *it : nullptr;
+	auto idx = m_textureIndex.FindByPath(name);
+	return idx ? m_textures[*idx] : nullptr;
 }
 
 void TextureManager::ReloadTextures(const LoadInfo &loadInfo)
@@ -171,15 +175,22 @@ void TextureManager::ReloadTexture(uint32_t texId, const LoadInfo &loadInfo)
 	auto sampler = tex->GetSampler();
 	auto ptr = std::static_pointer_cast<void>(texture->shared_from_this());
 	Load(context, texture->GetName(), loadInfo, &ptr);
+	// The new texture has the same name, so the index entries for texId remain valid
 	texture = std::static_pointer_cast<Texture>(ptr);
 }
 
 void TextureManager::ReloadTexture(Texture &texture, const LoadInfo &loadInfo)
 {
-	auto it = std::find_if(m_textures.begin(), m_textures.end(), [&texture](const std::shared_ptr<Texture> &texOther) { return (texOther.get() == &texture) ? true : false; });
-	if(it == m_textures.end())
+	auto idx = m_textureIndex.Find(texture.GetName());
+	if(idx && m_textures[*idx].get() == &texture) {
+		ReloadTexture(*idx, loadInfo);
+		return;
+	}
+	// Not the indexed texture for this name
+	auto itTex = std::find_if(m_textures.begin(), m_textures.end(), [&texture](const std::shared_ptr<Texture> &texOther) { return (texOther.get() == &texture) ? true : false; });
+	if(itTex == m_textures.end())
 		return;
-	ReloadTexture(it - m_textures.begin(), loadInfo);
+	ReloadTexture(itTex - m_textures.begin(), loadInfo);
 }
 
 void TextureManager::SetErrorTexture(const std::shared_ptr<Texture> &tex)
@@ -196,23 +207,18 @@ void TextureManager::SetErrorTexture(const std::shared_ptr<Texture> &tex)
 
 uint32_t TextureManager::Clear()
 {
-	if(m_threadLoad != nullptr) {
-		m_activeMutex->lock();
-		m_bThreadActive = false;
-		m_activeMutex->unlock();
-		m_queueVar->notify_one();
-		m_threadLoad->join();
-		m_threadLoad = nullptr;
-		m_queueVar = nullptr;
-		m_queueMutex = nullptr;
-		m_lockMutex = nullptr;
-		m_activeMutex = nullptr;
-		m_loadMutex = nullptr;
-	}
+	StopLoadThreads();
+	m_queueVar = nullptr;
+	m_loadMutex = nullptr;
 	while(!m_loadQueue.empty())
 		m_loadQueue.pop();
+	std::shared_ptr<TextureQueueItem> item;
+	while(m_initQueue.Pop(item))
+		;
 	auto n = m_textures.size();
 	m_textures.clear();
+	m_textureIndex.Clear();
+	m_texturesTmp.clear();
 	m_textureSampler = nullptr;
 	m_textureSamplerNoMipmap = nullptr;
 	m_error = nullptr;
@@ -258,15 +264,14 @@ std::shared_ptr<Texture> TextureManager::FindTexture(const std::string &imgFile,
 			pathCache = pathCache.substr(0, ext);
 	}
 	*cache = pathCache;
-	const auto find = [&pathCache](decltype(m_textures.front()) &tex) { return (tex->GetName() == pathCache) ? true : false; };
-	auto itTex = std::find_if(m_textures.begin(), m_textures.end(), find);
-	if(itTex != m_textures.end())
-		return *itTex;
-	auto itTmp = std::find_if(m_texturesTmp.begin(), m_texturesTmp.end(), find);
+	auto idx = m_textureIndex.Find(pathCache);
+	if(idx)
+		return m_textures[*idx];
+	auto itTmp = m_texturesTmp.find(pathCache);
 	if(itTmp != m_texturesTmp.end()) {
 		if(bLoading != nullptr)
 			*bLoading = true;
-		return *itTmp;
+		return itTmp->second.front();
 	}
 	return nullptr;
 }
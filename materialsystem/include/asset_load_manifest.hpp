@@ -0,0 +1,50 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef __MSYS_ASSET_LOAD_MANIFEST_HPP__
+#define __MSYS_ASSET_LOAD_MANIFEST_HPP__
+
+#include "matsysdefinitions.h"
+#include "texture_type.h"
+#include <sharedutils/asset_loader/asset_load_info.hpp>
+#include <unordered_set>
+#include <mutex>
+#include <vector>
+#include <string>
+#include <cinttypes>
+
+namespace msys {
+	// Ordered list of the assets that have been requested from an asset manager during a session (e.g. while loading a level).
+	// A manifest that has been recorded (see MaterialManager::SetLoadRecorder) can be replayed on the next run to queue all of the
+	// assets up front (see MaterialManager::PreloadManifest), instead of loading them one by one once they're requested.
+	// Every identifier is only recorded once, at the position where it was requested first. Recording is thread-safe.
+#pragma warning(push)
+#pragma warning(disable : 4251)
+	class DLLMATSYS AssetLoadManifest {
+	  public:
+		static constexpr uint32_t FORMAT_VERSION = 1;
+		struct DLLMATSYS Entry {
+			std::string identifier;
+			util::AssetLoadFlags flags = util::AssetLoadFlags::None;
+			// Only used for textures
+			TextureMipmapMode mipmapMode = TextureMipmapMode::LoadOrGenerate;
+		};
+		AssetLoadManifest() = default;
+		bool Load(const std::string &fileName);
+		bool Save(const std::string &fileName) const;
+
+		void Record(const std::string &identifier, util::AssetLoadFlags flags, TextureMipmapMode mipmapMode = TextureMipmapMode::LoadOrGenerate);
+		void Clear();
+		// Returns a copy of the entries in the order in which they have been requested
+		std::vector<Entry> GetEntries() const;
+		size_t GetEntryCount() const;
+	  private:
+		mutable std::mutex m_mutex;
+		std::vector<Entry> m_entries;
+		std::unordered_set<std::string> m_identifiers;
+	};
+#pragma warning(pop)
+};
+
+#endif
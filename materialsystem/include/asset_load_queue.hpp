@@ -0,0 +1,81 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef __MSYS_ASSET_LOAD_QUEUE_HPP__
+#define __MSYS_ASSET_LOAD_QUEUE_HPP__
+
+#include "matsysdefinitions.h"
+#include <sharedutils/asset_loader/asset_load_info.hpp>
+#include <unordered_map>
+#include <optional>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <mutex>
+#include <map>
+#include <vector>
+#include <cinttypes>
+
+namespace msys {
+	using AssetLoadCancellationToken = std::shared_ptr<std::atomic<bool>>;
+	// Asset requests that have not been handed to the asset loader yet. Once a job has been queued in the loader its priority
+	// is fixed, so the asset managers keep requests here until they're dispatched, which allows changing their priority or dropping them.
+	// Requests with a higher priority are dispatched first, requests with the same priority in the order in which they have been added.
+	// The queue also keeps track of the cancellation tokens of jobs that have already been dispatched, which the asset processors
+	// check in between their load stages.
+#pragma warning(push)
+#pragma warning(disable : 4251)
+	class DLLMATSYS AssetLoadQueue {
+	  public:
+		using Priority = int32_t;
+		struct DLLMATSYS Request {
+			std::string identifier;
+			Priority priority = 0;
+			std::unique_ptr<util::AssetLoadInfo> loadInfo;
+		};
+		AssetLoadQueue() = default;
+		// If a request with the same identifier already exists, its priority and load info are replaced
+		void Push(const std::string &identifier, Priority priority, std::unique_ptr<util::AssetLoadInfo> &&loadInfo);
+		bool SetPriority(const std::string &identifier, Priority priority);
+		std::optional<Priority> GetPriority(const std::string &identifier) const;
+		bool Remove(const std::string &identifier);
+		// Removes and returns the request with the highest priority
+		std::optional<Request> Pop();
+		size_t GetSize() const;
+		void Clear();
+
+		// Creates the token for a job that is about to be handed to the loader. Any previous token for the same identifier is replaced.
+		AssetLoadCancellationToken CreateCancellationToken(const std::string &identifier);
+		// Returns true if a job with the specified identifier was still in flight
+		bool Cancel(const std::string &identifier);
+		// Returns true if a job with the specified identifier has been handed to the loader and hasn't been completed or cancelled yet
+		bool IsInFlight(const std::string &identifier) const;
+		// Returns the identifiers of all cancelled jobs that have been completed since the last call
+		std::vector<std::string> PollCompletedCancellations();
+	  private:
+		struct Key {
+			Priority priority = 0;
+			uint64_t sequence = 0;
+		};
+		struct KeyCompare {
+			bool operator()(const Key &a, const Key &b) const { return (a.priority != b.priority) ? (a.priority > b.priority) : (a.sequence < b.sequence); }
+		};
+		struct Entry {
+			Key key;
+			std::unique_ptr<util::AssetLoadInfo> loadInfo;
+		};
+		mutable std::mutex m_mutex;
+		std::map<Key, std::string, KeyCompare> m_order;
+		std::unordered_map<std::string, Entry> m_requests;
+		std::unordered_map<std::string, std::weak_ptr<std::atomic<bool>>> m_cancellationTokens;
+		std::unordered_map<std::string, std::weak_ptr<std::atomic<bool>>> m_cancelledTokens;
+		uint64_t m_nextSequence = 0;
+		static constexpr size_t MIN_PRUNE_THRESHOLD = 64;
+		size_t m_pruneThreshold = MIN_PRUNE_THRESHOLD;
+	};
+#pragma warning(pop)
+	inline bool is_load_cancelled(const AssetLoadCancellationToken &token) { return token && token->load(std::memory_order_relaxed); }
+};
+
+#endif
@@ -0,0 +1,22 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef __MSYS_DATA_VALUE_TYPE_HPP__
+#define __MSYS_DATA_VALUE_TYPE_HPP__
+
+#include "matsysdefinitions.h"
+#include <cinttypes>
+
+namespace ds {
+	class Base;
+};
+namespace msys {
+	enum class DataValueType : uint8_t { Block = 0, Container, String, Int, Float, Bool, Vector, Vector2, Vector4, Color, Texture, Unknown, Count };
+	// Determines the type of a data system value with a single type lookup, which allows code that has to handle
+	// all value types (e.g. serialization) to use a switch instead of a chain of dynamic_casts.
+	DLLMATSYS DataValueType get_data_value_type(const ds::Base &value);
+	DLLMATSYS const char *get_data_value_type_name(DataValueType type);
+};
+
+#endif
@@ -0,0 +1,86 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef __MSYS_DIRECTORY_INDEX_HPP__
+#define __MSYS_DIRECTORY_INDEX_HPP__
+
+#include "matsysdefinitions.h"
+#include <unordered_map>
+#include <shared_mutex>
+#include <atomic>
+#include <optional>
+#include <functional>
+#include <vector>
+#include <string>
+#include <cinttypes>
+
+namespace msys {
+	// In-memory index of all files with a known extension in the material directory (including mounted addons), which maps
+	// lower-case, extension-less paths to the formats that are available for them. This allows resolving paths without an
+	// extension with a single lookup, instead of probing the disk for every possible extension.
+	// The index has to be kept up to date manually (see Build, AddFile and RemoveFile). As long as it hasn't been built,
+	// it is considered inactive and callers should fall back to checking the disk.
+#pragma warning(push)
+#pragma warning(disable : 4251)
+	class DLLMATSYS DirectoryIndex {
+	  public:
+		// Each path can be associated with at most this many different extensions
+		static constexpr uint32_t MAX_EXTENSIONS = 32;
+		using ExtensionMask = uint32_t;
+
+		DirectoryIndex() = default;
+		// Only files with a registered extension are indexed, the extensions should be registered before the index is built
+		void RegisterExtension(const std::string &ext);
+		// Recursively scans the specified directory (relative to the program directory). The paths of the index are relative to this directory.
+		void Build(const std::string &rootDirectory);
+		bool IsActive() const { return m_active; }
+		void Clear();
+
+		void AddFile(const std::string &path);
+		void RemoveFile(const std::string &path);
+		// Returns the mask of all available extensions for the path (without extension), or 0 if there are no files for it
+		ExtensionMask FindExtensions(const std::string &path) const;
+		// Returns the first extension of the list that is available for the path (without extension)
+		std::optional<std::string> FindFirstExtension(const std::string &path, const std::vector<std::string> &extensionsInOrderOfPreference) const;
+		// The path has to include the extension
+		bool Exists(const std::string &path) const;
+		size_t GetEntryCount() const;
+
+		static std::string NormalizePath(const std::string &path);
+	  private:
+		std::optional<uint32_t> FindExtensionIndex(const std::string &ext) const;
+		// Splits the normalized path into the extension-less path and the extension index
+		bool SplitPath(const std::string &normalizedPath, std::string &outPath, uint32_t &outExtIndex) const;
+		mutable std::shared_mutex m_mutex;
+		std::vector<std::string> m_extensions;
+		std::unordered_map<std::string, ExtensionMask> m_entries;
+		std::atomic<bool> m_active = false;
+	};
+#pragma warning(pop)
+
+	// Index of the material root directory. The extensions of all supported material and image formats are registered automatically.
+	DLLMATSYS DirectoryIndex &get_material_directory_index();
+	// Builds the index of the material root directory, unless it has already been built in this session. This is called by
+	// msys::MaterialManager on creation. The index is not persisted between sessions, because a stored copy can't be validated
+	// against the mounted addons without scanning them again. Addons that are mounted later require the index to be rebuilt.
+	DLLMATSYS void initialize_material_directory_index();
+
+	// Has to be called whenever a material or image file has been created or removed, so that cached lookups are repeated
+	// (see MaterialManager::ResolveMaterialPath). The path is relative to the material root directory. If the directory index is
+	// active, it is updated accordingly.
+	DLLMATSYS void notify_material_file_created(const std::string &path);
+	DLLMATSYS void notify_material_file_removed(const std::string &path);
+	// Converts a path relative to the program directory (e.g. "addons/converted/materials/x.pmat") to a path relative to the
+	// material root directory. Returns std::nullopt if the path is not located in a material directory.
+	DLLMATSYS std::optional<std::string> to_material_relative_path(const std::string &filePath);
+	// Incremented by every call to notify_material_file_created and notify_material_file_removed
+	DLLMATSYS uint32_t get_material_file_generation();
+	// The listener is called with the path of every file that has been created or removed, on the thread that has reported the change.
+	// Returns an identifier for remove_material_file_listener.
+	using MaterialFileListener = std::function<void(const std::string &)>;
+	DLLMATSYS uint32_t add_material_file_listener(const MaterialFileListener &listener);
+	DLLMATSYS void remove_material_file_listener(uint32_t id);
+};
+
+#endif
@@ -0,0 +1,89 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef __MSYS_FILE_WATCHER_HPP__
+#define __MSYS_FILE_WATCHER_HPP__
+
+#include "matsysdefinitions.h"
+#include <unordered_map>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <cinttypes>
+
+namespace msys {
+	struct DLLMATSYS FileWatcherSettings {
+		std::chrono::milliseconds debounceWindow {250};
+		// Only used by the polling fallback
+		std::chrono::milliseconds pollInterval {1'000};
+		bool forcePolling = false;
+	};
+	// Recursively watches a directory for changed files on a background thread. On Linux inotify is used, on other platforms
+	// (or if inotify is unavailable, e.g. because the watch limit has been reached) the directory is scanned periodically instead.
+	// Bursts of changes to the same file (e.g. an image editor writing a file in several steps) are coalesced: A change is only
+	// reported once the file hasn't changed for the duration of the debounce window.
+#pragma warning(push)
+#pragma warning(disable : 4251)
+	class DLLMATSYS FileWatcher {
+	  public:
+		enum class ChangeType : uint8_t { Added = 0, Modified, Removed };
+		struct DLLMATSYS Change {
+			// Relative to the watched directory, with forward slashes
+			std::string path;
+			ChangeType type = ChangeType::Modified;
+		};
+		// rootDirectory has to be an absolute path. Returns nullptr if the directory doesn't exist.
+		static std::unique_ptr<FileWatcher> Create(const std::string &rootDirectory, const FileWatcherSettings &settings = {});
+		~FileWatcher();
+		const std::string &GetRootDirectory() const { return m_rootDirectory; }
+		bool IsPolling() const { return m_polling; }
+
+		// Returns all changes whose debounce window has expired. Has to be called periodically (e.g. once per frame).
+		std::vector<Change> Poll();
+		size_t GetPendingChangeCount() const;
+	  private:
+		FileWatcher(const std::string &rootDirectory, const FileWatcherSettings &settings);
+		void Run();
+		void AddChange(std::string path, ChangeType type);
+
+		void RunPolling();
+		struct FileState {
+			int64_t modificationTime = 0;
+			uint64_t fileSize = 0;
+		};
+		void Scan(std::unordered_map<std::string, FileState> &outFiles) const;
+#ifdef __linux__
+		bool InitializeInotify();
+		bool AddWatch(const std::string &relDir, bool reportFiles);
+		// Returns false if inotify can no longer be used
+		bool ReadInotifyEvents();
+		void ReleaseInotify();
+		int m_inotifyFd = -1;
+		std::unordered_map<int, std::string> m_watchDirectories;
+#endif
+		std::string m_rootDirectory;
+		FileWatcherSettings m_settings;
+		std::atomic<bool> m_polling = false;
+
+		struct PendingChange {
+			ChangeType type;
+			std::chrono::steady_clock::time_point lastChangeTime;
+		};
+		mutable std::mutex m_mutex;
+		std::unordered_map<std::string, PendingChange> m_pendingChanges;
+
+		std::mutex m_runMutex;
+		std::condition_variable m_runCondition;
+		bool m_running = true;
+		std::thread m_thread;
+	};
+#pragma warning(pop)
+};
+
+#endif
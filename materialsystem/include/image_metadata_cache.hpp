@@ -0,0 +1,80 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef __MSYS_IMAGE_METADATA_CACHE_HPP__
+#define __MSYS_IMAGE_METADATA_CACHE_HPP__
+
+#include "matsysdefinitions.h"
+#include <mathutil/umath.h>
+#include <unordered_map>
+#include <shared_mutex>
+#include <optional>
+#include <string>
+#include <cinttypes>
+
+namespace msys {
+	struct DLLMATSYS ImageMetadata {
+		enum class Flags : uint32_t {
+			None = 0u,
+			CubemapBit = 1u,
+			SrgbBit = CubemapBit << 1u,
+			// Set if the entry has been created by a texture format handler. Otherwise only the size is known and the remaining fields are defaults.
+			HeaderBit = SrgbBit << 1u
+		};
+		uint32_t width = 0;
+		uint32_t height = 0;
+		uint32_t format = 0; // prosper::Format, the material system itself doesn't depend on prosper
+		uint32_t layerCount = 1;
+		uint32_t mipmapCount = 1;
+		Flags flags = Flags::None;
+		// Offset of the image data in the file, if the data of all layers and mipmaps follows the header as one contiguous block (0 otherwise)
+		uint64_t dataOffset = 0;
+	};
+
+	// Persistent cache of image header information, so that image files don't have to be opened just to determine
+	// their size, and texture format handlers can skip parsing the header. Entries are keyed by the normalized texture path (relative to the material root directory) and
+	// are considered stale as soon as the modification time or size of the image file has changed. Each entry is only checked
+	// against the file once per session, changes after that have to be reported through Invalidate (see MaterialManager::StartFileWatcher).
+#pragma warning(push)
+#pragma warning(disable : 4251)
+	class DLLMATSYS ImageMetadataCache {
+	  public:
+		static constexpr const char *FILE_NAME = "image_metadata.cache";
+		static constexpr uint32_t FORMAT_VERSION = 3;
+		ImageMetadataCache() = default;
+		bool Load(const std::string &fileName);
+		bool Save(const std::string &fileName);
+		bool IsLoaded() const { return m_loaded; }
+		bool IsDirty() const;
+
+		// Returns the cached metadata if the image file hasn't changed since it was cached.
+		// outFilePath receives the path to the image file (including the extension), relative to the material root directory.
+		std::optional<ImageMetadata> Find(const std::string &texturePath, std::string *outFilePath = nullptr) const;
+		// Entries with the full header information will not be replaced by size-only information for the same file
+		void Store(const std::string &texturePath, const std::string &filePath, const ImageMetadata &metadata);
+		void Invalidate(const std::string &texturePath);
+		void Clear();
+		size_t GetEntryCount() const;
+	  private:
+		struct Entry {
+			std::string filePath;
+			uint64_t modificationTime = 0;
+			uint64_t fileSize = 0;
+			ImageMetadata metadata {};
+			// Set once the entry has been compared against the file in this session, not saved
+			bool validated = false;
+		};
+		mutable std::shared_mutex m_mutex;
+		std::unordered_map<std::string, Entry> m_entries;
+		bool m_dirty = false;
+		bool m_loaded = false;
+	};
+#pragma warning(pop)
+
+	DLLMATSYS ImageMetadataCache &get_image_metadata_cache();
+	DLLMATSYS std::string get_image_metadata_cache_path();
+};
+REGISTER_BASIC_BITWISE_OPERATORS(msys::ImageMetadata::Flags)
+
+#endif
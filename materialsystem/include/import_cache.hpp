@@ -0,0 +1,77 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef __MSYS_IMPORT_CACHE_HPP__
+#define __MSYS_IMPORT_CACHE_HPP__
+
+#include "matsysdefinitions.h"
+#include <unordered_map>
+#include <shared_mutex>
+#include <optional>
+#include <vector>
+#include <string>
+#include <cinttypes>
+
+namespace msys {
+	// Persistent record of what the importers (VMT, VMAT) have produced. Entries are keyed by a hash of the contents of the
+	// source file(s), the name of the converter and CONVERTER_VERSION, so an import only has to be repeated if the source has
+	// actually changed. This is used both for materials (the produced pmat and the textures it depends on) and for textures that
+	// are generated from other textures (e.g. "_normal", "_rma" or "_albedo"), which can then be shared by all materials that
+	// use the same source textures.
+	// Every file that was produced by an import is hashed when the entry is stored, and the hash is verified whenever the entry
+	// is looked up, so an entry is discarded if one of its files has been modified or removed in the meantime.
+	// Note: A material entry does not track the contents of the source textures it references, only the produced files.
+#pragma warning(push)
+#pragma warning(disable : 4251)
+	class DLLMATSYS ImportCache {
+	  public:
+		static constexpr const char *FILE_NAME = "import.cache";
+		static constexpr uint32_t FORMAT_VERSION = 2;
+		// Has to be incremented whenever the output of one of the converters changes, which invalidates all existing entries
+		static constexpr uint32_t CONVERTER_VERSION = 1;
+		struct DLLMATSYS Entry {
+			// Names of the produced assets, in the order the importer expects them (e.g. texture names that can be referenced by materials)
+			std::vector<std::string> assets;
+			// Files that were written by the import, relative to the program directory. The first file is the primary output.
+			// An entry is only valid as long as all of these files exist and haven't been modified.
+			std::vector<std::string> files;
+			// Content hashes of the files, assigned by Store
+			std::vector<uint64_t> fileHashes;
+		};
+		static uint64_t ComputeKey(const void *data, size_t size, const std::string &converter);
+		// Returns std::nullopt if the file couldn't be read. The path is relative to the program directory.
+		static std::optional<uint64_t> ComputeFileKey(const std::string &filePath, const std::string &converter);
+		// Combines the keys of multiple sources (e.g. all input textures of a conversion shader)
+		static uint64_t CombineKeys(uint64_t key0, uint64_t key1);
+		// Hexadecimal representation of the key, which can be used to name files that are produced for it
+		static std::string KeyToString(uint64_t key);
+
+		ImportCache() = default;
+		bool Load(const std::string &fileName);
+		bool Save(const std::string &fileName);
+		bool IsLoaded() const { return m_loaded; }
+		bool IsDirty() const;
+
+		std::optional<Entry> Find(uint64_t key) const;
+		// Returns false if one of the files of the entry couldn't be read, in which case nothing is stored
+		bool Store(uint64_t key, Entry entry);
+		// Makes the primary output of a cached import available as outFilePath, copying it if it was produced for a different
+		// output path (e.g. because the same source file exists under a different name). Returns false on a cache miss.
+		bool Restore(uint64_t key, const std::string &outFilePath);
+		void Invalidate(uint64_t key);
+		void Clear();
+		size_t GetEntryCount() const;
+	  private:
+		mutable std::shared_mutex m_mutex;
+		std::unordered_map<uint64_t, Entry> m_entries;
+		bool m_dirty = false;
+		bool m_loaded = false;
+	};
+#pragma warning(pop)
+
+	DLLMATSYS ImportCache &get_import_cache();
+	DLLMATSYS std::string get_import_cache_path();
+};
+
+#endif
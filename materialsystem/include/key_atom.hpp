@@ -0,0 +1,57 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef __MSYS_KEY_ATOM_HPP__
+#define __MSYS_KEY_ATOM_HPP__
+
+#include "matsysdefinitions.h"
+#include <string>
+#include <cinttypes>
+#include <limits>
+#include <vector>
+
+namespace msys {
+	// Small integer handle for an interned material parameter / texture slot key.
+	// Atoms are global and stay valid for the lifetime of the program.
+	using KeyAtom = uint32_t;
+	constexpr KeyAtom INVALID_KEY_ATOM = std::numeric_limits<KeyAtom>::max();
+
+	// Well-known keys are interned in this order at startup, so their atoms are compile-time constants
+	namespace key_atoms {
+		enum : KeyAtom {
+			DiffuseMap = 0,
+			AlbedoMap,
+			AlbedoMap2,
+			AlbedoMap3,
+			NormalMap,
+			EmissionMap,
+			ParallaxMap,
+			AlphaMap,
+			RmaMap,
+			DudvMap,
+			WrinkleStretchMap,
+			WrinkleCompressMap,
+			ExponentMap,
+
+			AlphaMode,
+			AlphaCutoff,
+			ColorFactor,
+			BloomColorFactor,
+
+			Count
+		};
+	};
+
+	// Returns the atom for the specified key, interning it if it doesn't exist yet. Thread-safe.
+	DLLMATSYS KeyAtom intern_key(const std::string &key);
+	// Returns the atom for the specified key, or INVALID_KEY_ATOM if it hasn't been interned.
+	DLLMATSYS KeyAtom find_key_atom(const std::string &key);
+	// Looks up the atoms for all of the specified keys at once (INVALID_KEY_ATOM for keys that haven't been interned).
+	// Returns the number of atoms that existed at the time of the lookup; Any key that is interned later will have an atom >= that number.
+	DLLMATSYS uint32_t find_key_atoms(const std::vector<const std::string *> &keys, std::vector<KeyAtom> &outAtoms);
+	DLLMATSYS const std::string &get_key_name(KeyAtom atom);
+	DLLMATSYS uint32_t get_key_atom_count();
+};
+
+#endif
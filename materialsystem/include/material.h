@@ -7,7 +7,11 @@
 
 #include "matsysdefinitions.h"
 #include "textureinfo.h"
+#include "material_parameter_layout.hpp"
+#include "material_sort_key.hpp"
 #include <optional>
+#include <atomic>
+#include <unordered_map>
 #include <sharedutils/util_path.hpp>
 #include <sharedutils/util_weak_handle.hpp>
 #include <sharedutils/def_handle.h>
@@ -17,6 +21,7 @@
 #include <mathutil/uvec.h>
 
 class Material;
+class MaterialManager;
 namespace msys {
 	using MaterialHandle = std::shared_ptr<Material>;
 	class MaterialManager;
@@ -32,6 +37,7 @@ namespace ds {
 };
 namespace udm {
 	struct AssetData;
+	struct Data;
 };
 #pragma warning(push)
 #pragma warning(disable : 4251)
@@ -61,7 +67,9 @@ class DLLMATSYS Material : public std::enable_shared_from_this<Material> {
 	static const std::string WRINKLE_COMPRESS_MAP_IDENTIFIER;
 	static const std::string EXPONENT_MAP_IDENTIFIER;
 
-	enum class StateFlags : uint32_t { None = 0u, Loaded = 1u, ExecutingOnLoadCallbacks = Loaded << 1u, Error = ExecutingOnLoadCallbacks << 1u, TexturesUpdated = Error << 1u };
+	enum class StateFlags : uint32_t { None = 0u, Loaded = 1u, ExecutingOnLoadCallbacks = Loaded << 1u, Error = ExecutingOnLoadCallbacks << 1u, TexturesUpdated = Error << 1u, ParametersDirty = TexturesUpdated << 1u };
+	// Describes what has changed when the data of another material was assigned with AssignChanges
+	enum class ChangeFlags : uint32_t { None = 0u, ParametersBit = 1u, TexturesBit = ParametersBit << 1u, ShaderBit = TexturesBit << 1u };
 
 	static std::shared_ptr<Material> Create(msys::MaterialManager &manager);
 	static std::shared_ptr<Material> Create(msys::MaterialManager &manager, const util::WeakHandle<util::ShaderInfo> &shaderInfo, const std::shared_ptr<ds::Block> &data);
@@ -80,6 +88,11 @@ class DLLMATSYS Material : public std::enable_shared_from_this<Material> {
 	void SetErrorFlag(bool set);
 	virtual TextureInfo *GetTextureInfo(const std::string &key);
 	const TextureInfo *GetTextureInfo(const std::string &key) const;
+	// Same as above, but resolves the key by its interned atom, without any string hashing or comparisons
+	virtual TextureInfo *GetTextureInfo(msys::KeyAtom key);
+	const TextureInfo *GetTextureInfo(msys::KeyAtom key) const;
+	// Returns the top-level value of the data block with the specified key
+	const std::shared_ptr<ds::Base> &GetValue(msys::KeyAtom key) const;
 
 	const TextureInfo *GetDiffuseMap() const;
 	TextureInfo *GetDiffuseMap();
@@ -110,7 +123,14 @@ class DLLMATSYS Material : public std::enable_shared_from_this<Material> {
 	void SetBloomColorFactor(const Vector4 &bloomColorFactor);
 	std::optional<Vector4> GetBloomColorFactor() const;
 
-	const std::shared_ptr<ds::Block> &GetDataBlock() const;
+	// The data block may be shared with copies of this material (see Copy), use GetMutableDataBlock to modify it
+	std::shared_ptr<const ds::Block> GetDataBlock() const;
+	// Switches to a private data block first if the block is shared with another material, so the returned block can be modified safely
+	const std::shared_ptr<ds::Block> &GetMutableDataBlock();
+	bool IsDataBlockShared() const;
+	// Flattened copy of the data block, laid out according to the parameter schema of the shader.
+	// It's re-compiled lazily if the data block has been modified through GetMutableDataBlock.
+	const msys::CompiledParameters &GetCompiledParameters() const;
 	virtual void SetLoaded(bool b);
 	CallbackHandle CallOnLoaded(const std::function<void(void)> &f) const;
 	bool IsValid() const;
@@ -126,10 +146,26 @@ class DLLMATSYS Material : public std::enable_shared_from_this<Material> {
 	bool SaveLegacy() const;
 
 	MaterialIndex GetIndex() const { return m_index; }
+	// Index of the material in the table of the legacy ::MaterialManager, which is independent of the index assigned by msys::MaterialManager
+	MaterialIndex GetLegacyIndex() const { return m_legacyIndex; }
 	uint32_t GetUpdateIndex() const { return m_updateIndex; }
 
-	virtual void Assign(const Material &other);
+	// Cached render sort data, which is only re-computed when the textures are updated (see UpdateTextures).
+	// The material manager also provides both as packed arrays indexed by the material index.
+	msys::SortKey GetSortKey() const { return m_sortKey; }
+	msys::RenderFeatureFlags GetRenderFeatureFlags() const { return m_renderFeatureFlags; }
+	void UpdateRenderSortData();
 
+	virtual void Assign(const Material &other);
+	// Same as Assign, but only applies what has actually changed (e.g. when the material file has been reloaded).
+	// Texture values which still refer to the same texture keep the texture that has already been loaded, so only
+	// changed texture slots have to be loaded again. Falls back to Assign if the shader has changed.
+	ChangeFlags AssignChanges(const Material &other);
+	// Replaces the specified top-level values of the data block (switching to a private block first, see GetMutableDataBlock)
+	// and updates everything that depends on them, like AssignChanges does.
+	ChangeFlags ApplyValues(const std::unordered_map<std::string, std::shared_ptr<ds::Base>> &values);
+
+	// The copy shares the data block with this material until either of them modifies it
 	virtual std::shared_ptr<Material> Copy() const;
 
 	// Returns true if all textures associated with this material have been fully loaded
@@ -143,17 +179,40 @@ class DLLMATSYS Material : public std::enable_shared_from_this<Material> {
 	void Initialize(const std::string &shader, const std::shared_ptr<ds::Block> &data);
   protected:
 	friend msys::MaterialManager;
+	friend ::MaterialManager;
 	Material(msys::MaterialManager &manager);
 	Material(msys::MaterialManager &manager, const util::WeakHandle<util::ShaderInfo> &shaderInfo, const std::shared_ptr<ds::Block> &data);
 	Material(msys::MaterialManager &manager, const std::string &shader, const std::shared_ptr<ds::Block> &data);
 	virtual void Initialize(const std::shared_ptr<ds::Block> &data);
 	virtual void OnTexturesUpdated();
+	// Returns false if the data of the other material can't be applied incrementally
+	virtual bool CanAssignChanges(const Material &other) const;
+	// Called by AssignChanges after the new data block has been applied
+	virtual void OnChangesAssigned(ChangeFlags changes);
+	virtual uint64_t ComputeTextureSetHash() const;
+	virtual msys::RenderFeatureFlags ComputeRenderFeatureFlags() const;
+	void CompileParameters();
+	// Re-compiles the parameters if the data block has been modified since they were last compiled
+	void UpdateParameters() const;
+	void DetachDataBlock();
+	// Writes UDM data that has been created with Save(udm::AssetData, ...) to the file. Has to be called on the main thread,
+	// since it resolves the file path through the file system and notifies the material directory index.
+	bool WriteUdmData(udm::Data &udmData, const std::string &fileName, std::string &outErr, bool absolutePath);
+	// File that Save(std::string&) writes to
+	void GetDefaultSaveFilePath(std::string &outFileName, bool &outAbsolutePath);
+	// Uses the data block of the other material, until either of them detaches it
+	void ShareDataBlock(const Material &other);
 	void SetIndex(MaterialIndex index) { m_index = index; }
+	void SetLegacyIndex(MaterialIndex index) { m_legacyIndex = index; }
 	uint32_t m_updateIndex = 0;
 	util::WeakHandle<util::ShaderInfo> m_shaderInfo = {};
 	std::unique_ptr<std::string> m_shader;
 	std::string m_name;
 	std::shared_ptr<ds::Block> m_data;
+	// Set if m_data has been shared with another material. The use count of the block alone is not reliable, since
+	// temporary references would cause unnecessary copies.
+	mutable std::atomic<bool> m_dataBlockShared = false;
+	msys::CompiledParameters m_parameters;
 	StateFlags m_stateFlags = StateFlags::None;
 	mutable std::vector<CallbackHandle> m_callOnLoaded;
 	msys::MaterialManager &m_manager;
@@ -166,9 +225,13 @@ class DLLMATSYS Material : public std::enable_shared_from_this<Material> {
 	void *m_userData;
 	void *m_userData2 = nullptr;
 	AlphaMode m_alphaMode = AlphaMode::Opaque;
+	msys::SortKey m_sortKey = 0;
+	msys::RenderFeatureFlags m_renderFeatureFlags = msys::RenderFeatureFlags::None;
 	MaterialIndex m_index = std::numeric_limits<MaterialIndex>::max();
+	MaterialIndex m_legacyIndex = std::numeric_limits<MaterialIndex>::max();
 };
 REGISTER_BASIC_ARITHMETIC_OPERATORS(Material::StateFlags)
+REGISTER_BASIC_BITWISE_OPERATORS(Material::ChangeFlags)
 #pragma warning(pop)
 
 DLLMATSYS std::ostream &operator<<(std::ostream &out, const Material &o);
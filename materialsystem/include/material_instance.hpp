@@ -0,0 +1,59 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef __MSYS_MATERIAL_INSTANCE_HPP__
+#define __MSYS_MATERIAL_INSTANCE_HPP__
+
+#include "matsysdefinitions.h"
+#include "material.h"
+#include <unordered_map>
+#include <memory>
+#include <string>
+
+namespace ds {
+	class Base;
+};
+namespace msys {
+	class MaterialManager;
+	// Variation of a parent material, which only stores the values that differ from the parent (e.g. a tint or a swapped texture).
+	// The instance is rendered through a backing material (a copy of the parent) with its own MaterialIndex, which shares the data block of the parent until
+	// the first override is applied. Overrides are then written into a shallow copy of the parent's block in place, which still refers
+	// to the parent's values for everything else. The overrides are re-applied whenever the parent is reloaded through the material manager.
+#pragma warning(push)
+#pragma warning(disable : 4251)
+	class DLLMATSYS MaterialInstance : public std::enable_shared_from_this<MaterialInstance> {
+	  public:
+		~MaterialInstance() = default;
+		const MaterialHandle &GetParent() const { return m_parent; }
+		// The material that represents this instance, this is what should be used for rendering
+		const MaterialHandle &GetMaterial() const { return m_material; }
+		MaterialIndex GetIndex() const;
+
+		void SetOverride(const std::string &key, const std::shared_ptr<ds::Base> &value);
+		// type has to be a valid data system type (e.g. "float", "vector4" or "texture")
+		void SetOverride(const std::string &key, const std::string &type, const std::string &value);
+		void SetColorFactor(const Vector4 &colorFactor);
+		void SetTexture(const std::string &key, const std::string &texture);
+		void ClearOverride(const std::string &key);
+		void ClearOverrides();
+		bool HasOverride(const std::string &key) const;
+		const std::unordered_map<std::string, std::shared_ptr<ds::Base>> &GetOverrides() const { return m_overrides; }
+
+		// Returns the overridden value, or the value of the parent if it hasn't been overridden
+		const std::shared_ptr<ds::Base> &GetValue(const std::string &key) const;
+
+		// Re-applies the overrides on top of the current data of the parent
+		void Update();
+	  private:
+		friend MaterialManager;
+		MaterialInstance(MaterialManager &manager, const MaterialHandle &parent);
+		MaterialManager &m_manager;
+		MaterialHandle m_parent;
+		MaterialHandle m_material;
+		std::unordered_map<std::string, std::shared_ptr<ds::Base>> m_overrides;
+	};
+#pragma warning(pop)
+};
+
+#endif
@@ -0,0 +1,74 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef __MSYS_MATERIAL_LOAD_BATCH_HPP__
+#define __MSYS_MATERIAL_LOAD_BATCH_HPP__
+
+#include "matsysdefinitions.h"
+#include "material.h"
+#include <future>
+#include <functional>
+#include <optional>
+#include <vector>
+#include <memory>
+#include <string>
+
+namespace ds {
+	class Block;
+};
+namespace msys {
+	class MaterialManager;
+	// Handle to a group of materials that are being loaded through MaterialManager::LoadAssets.
+	// The material files are parsed on worker threads, but the material objects are only created (which may load their textures)
+	// and registered with the manager (which assigns their indices, marks them as loaded and runs the callbacks) by Poll and Wait.
+	// This always happens in the order in which the paths were specified, regardless of the order in which the files have finished parsing.
+	// Poll and Wait must only be called from the thread that created the batch.
+#pragma warning(push)
+#pragma warning(disable : 4251)
+	class DLLMATSYS MaterialLoadBatch {
+	  public:
+		// Called for every material once it has been finalized. The material is nullptr if it could not be loaded.
+		using OnMaterialLoaded = std::function<void(const std::string &, const std::shared_ptr<Material> &)>;
+		~MaterialLoadBatch();
+		// Finalizes all materials that are ready, up to the first one that is still being parsed.
+		// Returns true once all materials of the batch have been finalized.
+		bool Poll();
+		// Blocks until all materials have been parsed and finalizes them
+		void Wait();
+		bool IsComplete() const { return m_numFinalized == m_items.size(); }
+		uint32_t GetFinalizedCount() const { return m_numFinalized; }
+		uint32_t GetCount() const { return static_cast<uint32_t>(m_items.size()); }
+		uint32_t GetFailedCount() const { return m_numFailed; }
+
+		// The materials in the order of the paths that were specified. Materials that failed to load, or haven't been finalized yet are nullptr.
+		const std::vector<std::shared_ptr<Material>> &GetMaterials() const { return m_materials; }
+	  private:
+		friend MaterialManager;
+		struct ParseResult {
+			// The data is nullptr if the file could not be parsed
+			std::string shader;
+			std::shared_ptr<ds::Block> data;
+			std::optional<uint64_t> contentHash {};
+			// The material has to be loaded through the regular load path (e.g. formats that need to be imported first)
+			bool fallback = false;
+		};
+		struct Item {
+			std::string path;
+			std::future<ParseResult> result;
+			std::shared_ptr<Material> cached; // Set if the material had already been loaded
+			bool reload = false;              // The material had already been loaded, but util::AssetLoadFlags::IgnoreCache was specified
+		};
+		MaterialLoadBatch(MaterialManager &manager, OnMaterialLoaded onLoaded);
+		bool FinalizeNext(bool wait);
+		MaterialManager &m_manager;
+		OnMaterialLoaded m_onLoaded;
+		std::vector<Item> m_items;
+		std::vector<std::shared_ptr<Material>> m_materials;
+		uint32_t m_numFinalized = 0;
+		uint32_t m_numFailed = 0;
+	};
+#pragma warning(pop)
+};
+
+#endif
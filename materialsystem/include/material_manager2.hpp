@@ -7,15 +7,41 @@
 
 #include "matsysdefinitions.h"
 #include "material.h"
+#include "material_load_batch.hpp"
+#include "asset_load_manifest.hpp"
+#include "asset_load_queue.hpp"
+#include "file_watcher.hpp"
+#include "slot_map.hpp"
 #include <sharedutils/asset_loader/file_asset_processor.hpp>
 #include <sharedutils/asset_loader/asset_format_loader.hpp>
 #include <sharedutils/asset_loader/file_asset_manager.hpp>
+#include <sharedutils/ctpl_stl.h>
+#include <atomic>
+#include <limits>
+#include <mutex>
+#include <span>
+#include <unordered_set>
 
 namespace udm {
 	struct LinkedPropertyWrapper;
 };
+namespace ufile {
+	struct IFile;
+};
 namespace msys {
 	DLLMATSYS bool udm_to_data_block(udm::LinkedPropertyWrapper &udmDataRoot, ds::Block &root);
+	// Creates a new block which shares all values of the specified block. Only nested blocks and containers are copied.
+	DLLMATSYS std::shared_ptr<ds::Block> shallow_copy_data_block(const ds::Block &block, ds::Settings &dataSettings);
+	// Hash of the keys, types and values of the block (including nested blocks), independent of the order of the values
+	DLLMATSYS uint64_t hash_data_block(const ds::Block &block);
+	// Returns true if both blocks contain the same keys with values of the same types and contents
+	DLLMATSYS bool compare_data_blocks(const ds::Block &a, const ds::Block &b);
+	class MaterialInstance;
+	class MaterialLoadBatch;
+	class MaterialManager;
+	// Parse the material file into a data block. These are thread-safe, as long as the data block is not shared.
+	DLLMATSYS bool load_pmat_data(MaterialManager &manager, std::unique_ptr<ufile::IFile> &&f, std::string &outShader, std::shared_ptr<ds::Block> &outData);
+	DLLMATSYS bool load_wmi_data(ufile::IFile &f, std::string &outShader, std::shared_ptr<ds::Block> &outData);
 	class DLLMATSYS MaterialProcessor : public util::FileAssetProcessor {
 	  public:
 		MaterialProcessor(util::AssetFormatLoader &loader, std::unique_ptr<util::IAssetFormatHandler> &&handler);
@@ -25,6 +51,10 @@ namespace msys {
 		std::shared_ptr<Material> material = nullptr;
 		std::string identifier;
 		std::string formatExtension;
+		// Hash of the shader and data of the material, only set if deduplication is enabled
+		std::optional<uint64_t> contentHash {};
+		// Set if the job has been cancelled through the material manager
+		AssetLoadCancellationToken cancellationToken;
 	};
 	class DLLMATSYS MaterialLoader : public util::TAssetFormatLoader<MaterialProcessor> {
 	  public:
@@ -56,18 +86,110 @@ namespace msys {
 	class DLLMATSYS MaterialManager : public util::TFileAssetManager<Material, MaterialLoadInfo> {
 	  public:
 		static std::shared_ptr<MaterialManager> Create();
-		virtual ~MaterialManager() = default;
+		virtual ~MaterialManager();
 
 		void SetErrorMaterial(Material *mat);
 		Material *GetErrorMaterial() const;
 
 		std::shared_ptr<Material> ReloadAsset(const std::string &path, std::unique_ptr<MaterialLoadInfo> &&loadInfo = nullptr, PreloadResult *optOutResult = nullptr);
+		// Parses the specified material files in parallel on the worker pool (see SetWorkerThreadCount) and returns a handle to the batch,
+		// which has to be polled to create the materials and register them with the manager (see MaterialLoadBatch).
+		// Materials that have already been loaded are re-used, unless util::AssetLoadFlags::IgnoreCache is set.
+		std::shared_ptr<MaterialLoadBatch> LoadAssets(std::span<const std::string> paths, util::AssetLoadFlags flags = util::AssetLoadFlags::None, const MaterialLoadBatch::OnMaterialLoaded &onLoaded = nullptr);
 
 		std::shared_ptr<ds::Settings> CreateDataSettings() const;
 		virtual std::shared_ptr<Material> CreateMaterial(const std::string &shader, const std::shared_ptr<ds::Block> &data);
 		std::shared_ptr<Material> CreateMaterial(const std::string &identifier, const std::string &shader, const std::shared_ptr<ds::Block> &data);
+
+		// Parameter schemas have to be derived from the base schema (see ParameterSchema::Create(const ParameterSchema&)).
+		// Materials that have already been loaded will only pick up the new schema once they're re-initialized.
+		void RegisterParameterSchema(const std::string &shader, const std::shared_ptr<ParameterSchema> &schema);
+		const std::shared_ptr<const ParameterSchema> &FindParameterSchema(const std::string &shader) const;
+		const std::shared_ptr<const ParameterSchema> &GetBaseParameterSchema() const { return m_baseParameterSchema; }
+
+		// Reads the image headers of all textures referenced by the specified materials in parallel and blocks until all of them
+		// have been resolved. Texture sizes are otherwise only determined on demand (see TextureInfo::ResolveSize).
+		void ProbeTextureSizes(const std::vector<Material *> &materials);
+		// Saves the specified materials (see Material::Save) and blocks until all of them have been written. The materials are converted
+		// in parallel, the files are written on the calling thread.
+		// If fileNames is not empty, it must contain one file name per material, otherwise every material is saved to its current location.
+		// Returns the number of materials that were saved successfully. If outErrors is specified, it receives one entry per material (empty on success).
+		uint32_t SaveMaterials(const std::vector<Material *> &materials, const std::vector<std::string> &fileNames = {}, bool absolutePath = false, std::vector<std::string> *outErrors = nullptr);
+		// Number of threads used for batch operations like ProbeTextureSizes or SaveMaterials. 0 = Use the number of hardware threads
+		void SetWorkerThreadCount(uint32_t count);
+		// File format of the materials that are written by the import handlers (e.g. VMT), util::AssetFormatType::Text by default
+		void SetImportFormat(util::AssetFormatType format) { m_importFormat = format; }
+		util::AssetFormatType GetImportFormat() const { return m_importFormat; }
+		// Extension (without the dot) of the materials that are written by the import handlers
+		std::string GetImportFileExtension() const;
+
+		// Every material that is registered with the manager gets a MaterialIndex (see Material::GetIndex). The index is released once the
+		// material has been destroyed (e.g. after it has been evicted from the cache) and re-used by the next material, lowest index first,
+		// so the indices stay compact even if materials are loaded and unloaded constantly. Returns the upper bound for material indices.
+		uint32_t GetMaterialIndexCount() const;
+		// Packed copies of the sort keys and feature flags of all materials, indexed by MaterialIndex (e.g. for radix sorting draw calls).
+		// Entries of indices that aren't assigned to a material are 0.
+		const std::vector<SortKey> &GetSortKeys() const { return m_sortKeys; }
+		const std::vector<RenderFeatureFlags> &GetRenderFeatureFlags() const { return m_renderFeatureFlags; }
+		// Called automatically whenever the sort data of a material has changed
+		void UpdateRenderSortData(const Material &mat);
+
+		// If enabled, materials that are loaded from different files, but have the same shader and identical data, are represented by
+		// the same Material object (and thereby also share the material index and all GPU resources), while they are still cached under
+		// their respective names. Material::GetName returns the name of the material that was loaded first (or, if that name has been
+		// reloaded with different contents, of the next one that still refers to it).
+		// Changes to a deduplicated material at runtime affect all names that refer to it. Disabled by default.
+		void SetDeduplicationEnabled(bool enabled);
+		bool IsDeduplicationEnabled() const { return m_deduplicationEnabled; }
+		struct DLLMATSYS DeduplicationStats {
+			uint32_t uniqueMaterials = 0;
+			// Number of loaded materials that were replaced by an existing, identical material
+			uint32_t deduplicatedMaterials = 0;
+			// Number of materials with identical hashes, but different contents
+			uint32_t hashCollisions = 0;
+		};
+		const DeduplicationStats &GetDeduplicationStats() const { return m_deduplicationStats; }
+		// Returns the number of names that share the specified material (1 if it hasn't been deduplicated)
+		uint32_t GetDeduplicatedNameCount(const Material &mat) const;
+
+		// While a recorder is set, every material that is loaded through the manager is added to it (see AssetLoadManifest).
+		// Reloads (util::AssetLoadFlags::DontCache) are not recorded.
+		void SetLoadRecorder(const std::shared_ptr<AssetLoadManifest> &recorder) { m_loadRecorder = recorder; }
+		const std::shared_ptr<AssetLoadManifest> &GetLoadRecorder() const { return m_loadRecorder; }
+		// Queues all materials of the manifest that haven't been loaded yet (see QueueAsset), with priorities that decrease in the order
+		// in which they have been recorded, starting at the number of entries. The requests are handed to the loader by DispatchQueuedAssets.
+		// Returns the number of materials that have been queued.
+		uint32_t PreloadManifest(const AssetLoadManifest &manifest);
+
+		// Adds a load request to the queue of the manager (see AssetLoadQueue). Unlike PreloadAsset, the request is only handed to the loader
+		// once it is dispatched (see DispatchQueuedAssets), so its priority can still be changed in the meantime.
+		void QueueAsset(const std::string &path, AssetLoadQueue::Priority priority = 0, std::unique_ptr<MaterialLoadInfo> &&loadInfo = nullptr);
+		// Returns false if there is no queued request for the material
+		bool SetAssetLoadPriority(const std::string &path, AssetLoadQueue::Priority priority);
+		// Drops the queued request for the material, or aborts its load job if it has already been dispatched.
+		// Returns false if there was nothing to cancel.
+		bool CancelAssetLoad(const std::string &path);
+		// Hands up to maxCount of the queued requests with the highest priorities to the loader. Returns the number of requests that have been dispatched.
+		uint32_t DispatchQueuedAssets(uint32_t maxCount = std::numeric_limits<uint32_t>::max());
+		size_t GetQueuedAssetCount() const { return m_loadQueue.GetSize(); }
+
+		// Creates a lightweight variation of the specified material, see MaterialInstance
+		std::shared_ptr<MaterialInstance> CreateMaterialInstance(Material &parent);
+		// Rebuilds all instances of the specified material. This happens automatically when the material is reloaded.
+		void UpdateMaterialInstances(const Material &parent);
+
+		// Watches the material root directory for changes (see FileWatcher). Materials that have already been loaded are reloaded in
+		// the background once their files have changed (see LoadAssets), and the directory index and image metadata cache are kept up to date.
+		// Changes are processed by Poll. Returns false if the directory can't be watched.
+		bool StartFileWatcher(const FileWatcherSettings &settings = {});
+		void StopFileWatcher();
+		bool IsFileWatcherRunning() const { return m_fileWatcher != nullptr; }
+		virtual void Poll() override;
 	  protected:
 		friend MaterialProcessor;
+		friend MaterialInstance;
+		friend MaterialLoadBatch;
+		friend ::Material;
 		MaterialManager();
 		virtual void Reset() override;
 		virtual void Initialize();
@@ -76,7 +198,59 @@ namespace msys {
 		virtual std::shared_ptr<Material> CreateMaterialObject(const std::string &shader, const std::shared_ptr<ds::Block> &data);
 		virtual util::AssetObject InitializeAsset(const util::Asset &asset, const util::AssetLoadJob &job) override;
 		virtual util::AssetObject ReloadAsset(const std::string &path, std::unique_ptr<util::AssetLoadInfo> &&loadInfo, PreloadResult *optOutResult = nullptr) override;
+		// Called for changed image files in the material root directory, identifier is the path without the extension
+		virtual void OnImageFileChanged(const FileWatcher::Change &change, const std::string &identifier) {}
+		void ProcessFileChanges();
 		msys::MaterialHandle m_error;
+		std::shared_ptr<const ParameterSchema> m_baseParameterSchema;
+		std::unordered_map<std::string, std::shared_ptr<const ParameterSchema>> m_parameterSchemas;
+		std::unordered_map<const Material *, std::vector<std::weak_ptr<MaterialInstance>>> m_materialInstances;
+		ctpl::thread_pool &GetWorkerPool();
+		struct DeduplicatedMaterial {
+			std::weak_ptr<Material> material;
+			uint64_t hash = 0;
+			// Cache identifiers of all names that refer to the material, in the order in which they were loaded.
+			// Names whose cache entries have been removed or replaced in the meantime are pruned lazily.
+			std::vector<std::string> names;
+		};
+		std::shared_ptr<Material> FindDuplicateMaterial(uint64_t hash, Material &mat);
+		// Returns the existing material that is identical to mat (and counts the new name towards it), or nullptr if there is none
+		std::shared_ptr<Material> DeduplicateMaterial(uint64_t hash, Material &mat);
+		void RegisterDeduplicatedMaterial(uint64_t hash, const std::shared_ptr<Material> &mat);
+		// Registers a material that has been loaded outside of the asset loader (e.g. by a MaterialLoadBatch) under the specified name
+		std::shared_ptr<Material> AddLoadedMaterial(const std::string &identifier, const std::shared_ptr<Material> &mat, std::optional<uint64_t> contentHash);
+		// Replaces the material of a cached asset with a newly loaded one
+		std::shared_ptr<Material> ReplaceCachedMaterial(util::Asset &asset, const std::string &path, const std::shared_ptr<Material> &matNew);
+		// Removes the specified name from the deduplicated material and returns the names that still refer to it
+		std::vector<std::string> ReleaseDeduplicatedName(const Material &mat, const std::string &name);
+		void PruneDeduplicatedNames(DeduplicatedMaterial &dedupMat) const;
+		std::atomic<bool> m_deduplicationEnabled = false;
+		std::unordered_map<uint64_t, std::vector<const Material *>> m_deduplicationTable;
+		std::unordered_map<const Material *, DeduplicatedMaterial> m_deduplicatedMaterials;
+		DeduplicationStats m_deduplicationStats {};
+
+		std::shared_ptr<AssetLoadManifest> m_loadRecorder;
+		AssetLoadQueue m_loadQueue;
+		// Jobs that have been cancelled after they were dispatched. Their failed results have to be cleared before they can be requested again.
+		std::unordered_set<std::string> m_cancelledLoads;
+		void ClearCancelledLoads();
+
+		std::unique_ptr<FileWatcher> m_fileWatcher;
+		std::vector<std::shared_ptr<MaterialLoadBatch>> m_fileReloadBatches;
+
+		// Assigns a free MaterialIndex to the material, unless it already has one
+		void AssignMaterialIndex(Material &mat);
+		// Called by the material when it's destroyed
+		void ReleaseMaterialIndex(Material &mat);
+		// Materials may be destroyed on any thread
+		mutable std::mutex m_materialIndexMutex;
+		SlotMap<Material *> m_materialIndices;
+
+		std::vector<SortKey> m_sortKeys;
+		std::vector<RenderFeatureFlags> m_renderFeatureFlags;
+		std::unique_ptr<ctpl::thread_pool> m_workerPool;
+		uint32_t m_workerThreadCount = 0;
+		util::AssetFormatType m_importFormat = util::AssetFormatType::Text;
 	};
 };
 
@@ -0,0 +1,174 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef __MSYS_MATERIAL_PARAMETER_LAYOUT_HPP__
+#define __MSYS_MATERIAL_PARAMETER_LAYOUT_HPP__
+
+#include "matsysdefinitions.h"
+#include "key_atom.hpp"
+#include <mathutil/uvec.h>
+#include <unordered_map>
+#include <vector>
+#include <string>
+#include <memory>
+#include <cstring>
+#include <cinttypes>
+#include <limits>
+
+struct TextureInfo;
+namespace ds {
+	class Block;
+	class Base;
+};
+namespace msys {
+	enum class ParameterType : uint8_t { Bool = 0, Int, Float, Vector2, Vector3, Vector4, Texture, Count };
+	using ParameterIndex = uint32_t;
+	constexpr ParameterIndex INVALID_PARAMETER_INDEX = std::numeric_limits<ParameterIndex>::max();
+
+	template<typename T>
+	constexpr ParameterType get_parameter_type();
+	template<>
+	constexpr ParameterType get_parameter_type<bool>() { return ParameterType::Bool; }
+	template<>
+	constexpr ParameterType get_parameter_type<int32_t>() { return ParameterType::Int; }
+	template<>
+	constexpr ParameterType get_parameter_type<float>() { return ParameterType::Float; }
+	template<>
+	constexpr ParameterType get_parameter_type<Vector2>() { return ParameterType::Vector2; }
+	template<>
+	constexpr ParameterType get_parameter_type<Vector3>() { return ParameterType::Vector3; }
+	template<>
+	constexpr ParameterType get_parameter_type<Vector4>() { return ParameterType::Vector4; }
+	template<>
+	constexpr ParameterType get_parameter_type<TextureInfo *>() { return ParameterType::Texture; }
+	DLLMATSYS uint32_t get_parameter_type_size(ParameterType type);
+
+	// Describes which parameters a shader uses, and where they are located within the
+	// compiled (flattened) parameter buffer of a material.
+	// The built-in parameters are always registered first, in the order of the BuiltinParameter enum,
+	// so their indices are identical for all schemas.
+#pragma warning(push)
+#pragma warning(disable : 4251)
+	class DLLMATSYS ParameterSchema {
+	  public:
+		enum class BuiltinParameter : ParameterIndex {
+			AlphaMode = 0,
+			AlphaCutoff,
+			ColorFactor,
+			BloomColorFactor,
+
+			DiffuseMap,
+			AlbedoMap,
+			NormalMap,
+			EmissionMap,
+			ParallaxMap,
+			AlphaMap,
+			RmaMap,
+
+			Count
+		};
+		struct DLLMATSYS Parameter {
+			std::string name;
+			KeyAtom atom = INVALID_KEY_ATOM;
+			ParameterType type = ParameterType::Count;
+			uint32_t offset = 0;
+		};
+		static std::shared_ptr<ParameterSchema> Create();
+		static std::shared_ptr<ParameterSchema> Create(const ParameterSchema &base);
+
+		template<typename T>
+		ParameterIndex AddParameter(const std::string &name, const T &defaultValue);
+		ParameterIndex FindParameter(const std::string &name) const;
+		ParameterIndex FindParameter(KeyAtom atom) const { return (atom < m_atomToIndex.size()) ? m_atomToIndex[atom] : INVALID_PARAMETER_INDEX; }
+		const Parameter *GetParameter(ParameterIndex idx) const;
+		const std::vector<Parameter> &GetParameters() const { return m_parameters; }
+		const std::vector<uint8_t> &GetDefaultData() const { return m_defaultData; }
+		uint32_t GetSize() const { return static_cast<uint32_t>(m_defaultData.size()); }
+	  private:
+		ParameterSchema() = default;
+		ParameterIndex AddParameter(const std::string &name, ParameterType type, const void *defaultValue);
+		std::vector<Parameter> m_parameters;
+		std::unordered_map<std::string, ParameterIndex> m_nameToIndex;
+		std::vector<ParameterIndex> m_atomToIndex;
+		std::vector<uint8_t> m_defaultData;
+	};
+
+	// Flattened, typed copy of the values of a material data block. Values are laid out according to a ParameterSchema,
+	// which allows hot accessors to read them without any string lookups.
+	class DLLMATSYS CompiledParameters {
+	  public:
+		CompiledParameters() = default;
+		void Compile(const std::shared_ptr<const ParameterSchema> &schema, ds::Block &data);
+		void Clear();
+		bool IsCompiled() const { return m_schema != nullptr; }
+		const ParameterSchema *GetSchema() const { return m_schema.get(); }
+
+		// Returns true if the value was explicitly defined in the data block (i.e. it's not the schema default)
+		bool IsDefined(ParameterIndex idx) const { return idx < m_defined.size() && m_defined[idx]; }
+		bool IsDefined(ParameterSchema::BuiltinParameter param) const { return IsDefined(static_cast<ParameterIndex>(param)); }
+
+		template<typename T>
+		T Get(ParameterIndex idx) const;
+		template<typename T>
+		T Get(ParameterSchema::BuiltinParameter param) const
+		{
+			return Get<T>(static_cast<ParameterIndex>(param));
+		}
+		template<typename T>
+		bool Set(ParameterIndex idx, const T &value);
+		template<typename T>
+		bool Set(ParameterSchema::BuiltinParameter param, const T &value)
+		{
+			return Set<T>(static_cast<ParameterIndex>(param), value);
+		}
+		TextureInfo *GetTexture(ParameterIndex idx) const { return Get<TextureInfo *>(idx); }
+		TextureInfo *GetTexture(ParameterSchema::BuiltinParameter param) const { return GetTexture(static_cast<ParameterIndex>(param)); }
+
+		// Returns the top-level value of the data block with the specified key, as it was when the parameters were compiled.
+		// This also covers values which are not part of the schema.
+		// Keys are not interned during compilation, so keys whose atoms are >= GetAtomCount() were not looked up and have to be
+		// retrieved from the data block directly.
+		const std::shared_ptr<ds::Base> &GetValue(KeyAtom atom) const;
+		void SetValue(KeyAtom atom, const std::shared_ptr<ds::Base> &value);
+		uint32_t GetAtomCount() const { return m_atomCount; }
+	  private:
+		const ParameterSchema::Parameter *GetParameter(ParameterIndex idx, ParameterType type) const;
+		std::shared_ptr<const ParameterSchema> m_schema = nullptr;
+		std::vector<uint8_t> m_data;
+		std::vector<bool> m_defined;
+		std::unordered_map<KeyAtom, std::shared_ptr<ds::Base>> m_values;
+		uint32_t m_atomCount = 0;
+	};
+#pragma warning(pop)
+};
+
+template<typename T>
+msys::ParameterIndex msys::ParameterSchema::AddParameter(const std::string &name, const T &defaultValue)
+{
+	return AddParameter(name, get_parameter_type<T>(), &defaultValue);
+}
+
+template<typename T>
+T msys::CompiledParameters::Get(ParameterIndex idx) const
+{
+	auto *param = GetParameter(idx, get_parameter_type<T>());
+	if(!param)
+		return T {};
+	T value;
+	std::memcpy(&value, m_data.data() + param->offset, sizeof(T));
+	return value;
+}
+
+template<typename T>
+bool msys::CompiledParameters::Set(ParameterIndex idx, const T &value)
+{
+	auto *param = GetParameter(idx, get_parameter_type<T>());
+	if(!param)
+		return false;
+	std::memcpy(m_data.data() + param->offset, &value, sizeof(T));
+	m_defined[idx] = true;
+	return true;
+}
+
+#endif
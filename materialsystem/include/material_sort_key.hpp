@@ -0,0 +1,52 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef __MSYS_MATERIAL_SORT_KEY_HPP__
+#define __MSYS_MATERIAL_SORT_KEY_HPP__
+
+#include "matsysdefinitions.h"
+#include <sharedutils/alpha_mode.hpp>
+#include <mathutil/umath.h>
+#include <cinttypes>
+#include <string>
+
+namespace msys {
+	// 64-bit key for sorting draw calls by material. From the most to the least significant bits:
+	// shader id (16 bits), alpha mode (2 bits), hash of the texture set and sampler (46 bits).
+	using SortKey = uint64_t;
+	constexpr uint32_t SORT_KEY_SHADER_BITS = 16;
+	constexpr uint32_t SORT_KEY_ALPHA_MODE_BITS = 2;
+	constexpr uint32_t SORT_KEY_TEXTURE_SET_BITS = 64 - SORT_KEY_SHADER_BITS - SORT_KEY_ALPHA_MODE_BITS;
+	constexpr SortKey SORT_KEY_TEXTURE_SET_MASK = (SortKey {1} << SORT_KEY_TEXTURE_SET_BITS) - 1;
+	constexpr SortKey SORT_KEY_ALPHA_MODE_MASK = (SortKey {1} << SORT_KEY_ALPHA_MODE_BITS) - 1;
+	constexpr SortKey SORT_KEY_SHADER_MASK = (SortKey {1} << SORT_KEY_SHADER_BITS) - 1;
+
+	// Returns a dense id for the specified shader, which is assigned the first time the shader is queried. Ids start at 0 and are never reused,
+	// so they always fit into the shader bits of a sort key (unless there are more than 2^16 distinct shaders). Thread-safe.
+	DLLMATSYS uint32_t get_shader_sort_id(const std::string &shader);
+
+	constexpr SortKey make_sort_key(uint32_t shaderId, AlphaMode alphaMode, uint64_t textureSetHash)
+	{
+		return ((static_cast<SortKey>(shaderId) & SORT_KEY_SHADER_MASK) << (SORT_KEY_ALPHA_MODE_BITS + SORT_KEY_TEXTURE_SET_BITS)) | ((static_cast<SortKey>(alphaMode) & SORT_KEY_ALPHA_MODE_MASK) << SORT_KEY_TEXTURE_SET_BITS)
+		  | (textureSetHash & SORT_KEY_TEXTURE_SET_MASK);
+	}
+	constexpr uint32_t get_sort_key_shader_id(SortKey key) { return static_cast<uint32_t>((key >> (SORT_KEY_ALPHA_MODE_BITS + SORT_KEY_TEXTURE_SET_BITS)) & SORT_KEY_SHADER_MASK); }
+	constexpr AlphaMode get_sort_key_alpha_mode(SortKey key) { return static_cast<AlphaMode>((key >> SORT_KEY_TEXTURE_SET_BITS) & SORT_KEY_ALPHA_MODE_MASK); }
+	constexpr uint64_t get_sort_key_texture_set_hash(SortKey key) { return key & SORT_KEY_TEXTURE_SET_MASK; }
+
+	enum class RenderFeatureFlags : uint32_t {
+		None = 0u,
+		NormalMapBit = 1u,
+		RmaMapBit = NormalMapBit << 1u,
+		EmissionMapBit = RmaMapBit << 1u,
+		ParallaxMapBit = EmissionMapBit << 1u,
+		TranslucentBit = ParallaxMapBit << 1u,
+		SpriteSheetBit = TranslucentBit << 1u
+	};
+
+	constexpr uint64_t hash_combine(uint64_t seed, uint64_t value) { return seed ^ (value + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2)); }
+};
+REGISTER_BASIC_BITWISE_OPERATORS(msys::RenderFeatureFlags)
+
+#endif
@@ -7,7 +7,11 @@
 
 #include "matsysdefinitions.h"
 #include "material.h"
+#include "slot_map.hpp"
+#include <shared_mutex>
 #include <optional>
+#include <deque>
+#include <limits>
 
 #pragma warning(push)
 #pragma warning(disable : 4251)
@@ -38,6 +42,18 @@ class DLLMATSYS MaterialManager {
 		TextureType type;
 		std::string extension;
 	};
+	struct DLLMATSYS MaterialRecord {
+		Material *material = nullptr;
+		msys::MaterialHandle handle = nullptr; // Keeps the material alive
+	};
+	using MaterialTable = msys::SlotMap<MaterialRecord>;
+	struct DLLMATSYS ResolvedMaterialPath {
+		std::string path; // Normalized path, including the extension
+		std::string extension;
+		std::string identifier; // See ToMaterialIdentifier
+		bool hadExtension = false;
+		bool exists = false;
+	};
 
 	MaterialManager();
 	MaterialManager &operator=(const MaterialManager &) = delete;
@@ -48,14 +64,31 @@ class DLLMATSYS MaterialManager {
 	Material *CreateMaterial(const std::string &shader, const std::shared_ptr<ds::Block> &root = nullptr);
 	Material *FindMaterial(const std::string &identifier, std::string &internalMatId) const;
 	Material *FindMaterial(const std::string &identifier) const;
+	// Index in this manager's table, see Material::GetLegacyIndex
 	Material *GetMaterial(MaterialIndex index);
 	const Material *GetMaterial(MaterialIndex index) const;
+	// Returns nullptr if the material the handle was referring to has been removed in the meantime
+	Material *GetMaterial(msys::SlotHandle handle);
+	const Material *GetMaterial(msys::SlotHandle handle) const;
+	msys::SlotHandle GetMaterialHandle(MaterialIndex index) const;
+	msys::SlotHandle FindMaterialHandle(const std::string &identifier) const;
 	virtual Material *Load(const std::string &path, bool bReload = false, bool loadInstantly = true, bool *bFirstTimeError = nullptr);
 	virtual void SetErrorMaterial(Material *mat);
 	Material *GetErrorMaterial() const;
-	const std::vector<MaterialHandle> &GetMaterials() const;
+	// Material indices are re-used once a material has been removed, use a msys::SlotHandle to detect stale references
+	const MaterialTable &GetMaterials() const;
 	uint32_t Clear(); // Clears all materials (+Textures?)
 	uint32_t ClearUnused();
+	// Resolves a requested material name to its file and identifier. Results (including materials that don't exist) are cached
+	// until a file of the same material has been created or removed (see msys::notify_material_file_created), the cache has to be
+	// invalidated manually when an addon has been mounted. At most MAX_PATH_RESOLUTION_CACHE_SIZE names are cached, the oldest
+	// ones are evicted first. The returned result is never modified, it stays valid even if it's removed from the cache.
+	// May be called from any thread.
+	std::shared_ptr<const ResolvedMaterialPath> ResolveMaterialPath(const std::string &path) const;
+	void InvalidatePathResolutionCache();
+	// Invalidates all cached names that resolve to the specified material
+	void InvalidatePathResolution(const std::string &path);
+	static constexpr uint32_t MAX_PATH_RESOLUTION_CACHE_SIZE = 16'384;
 	void SetTextureImporter(const std::function<std::shared_ptr<VFilePtrInternal>(const std::string &, const std::string &)> &fileHandler);
 	const std::function<std::shared_ptr<VFilePtrInternal>(const std::string &, const std::string &)> &GetTextureImporter() const;
 
@@ -63,8 +96,21 @@ class DLLMATSYS MaterialManager {
 	static void SetRootMaterialLocation(const std::string &location);
 	static const std::string &GetRootMaterialLocation();
   protected:
-	std::vector<MaterialHandle> m_materials;
-	std::unordered_map<std::string, MaterialIndex> m_nameToMaterialIndex;
+	MaterialTable m_materials;
+	std::unordered_map<std::string, msys::SlotHandle> m_nameToMaterial;
+	mutable std::shared_mutex m_pathResolutionMutex;
+	// Requested name -> result
+	mutable std::unordered_map<std::string, std::shared_ptr<const ResolvedMaterialPath>> m_pathResolutionCache;
+	// Material identifier -> requested names that resolve to it
+	mutable std::unordered_map<std::string, std::vector<std::string>> m_pathResolutionNames;
+	// Requested names in the order in which they have been added, for evicting the oldest ones
+	mutable std::deque<std::string> m_pathResolutionOrder;
+	uint32_t m_materialFileListener = std::numeric_limits<uint32_t>::max();
+	// Has to be called with m_pathResolutionMutex locked
+	void ErasePathResolution(const std::string &path) const;
+	void InvalidatePathResolutionByIdentifier(const std::string &identifier);
+	MaterialRecord *FindMaterialRecord(const std::string &nidentifier);
+	const MaterialRecord *FindMaterialRecord(const std::string &nidentifier) const;
 	uint32_t m_unnamedIdx = 0;
 	std::string PathToIdentifier(const std::string &path, std::string *ext, bool &hadExtension) const;
 	std::string PathToIdentifier(const std::string &path, std::string *ext) const;
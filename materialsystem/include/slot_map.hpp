@@ -0,0 +1,178 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef __MSYS_SLOT_MAP_HPP__
+#define __MSYS_SLOT_MAP_HPP__
+
+#include <vector>
+#include <queue>
+#include <functional>
+#include <optional>
+#include <cinttypes>
+#include <limits>
+
+namespace msys {
+	// 32-bit handle to an element of a SlotMap. The lower bits contain the slot index, the upper bits the generation of the slot
+	// at the time the handle was created. Once the element is removed, the generation of the slot is incremented, which makes
+	// all existing handles to it stale, even if the slot is re-used for another element.
+	class SlotHandle {
+	  public:
+		static constexpr uint32_t INDEX_BITS = 20;
+		static constexpr uint32_t GENERATION_BITS = 32 - INDEX_BITS;
+		static constexpr uint32_t INDEX_MASK = (1u << INDEX_BITS) - 1u;
+		static constexpr uint32_t GENERATION_MASK = (1u << GENERATION_BITS) - 1u;
+		static constexpr uint32_t INVALID_VALUE = std::numeric_limits<uint32_t>::max();
+		static constexpr uint32_t MAX_SLOT_COUNT = INDEX_MASK; // INDEX_MASK itself is reserved for invalid handles
+
+		constexpr SlotHandle() = default;
+		constexpr SlotHandle(uint32_t index, uint32_t generation) : m_value {(index & INDEX_MASK) | ((generation & GENERATION_MASK) << INDEX_BITS)} {}
+		static constexpr SlotHandle FromValue(uint32_t value)
+		{
+			SlotHandle handle {};
+			handle.m_value = value;
+			return handle;
+		}
+		constexpr uint32_t GetIndex() const { return m_value & INDEX_MASK; }
+		constexpr uint32_t GetGeneration() const { return (m_value >> INDEX_BITS) & GENERATION_MASK; }
+		constexpr uint32_t GetValue() const { return m_value; }
+		constexpr bool IsValid() const { return m_value != INVALID_VALUE; }
+		constexpr bool operator==(const SlotHandle &other) const { return m_value == other.m_value; }
+		constexpr bool operator!=(const SlotHandle &other) const { return m_value != other.m_value; }
+	  private:
+		uint32_t m_value = INVALID_VALUE;
+	};
+
+	// Stores elements in a contiguous array of slots. Removed slots are re-used, lowest index first, so the indices
+	// stay compact even if elements are added and removed constantly. Elements are addressed either by their
+	// slot index (which is stable for the lifetime of the element) or by a generational SlotHandle.
+	template<typename T>
+	class SlotMap {
+	  public:
+		struct Slot {
+			std::optional<T> value {};
+			uint32_t generation = 0;
+		};
+		template<typename TSlots, typename TValue>
+		class TIterator {
+		  public:
+			TIterator(TSlots &slots, size_t idx) : m_slots {&slots}, m_index {idx} { SkipEmpty(); }
+			TValue &operator*() const { return *(*m_slots)[m_index].value; }
+			TValue *operator->() const { return &*(*m_slots)[m_index].value; }
+			TIterator &operator++()
+			{
+				++m_index;
+				SkipEmpty();
+				return *this;
+			}
+			bool operator==(const TIterator &other) const { return m_index == other.m_index; }
+			bool operator!=(const TIterator &other) const { return m_index != other.m_index; }
+			// Slot index of the current element
+			uint32_t GetIndex() const { return static_cast<uint32_t>(m_index); }
+		  private:
+			void SkipEmpty()
+			{
+				while(m_index < m_slots->size() && !(*m_slots)[m_index].value.has_value())
+					++m_index;
+			}
+			TSlots *m_slots;
+			size_t m_index;
+		};
+		using Iterator = TIterator<std::vector<Slot>, T>;
+		using ConstIterator = TIterator<const std::vector<Slot>, const T>;
+
+		// Returns an invalid handle if the maximum number of slots has been reached
+		SlotHandle Insert(T value);
+		bool Erase(SlotHandle handle);
+		bool Erase(uint32_t index);
+		void Clear();
+
+		bool IsValid(SlotHandle handle) const { return Find(handle) != nullptr; }
+		T *Find(SlotHandle handle);
+		const T *Find(SlotHandle handle) const { return const_cast<SlotMap *>(this)->Find(handle); }
+		T *Get(uint32_t index) { return (index < m_slots.size() && m_slots[index].value.has_value()) ? &*m_slots[index].value : nullptr; }
+		const T *Get(uint32_t index) const { return const_cast<SlotMap *>(this)->Get(index); }
+		// Returns the handle for the element currently occupying the specified slot
+		SlotHandle GetHandle(uint32_t index) const { return (index < m_slots.size() && m_slots[index].value.has_value()) ? SlotHandle {index, m_slots[index].generation} : SlotHandle {}; }
+
+		// Number of elements
+		uint32_t GetSize() const { return m_size; }
+		// Number of slots (occupied and free), i.e. the upper bound for slot indices
+		uint32_t GetSlotCount() const { return static_cast<uint32_t>(m_slots.size()); }
+		void Reserve(uint32_t count) { m_slots.reserve(count); }
+
+		Iterator begin() { return Iterator {m_slots, 0}; }
+		Iterator end() { return Iterator {m_slots, m_slots.size()}; }
+		ConstIterator begin() const { return ConstIterator {m_slots, 0}; }
+		ConstIterator end() const { return ConstIterator {m_slots, m_slots.size()}; }
+	  private:
+		std::vector<Slot> m_slots;
+		std::priority_queue<uint32_t, std::vector<uint32_t>, std::greater<uint32_t>> m_freeList;
+		uint32_t m_size = 0;
+	};
+};
+
+template<typename T>
+msys::SlotHandle msys::SlotMap<T>::Insert(T value)
+{
+	uint32_t index;
+	if(!m_freeList.empty()) {
+		index = m_freeList.top();
+		m_freeList.pop();
+	}
+	else {
+		if(m_slots.size() >= SlotHandle::MAX_SLOT_COUNT)
+			return {};
+		index = static_cast<uint32_t>(m_slots.size());
+		m_slots.push_back({});
+	}
+	auto &slot = m_slots[index];
+	slot.value = std::move(value);
+	++m_size;
+	return SlotHandle {index, slot.generation};
+}
+
+template<typename T>
+bool msys::SlotMap<T>::Erase(SlotHandle handle)
+{
+	if(!IsValid(handle))
+		return false;
+	return Erase(handle.GetIndex());
+}
+
+template<typename T>
+bool msys::SlotMap<T>::Erase(uint32_t index)
+{
+	if(index >= m_slots.size() || !m_slots[index].value.has_value())
+		return false;
+	auto &slot = m_slots[index];
+	slot.value = {};
+	slot.generation = (slot.generation + 1) & SlotHandle::GENERATION_MASK;
+	m_freeList.push(index);
+	--m_size;
+	return true;
+}
+
+template<typename T>
+void msys::SlotMap<T>::Clear()
+{
+	// Slots are kept (but emptied) so that the generations remain intact and old handles stay stale
+	for(uint32_t i = 0; i < m_slots.size(); ++i)
+		Erase(i);
+}
+
+template<typename T>
+T *msys::SlotMap<T>::Find(SlotHandle handle)
+{
+	if(!handle.IsValid())
+		return nullptr;
+	auto index = handle.GetIndex();
+	if(index >= m_slots.size())
+		return nullptr;
+	auto &slot = m_slots[index];
+	if(!slot.value.has_value() || slot.generation != handle.GetGeneration())
+		return nullptr;
+	return &*slot.value;
+}
+
+#endif
@@ -8,6 +8,8 @@
 #ifndef DISABLE_VMAT_SUPPORT
 #include "matsysdefinitions.h"
 #include <sharedutils/asset_loader/asset_format_handler.hpp>
+#include <vector>
+#include <string>
 
 namespace source2::resource {
 	class Resource;
@@ -26,6 +28,11 @@ namespace msys {
 	  protected:
 		virtual bool ImportTexture(const std::string &fpath, const std::string &outputPath) { return false; }
 		virtual bool InitializeVMatData(::source2::resource::Resource &resource, ::source2::resource::Material &vmat, ds::Block &rootData, ds::Settings &settings, const std::string &shader, VMatOrigin origin);
+		// See SourceVmtFormatHandler
+		virtual std::string GetConverterName() const { return "vmat"; }
+		void AddGeneratedFile(const std::string &filePath) { m_generatedFiles.push_back(filePath); }
+		std::vector<std::string> m_generatedFiles;
+		bool m_cacheable = true;
 	  private:
 		bool LoadVMat(::source2::resource::Resource &resource, const std::string &outputPath, std::string &outFilePath);
 	};
@@ -8,6 +8,8 @@
 #ifndef DISABLE_VMT_SUPPORT
 #include "matsysdefinitions.h"
 #include <sharedutils/asset_loader/asset_format_handler.hpp>
+#include <vector>
+#include <string>
 
 namespace VTFLib {
 	class CVMTFile;
@@ -27,6 +29,13 @@ namespace msys {
 	  protected:
 		virtual bool LoadVMTData(VTFLib::CVMTFile &vmt, const std::string &vmtShader, ds::Block &rootData, std::string &matShader);
 		bool LoadVMT(VTFLib::CVMTFile &vmt, const std::string &outputPath, std::string &outFilePath);
+		// Identifies the conversion in the import cache, has to differ between handlers that produce different output for the same VMT
+		virtual std::string GetConverterName() const { return "vmt"; }
+		// Files (relative to the program directory) the material depends on, that were written during the import (see ImportCache)
+		void AddGeneratedFile(const std::string &filePath) { m_generatedFiles.push_back(filePath); }
+		std::vector<std::string> m_generatedFiles;
+		// Has to be cleared if the result is incomplete (e.g. because a texture that is required for a conversion isn't available yet)
+		bool m_cacheable = true;
 	};
 #ifdef ENABLE_VKV_PARSER
 	class DLLMATSYS SourceVmtFormatHandler2 : public util::IImportAssetFormatHandler {
@@ -37,6 +46,10 @@ namespace msys {
 		static std::optional<std::string> GetStringValue(ValveKeyValueFormat::KVBranch &node, std::string key);
 		virtual bool LoadVMTData(ValveKeyValueFormat::KVNode &vmt, const std::string &vmtShader, ds::Block &rootData, std::string &matShader);
 		bool LoadVMT(ValveKeyValueFormat::KVNode &vmt, const std::string &outputPath, std::string &outFilePath);
+		virtual std::string GetConverterName() const { return "vmt_kv"; }
+		void AddGeneratedFile(const std::string &filePath) { m_generatedFiles.push_back(filePath); }
+		std::vector<std::string> m_generatedFiles;
+		bool m_cacheable = true;
 	};
 #endif
 };
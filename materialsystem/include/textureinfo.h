@@ -7,16 +7,51 @@
 
 #include "matsysdefinitions.h"
 #include <datasystem.h>
+#include <atomic>
+#include <vector>
 
 #pragma warning(push)
 #pragma warning(disable : 4251)
 struct DLLMATSYS TextureInfo {
+	enum class SizeState : uint8_t { Unknown = 0, Probing, Known, Unavailable };
 	TextureInfo();
 	TextureInfo(const TextureInfo &other);
+	TextureInfo &operator=(const TextureInfo &other);
+	// The image header is only read on demand (or by a batched probe, see msys::MaterialManager::ProbeTextureSizes).
+	// GetWidth and GetHeight read it if necessary, IsSizeKnown can be used to check whether that would touch the file system.
+	bool IsSizeKnown() const;
+	SizeState GetSizeState() const;
+	// Reads the image header if that hasn't happened yet. Returns false if the image could not be found.
+	bool ResolveSize();
+	void SetSize(uint32_t width, uint32_t height);
+	void SetSizeUnavailable();
+	uint32_t GetWidth() const;
+	uint32_t GetHeight() const;
+
+	// Deprecated: Use GetWidth/GetHeight and SetSize instead.
+	// Forwards to the accessors, so reading the size still reads the image header if necessary.
+	class DLLMATSYS SizeField {
+	  public:
+		SizeField(const SizeField &) = delete;
+		SizeField &operator=(const SizeField &) = delete;
+		operator unsigned int() const;
+		SizeField &operator=(unsigned int value);
+	  private:
+		friend TextureInfo;
+		SizeField(TextureInfo &owner, bool height) : m_owner {owner}, m_height {height} {}
+		TextureInfo &m_owner;
+		bool m_height;
+	};
+
+	// Path of the image file relative to the material root directory, including the extension if the file exists
 	std::string name;
-	unsigned int width;
-	unsigned int height;
+	SizeField width;
+	SizeField height;
 	std::shared_ptr<void> texture;
+  private:
+	uint32_t m_width;
+	uint32_t m_height;
+	std::atomic<SizeState> m_sizeState;
 };
 
 namespace ds {
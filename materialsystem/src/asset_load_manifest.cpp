@@ -0,0 +1,96 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "asset_load_manifest.hpp"
+#include "util_binary_io.hpp"
+#include <fsys/filesystem.h>
+#include <sharedutils/util_file.h>
+#include <array>
+
+static std::array<char, 4> ASSET_LOAD_MANIFEST_HEADER {'A', 'L', 'M', 'F'};
+
+void msys::AssetLoadManifest::Record(const std::string &identifier, util::AssetLoadFlags flags, TextureMipmapMode mipmapMode)
+{
+	std::scoped_lock lock {m_mutex};
+	if(!m_identifiers.insert(identifier).second)
+		return;
+	m_entries.push_back({identifier, flags, mipmapMode});
+}
+void msys::AssetLoadManifest::Clear()
+{
+	std::scoped_lock lock {m_mutex};
+	m_entries.clear();
+	m_identifiers.clear();
+}
+std::vector<msys::AssetLoadManifest::Entry> msys::AssetLoadManifest::GetEntries() const
+{
+	std::scoped_lock lock {m_mutex};
+	return m_entries;
+}
+size_t msys::AssetLoadManifest::GetEntryCount() const
+{
+	std::scoped_lock lock {m_mutex};
+	return m_entries.size();
+}
+
+using namespace msys::binary_io;
+
+bool msys::AssetLoadManifest::Load(const std::string &fileName)
+{
+	auto f = FileManager::OpenFile(fileName.c_str(), "rb");
+	if(f == nullptr)
+		return false;
+	std::vector<uint8_t> data;
+	data.resize(f->GetSize());
+	if(f->Read(data.data(), data.size()) != data.size())
+		return false;
+	f = nullptr;
+
+	size_t offset = 0;
+	std::array<char, 4> header;
+	uint32_t version;
+	uint32_t numEntries;
+	if(!read_value(data, offset, header) || header != ASSET_LOAD_MANIFEST_HEADER || !read_value(data, offset, version) || version != FORMAT_VERSION || !read_value(data, offset, numEntries))
+		return false;
+	std::vector<Entry> entries;
+	entries.reserve(numEntries);
+	for(auto i = decltype(numEntries) {0u}; i < numEntries; ++i) {
+		Entry entry {};
+		if(!read_string(data, offset, entry.identifier) || !read_value(data, offset, entry.flags) || !read_value(data, offset, entry.mipmapMode))
+			return false;
+		entries.push_back(std::move(entry));
+	}
+
+	std::scoped_lock lock {m_mutex};
+	m_entries.clear();
+	m_identifiers.clear();
+	for(auto &entry : entries) {
+		if(m_identifiers.insert(entry.identifier).second)
+			m_entries.push_back(std::move(entry));
+	}
+	return true;
+}
+
+bool msys::AssetLoadManifest::Save(const std::string &fileName) const
+{
+	std::vector<uint8_t> data;
+	{
+		std::scoped_lock lock {m_mutex};
+		data.reserve(ASSET_LOAD_MANIFEST_HEADER.size() + sizeof(uint32_t) * 2 + m_entries.size() * 64);
+		write_value(data, ASSET_LOAD_MANIFEST_HEADER);
+		write_value(data, FORMAT_VERSION);
+		write_value(data, static_cast<uint32_t>(m_entries.size()));
+		for(auto &entry : m_entries) {
+			write_string(data, entry.identifier);
+			write_value(data, entry.flags);
+			write_value(data, entry.mipmapMode);
+		}
+	}
+	FileManager::CreatePath(ufile::get_path_from_filename(fileName).c_str());
+	auto f = FileManager::OpenFile<VFilePtrReal>(fileName.c_str(), "wb");
+	if(f == nullptr)
+		return false;
+	f->Write(data.data(), data.size());
+	return true;
+}
@@ -0,0 +1,133 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "asset_load_queue.hpp"
+#include <mathutil/umath.h>
+
+void msys::AssetLoadQueue::Push(const std::string &identifier, Priority priority, std::unique_ptr<util::AssetLoadInfo> &&loadInfo)
+{
+	std::scoped_lock lock {m_mutex};
+	auto it = m_requests.find(identifier);
+	if(it != m_requests.end()) {
+		m_order.erase(it->second.key);
+		it->second.key.priority = priority;
+		it->second.loadInfo = std::move(loadInfo);
+		m_order[it->second.key] = identifier;
+		return;
+	}
+	Key key {priority, m_nextSequence++};
+	m_requests[identifier] = {key, std::move(loadInfo)};
+	m_order[key] = identifier;
+}
+bool msys::AssetLoadQueue::SetPriority(const std::string &identifier, Priority priority)
+{
+	std::scoped_lock lock {m_mutex};
+	auto it = m_requests.find(identifier);
+	if(it == m_requests.end())
+		return false;
+	auto &key = it->second.key;
+	if(key.priority == priority)
+		return true;
+	m_order.erase(key);
+	key.priority = priority;
+	m_order[key] = identifier;
+	return true;
+}
+std::optional<msys::AssetLoadQueue::Priority> msys::AssetLoadQueue::GetPriority(const std::string &identifier) const
+{
+	std::scoped_lock lock {m_mutex};
+	auto it = m_requests.find(identifier);
+	if(it == m_requests.end())
+		return {};
+	return it->second.key.priority;
+}
+bool msys::AssetLoadQueue::Remove(const std::string &identifier)
+{
+	std::scoped_lock lock {m_mutex};
+	auto it = m_requests.find(identifier);
+	if(it == m_requests.end())
+		return false;
+	m_order.erase(it->second.key);
+	m_requests.erase(it);
+	return true;
+}
+std::optional<msys::AssetLoadQueue::Request> msys::AssetLoadQueue::Pop()
+{
+	std::scoped_lock lock {m_mutex};
+	if(m_order.empty())
+		return {};
+	auto itOrder = m_order.begin();
+	auto it = m_requests.find(itOrder->second);
+	Request request {};
+	request.identifier = std::move(itOrder->second);
+	request.priority = itOrder->first.priority;
+	request.loadInfo = std::move(it->second.loadInfo);
+	m_requests.erase(it);
+	m_order.erase(itOrder);
+	return request;
+}
+size_t msys::AssetLoadQueue::GetSize() const
+{
+	std::scoped_lock lock {m_mutex};
+	return m_requests.size();
+}
+void msys::AssetLoadQueue::Clear()
+{
+	std::scoped_lock lock {m_mutex};
+	m_order.clear();
+	m_requests.clear();
+}
+
+msys::AssetLoadCancellationToken msys::AssetLoadQueue::CreateCancellationToken(const std::string &identifier)
+{
+	auto token = std::make_shared<std::atomic<bool>>(false);
+	std::scoped_lock lock {m_mutex};
+	// Tokens of jobs that have completed in the meantime are pruned once the map has doubled in size, so it doesn't grow indefinitely
+	if(m_cancellationTokens.size() >= m_pruneThreshold) {
+		for(auto it = m_cancellationTokens.begin(); it != m_cancellationTokens.end();) {
+			if(it->second.expired())
+				it = m_cancellationTokens.erase(it);
+			else
+				++it;
+		}
+		m_pruneThreshold = umath::max(m_cancellationTokens.size() * 2, MIN_PRUNE_THRESHOLD);
+	}
+	m_cancellationTokens[identifier] = token;
+	return token;
+}
+bool msys::AssetLoadQueue::Cancel(const std::string &identifier)
+{
+	std::scoped_lock lock {m_mutex};
+	auto it = m_cancellationTokens.find(identifier);
+	if(it == m_cancellationTokens.end())
+		return false;
+	auto token = it->second.lock();
+	m_cancellationTokens.erase(it);
+	if(!token)
+		return false;
+	*token = true;
+	m_cancelledTokens[identifier] = token;
+	return true;
+}
+std::vector<std::string> msys::AssetLoadQueue::PollCompletedCancellations()
+{
+	std::vector<std::string> identifiers;
+	std::scoped_lock lock {m_mutex};
+	// The token is released together with the job
+	for(auto it = m_cancelledTokens.begin(); it != m_cancelledTokens.end();) {
+		if(!it->second.expired()) {
+			++it;
+			continue;
+		}
+		identifiers.push_back(it->first);
+		it = m_cancelledTokens.erase(it);
+	}
+	return identifiers;
+}
+bool msys::AssetLoadQueue::IsInFlight(const std::string &identifier) const
+{
+	std::scoped_lock lock {m_mutex};
+	auto it = m_cancellationTokens.find(identifier);
+	return it != m_cancellationTokens.end() && !it->second.expired();
+}
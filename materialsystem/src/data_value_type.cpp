@@ -0,0 +1,65 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "data_value_type.hpp"
+#include "textureinfo.h"
+#include <datasystem.h>
+#include <datasystem_vector.h>
+#include <datasystem_color.h>
+#include <unordered_map>
+#include <typeindex>
+#include <array>
+
+msys::DataValueType msys::get_data_value_type(const ds::Base &value)
+{
+	if(value.IsBlock())
+		return DataValueType::Block;
+	if(value.IsContainer())
+		return DataValueType::Container;
+	static const std::unordered_map<std::type_index, DataValueType> typeToValueType {
+	  {typeid(ds::String), DataValueType::String},
+	  {typeid(ds::Int), DataValueType::Int},
+	  {typeid(ds::Float), DataValueType::Float},
+	  {typeid(ds::Bool), DataValueType::Bool},
+	  {typeid(ds::Vector), DataValueType::Vector},
+	  {typeid(ds::Vector2), DataValueType::Vector2},
+	  {typeid(ds::Vector4), DataValueType::Vector4},
+	  {typeid(ds::Color), DataValueType::Color},
+	  {typeid(ds::Texture), DataValueType::Texture},
+	};
+	auto it = typeToValueType.find(typeid(value));
+	if(it != typeToValueType.end())
+		return it->second;
+
+	// Types derived from one of the known value types (e.g. defined outside of the material system) are rare,
+	// so we only fall back to dynamic_cast for those.
+	auto *ptr = &value;
+	if(dynamic_cast<const ds::Texture *>(ptr))
+		return DataValueType::Texture;
+	if(dynamic_cast<const ds::Color *>(ptr))
+		return DataValueType::Color;
+	if(dynamic_cast<const ds::String *>(ptr))
+		return DataValueType::String;
+	if(dynamic_cast<const ds::Int *>(ptr))
+		return DataValueType::Int;
+	if(dynamic_cast<const ds::Float *>(ptr))
+		return DataValueType::Float;
+	if(dynamic_cast<const ds::Bool *>(ptr))
+		return DataValueType::Bool;
+	if(dynamic_cast<const ds::Vector *>(ptr))
+		return DataValueType::Vector;
+	if(dynamic_cast<const ds::Vector2 *>(ptr))
+		return DataValueType::Vector2;
+	if(dynamic_cast<const ds::Vector4 *>(ptr))
+		return DataValueType::Vector4;
+	return DataValueType::Unknown;
+}
+
+const char *msys::get_data_value_type_name(DataValueType type)
+{
+	static const std::array<const char *, static_cast<size_t>(DataValueType::Count)> names {"block", "container", "string", "int", "float", "bool", "vector", "vector2", "vector4", "color", "texture", "unknown"};
+	static_assert(static_cast<size_t>(DataValueType::Count) == 12);
+	auto idx = static_cast<size_t>(type);
+	return (idx < names.size()) ? names[idx] : "unknown";
+}
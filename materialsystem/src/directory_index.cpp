@@ -0,0 +1,232 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "directory_index.hpp"
+#include "materialmanager.h"
+#include <fsys/filesystem.h>
+#include <sharedutils/util_string.h>
+#include <sharedutils/util_file.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <mutex>
+
+extern const std::array<std::string, 5> g_knownMaterialFormats;
+
+msys::DirectoryIndex &msys::get_material_directory_index()
+{
+	static DirectoryIndex index {};
+	static std::once_flag initialized;
+	std::call_once(initialized, []() {
+		for(auto &ext : g_knownMaterialFormats)
+			index.RegisterExtension(ext);
+		for(auto &format : MaterialManager::get_supported_image_formats())
+			index.RegisterExtension(format.extension);
+	});
+	return index;
+}
+void msys::initialize_material_directory_index()
+{
+	static std::once_flag initialized;
+	std::call_once(initialized, []() { get_material_directory_index().Build(MaterialManager::GetRootMaterialLocation()); });
+}
+
+static std::atomic<uint32_t> g_materialFileGeneration = 0;
+uint32_t msys::get_material_file_generation() { return g_materialFileGeneration.load(std::memory_order_acquire); }
+namespace {
+	struct MaterialFileListeners {
+		std::mutex mutex;
+		std::unordered_map<uint32_t, msys::MaterialFileListener> listeners;
+		uint32_t nextId = 0;
+	};
+};
+static MaterialFileListeners &get_material_file_listeners()
+{
+	static MaterialFileListeners listeners {};
+	return listeners;
+}
+uint32_t msys::add_material_file_listener(const MaterialFileListener &listener)
+{
+	auto &listeners = get_material_file_listeners();
+	std::scoped_lock lock {listeners.mutex};
+	auto id = listeners.nextId++;
+	listeners.listeners[id] = listener;
+	return id;
+}
+void msys::remove_material_file_listener(uint32_t id)
+{
+	auto &listeners = get_material_file_listeners();
+	std::scoped_lock lock {listeners.mutex};
+	listeners.listeners.erase(id);
+}
+static void notify_material_file_listeners(const std::string &path)
+{
+	// The generation has to be incremented before the listeners are called, see MaterialManager::ResolveMaterialPath
+	g_materialFileGeneration.fetch_add(1, std::memory_order_acq_rel);
+	auto &listeners = get_material_file_listeners();
+	std::scoped_lock lock {listeners.mutex};
+	for(auto &pair : listeners.listeners)
+		pair.second(path);
+}
+void msys::notify_material_file_created(const std::string &path)
+{
+	auto &dirIndex = get_material_directory_index();
+	if(dirIndex.IsActive())
+		dirIndex.AddFile(path);
+	notify_material_file_listeners(path);
+}
+void msys::notify_material_file_removed(const std::string &path)
+{
+	auto &dirIndex = get_material_directory_index();
+	if(dirIndex.IsActive())
+		dirIndex.RemoveFile(path);
+	notify_material_file_listeners(path);
+}
+std::optional<std::string> msys::to_material_relative_path(const std::string &filePath)
+{
+	auto normalizedPath = DirectoryIndex::NormalizePath(filePath);
+	auto rootDir = DirectoryIndex::NormalizePath(MaterialManager::GetRootMaterialLocation()) + '/';
+	if(normalizedPath.compare(0, rootDir.length(), rootDir) == 0)
+		return normalizedPath.substr(rootDir.length());
+	// Addons (e.g. "addons/converted/materials/")
+	auto pos = normalizedPath.find('/' + rootDir);
+	if(pos == std::string::npos)
+		return {};
+	return normalizedPath.substr(pos + 1 + rootDir.length());
+}
+
+std::string msys::DirectoryIndex::NormalizePath(const std::string &path)
+{
+	auto normalizedPath = FileManager::GetNormalizedPath(path);
+	std::replace(normalizedPath.begin(), normalizedPath.end(), '\\', '/');
+	ustring::to_lower(normalizedPath);
+	return normalizedPath;
+}
+
+void msys::DirectoryIndex::RegisterExtension(const std::string &ext)
+{
+	auto lext = ext;
+	ustring::to_lower(lext);
+	std::unique_lock lock {m_mutex};
+	if(m_extensions.size() >= MAX_EXTENSIONS || std::find(m_extensions.begin(), m_extensions.end(), lext) != m_extensions.end())
+		return;
+	m_extensions.push_back(lext);
+}
+std::optional<uint32_t> msys::DirectoryIndex::FindExtensionIndex(const std::string &ext) const
+{
+	auto it = std::find(m_extensions.begin(), m_extensions.end(), ext);
+	if(it == m_extensions.end())
+		return {};
+	return static_cast<uint32_t>(it - m_extensions.begin());
+}
+bool msys::DirectoryIndex::SplitPath(const std::string &normalizedPath, std::string &outPath, uint32_t &outExtIndex) const
+{
+	std::string ext;
+	if(!ufile::get_extension(normalizedPath, &ext))
+		return false;
+	auto extIdx = FindExtensionIndex(ext);
+	if(!extIdx.has_value())
+		return false;
+	outPath = normalizedPath.substr(0, normalizedPath.length() - ext.length() - 1);
+	outExtIndex = *extIdx;
+	return true;
+}
+
+void msys::DirectoryIndex::Build(const std::string &rootDirectory)
+{
+	std::unordered_map<std::string, ExtensionMask> entries;
+	std::vector<std::string> dirs {""};
+	while(!dirs.empty()) {
+		auto dir = std::move(dirs.back());
+		dirs.pop_back();
+		std::vector<std::string> files;
+		std::vector<std::string> subDirs;
+		// Note: This also includes the files of mounted addons
+		FileManager::FindFiles((rootDirectory + '/' + dir + '*').c_str(), &files, &subDirs);
+		{
+			std::shared_lock lock {m_mutex};
+			for(auto &f : files) {
+				std::string path;
+				uint32_t extIdx;
+				if(SplitPath(NormalizePath(dir + f), path, extIdx))
+					entries[path] |= 1u << extIdx;
+			}
+		}
+		for(auto &subDir : subDirs) {
+			if(subDir == "." || subDir == "..")
+				continue;
+			dirs.push_back(dir + subDir + '/');
+		}
+	}
+	std::unique_lock lock {m_mutex};
+	m_entries = std::move(entries);
+	m_active = true;
+}
+void msys::DirectoryIndex::Clear()
+{
+	std::unique_lock lock {m_mutex};
+	m_entries.clear();
+	m_active = false;
+}
+
+void msys::DirectoryIndex::AddFile(const std::string &path)
+{
+	auto normalizedPath = NormalizePath(path);
+	std::unique_lock lock {m_mutex};
+	std::string key;
+	uint32_t extIdx;
+	if(SplitPath(normalizedPath, key, extIdx))
+		m_entries[key] |= 1u << extIdx;
+}
+void msys::DirectoryIndex::RemoveFile(const std::string &path)
+{
+	auto normalizedPath = NormalizePath(path);
+	std::unique_lock lock {m_mutex};
+	std::string key;
+	uint32_t extIdx;
+	if(!SplitPath(normalizedPath, key, extIdx))
+		return;
+	auto it = m_entries.find(key);
+	if(it == m_entries.end())
+		return;
+	it->second &= ~(1u << extIdx);
+	if(it->second == 0)
+		m_entries.erase(it);
+}
+
+msys::DirectoryIndex::ExtensionMask msys::DirectoryIndex::FindExtensions(const std::string &path) const
+{
+	std::shared_lock lock {m_mutex};
+	auto it = m_entries.find(path);
+	return (it != m_entries.end()) ? it->second : 0;
+}
+std::optional<std::string> msys::DirectoryIndex::FindFirstExtension(const std::string &path, const std::vector<std::string> &extensionsInOrderOfPreference) const
+{
+	std::shared_lock lock {m_mutex};
+	auto it = m_entries.find(path);
+	if(it == m_entries.end())
+		return {};
+	auto mask = it->second;
+	for(auto &ext : extensionsInOrderOfPreference) {
+		auto extIdx = FindExtensionIndex(ext);
+		if(extIdx.has_value() && (mask & (1u << *extIdx)) != 0)
+			return ext;
+	}
+	return {};
+}
+bool msys::DirectoryIndex::Exists(const std::string &path) const
+{
+	std::shared_lock lock {m_mutex};
+	std::string key;
+	uint32_t extIdx;
+	if(!SplitPath(path, key, extIdx))
+		return false;
+	auto it = m_entries.find(key);
+	return it != m_entries.end() && (it->second & (1u << extIdx)) != 0;
+}
+size_t msys::DirectoryIndex::GetEntryCount() const
+{
+	std::shared_lock lock {m_mutex};
+	return m_entries.size();
+}
@@ -0,0 +1,236 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "file_watcher.hpp"
+#include <filesystem>
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+static std::string to_relative_path(const std::filesystem::path &path, const std::filesystem::path &root) { return path.lexically_relative(root).generic_string(); }
+
+std::unique_ptr<msys::FileWatcher> msys::FileWatcher::Create(const std::string &rootDirectory, const FileWatcherSettings &settings)
+{
+	std::error_code ec;
+	if(!std::filesystem::is_directory(rootDirectory, ec))
+		return nullptr;
+	return std::unique_ptr<FileWatcher> {new FileWatcher {rootDirectory, settings}};
+}
+
+msys::FileWatcher::FileWatcher(const std::string &rootDirectory, const FileWatcherSettings &settings) : m_rootDirectory {std::filesystem::path {rootDirectory}.lexically_normal().generic_string()}, m_settings {settings}
+{
+	m_thread = std::thread {[this]() { Run(); }};
+}
+
+msys::FileWatcher::~FileWatcher()
+{
+	{
+		std::unique_lock lock {m_runMutex};
+		m_running = false;
+	}
+	m_runCondition.notify_all();
+	if(m_thread.joinable())
+		m_thread.join();
+}
+
+size_t msys::FileWatcher::GetPendingChangeCount() const
+{
+	std::scoped_lock lock {m_mutex};
+	return m_pendingChanges.size();
+}
+
+void msys::FileWatcher::AddChange(std::string path, ChangeType type)
+{
+	std::scoped_lock lock {m_mutex};
+	auto it = m_pendingChanges.find(path);
+	if(it == m_pendingChanges.end()) {
+		m_pendingChanges[std::move(path)] = {type, std::chrono::steady_clock::now()};
+		return;
+	}
+	auto &pending = it->second;
+	if(pending.type == ChangeType::Removed && type == ChangeType::Added)
+		pending.type = ChangeType::Modified; // Files are often replaced by writing a temporary file and renaming it
+	else if(pending.type != ChangeType::Added || type != ChangeType::Modified)
+		pending.type = type; // A file that has been added and modified since is still new from the perspective of the receiver
+	pending.lastChangeTime = std::chrono::steady_clock::now();
+}
+
+std::vector<msys::FileWatcher::Change> msys::FileWatcher::Poll()
+{
+	std::vector<Change> changes;
+	auto t = std::chrono::steady_clock::now();
+	std::scoped_lock lock {m_mutex};
+	for(auto it = m_pendingChanges.begin(); it != m_pendingChanges.end();) {
+		if(t - it->second.lastChangeTime < m_settings.debounceWindow) {
+			++it;
+			continue;
+		}
+		changes.push_back({it->first, it->second.type});
+		it = m_pendingChanges.erase(it);
+	}
+	return changes;
+}
+
+void msys::FileWatcher::Run()
+{
+#ifdef __linux__
+	if(!m_settings.forcePolling && InitializeInotify()) {
+		for(;;) {
+			{
+				std::unique_lock lock {m_runMutex};
+				if(!m_running)
+					break;
+			}
+			pollfd fd {};
+			fd.fd = m_inotifyFd;
+			fd.events = POLLIN;
+			// The timeout only determines how quickly the thread reacts to being stopped
+			auto res = ::poll(&fd, 1, 100);
+			if(res < 0 && errno != EINTR)
+				break;
+			if(res > 0 && !ReadInotifyEvents())
+				break;
+		}
+		ReleaseInotify();
+		std::unique_lock lock {m_runMutex};
+		if(!m_running)
+			return;
+		// Fall through to polling
+	}
+#endif
+	RunPolling();
+}
+
+void msys::FileWatcher::Scan(std::unordered_map<std::string, FileState> &outFiles) const
+{
+	std::error_code ec;
+	std::filesystem::path root {m_rootDirectory};
+	std::filesystem::recursive_directory_iterator it {root, std::filesystem::directory_options::skip_permission_denied, ec};
+	for(; !ec && it != std::filesystem::recursive_directory_iterator {}; it.increment(ec)) {
+		std::error_code ecEntry;
+		if(!it->is_regular_file(ecEntry))
+			continue;
+		FileState state {};
+		state.modificationTime = static_cast<int64_t>(it->last_write_time(ecEntry).time_since_epoch().count());
+		state.fileSize = static_cast<uint64_t>(it->file_size(ecEntry));
+		if(ecEntry)
+			continue; // File has been removed in the meantime
+		outFiles[to_relative_path(it->path(), root)] = state;
+	}
+}
+
+void msys::FileWatcher::RunPolling()
+{
+	m_polling = true;
+	std::unordered_map<std::string, FileState> files;
+	Scan(files);
+	for(;;) {
+		{
+			std::unique_lock lock {m_runMutex};
+			m_runCondition.wait_for(lock, m_settings.pollInterval, [this]() { return !m_running; });
+			if(!m_running)
+				break;
+		}
+		std::unordered_map<std::string, FileState> newFiles;
+		newFiles.reserve(files.size());
+		Scan(newFiles);
+		for(auto &pair : newFiles) {
+			auto it = files.find(pair.first);
+			if(it == files.end())
+				AddChange(pair.first, ChangeType::Added);
+			else if(it->second.modificationTime != pair.second.modificationTime || it->second.fileSize != pair.second.fileSize)
+				AddChange(pair.first, ChangeType::Modified);
+		}
+		for(auto &pair : files) {
+			if(newFiles.find(pair.first) == newFiles.end())
+				AddChange(pair.first, ChangeType::Removed);
+		}
+		files = std::move(newFiles);
+	}
+}
+
+#ifdef __linux__
+static constexpr uint32_t INOTIFY_WATCH_MASK = IN_CREATE | IN_DELETE | IN_MODIFY | IN_CLOSE_WRITE | IN_MOVED_FROM | IN_MOVED_TO;
+bool msys::FileWatcher::InitializeInotify()
+{
+	m_inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if(m_inotifyFd == -1)
+		return false;
+	if(!AddWatch("", false)) {
+		ReleaseInotify();
+		return false;
+	}
+	return true;
+}
+void msys::FileWatcher::ReleaseInotify()
+{
+	if(m_inotifyFd == -1)
+		return;
+	close(m_inotifyFd);
+	m_inotifyFd = -1;
+	m_watchDirectories.clear();
+}
+bool msys::FileWatcher::AddWatch(const std::string &relDir, bool reportFiles)
+{
+	std::filesystem::path root {m_rootDirectory};
+	auto absDir = relDir.empty() ? root : (root / relDir);
+	auto wd = inotify_add_watch(m_inotifyFd, absDir.c_str(), INOTIFY_WATCH_MASK);
+	if(wd == -1)
+		return errno == ENOENT; // Directory has been removed in the meantime, anything else means we've hit the watch limit
+	m_watchDirectories[wd] = relDir;
+
+	std::error_code ec;
+	std::filesystem::directory_iterator it {absDir, std::filesystem::directory_options::skip_permission_denied, ec};
+	for(; !ec && it != std::filesystem::directory_iterator {}; it.increment(ec)) {
+		std::error_code ecEntry;
+		if(it->is_directory(ecEntry)) {
+			if(!AddWatch(to_relative_path(it->path(), root), reportFiles))
+				return false;
+		}
+		else if(reportFiles && it->is_regular_file(ecEntry)) {
+			// Files that have been created before the watch was added won't produce any events
+			AddChange(to_relative_path(it->path(), root), ChangeType::Added);
+		}
+	}
+	return true;
+}
+bool msys::FileWatcher::ReadInotifyEvents()
+{
+	alignas(inotify_event) char buffer[4'096];
+	for(;;) {
+		auto len = read(m_inotifyFd, buffer, sizeof(buffer));
+		if(len <= 0)
+			return len == 0 || errno == EAGAIN || errno == EINTR;
+		for(auto *ptr = buffer; ptr < buffer + len;) {
+			auto &ev = *reinterpret_cast<const inotify_event *>(ptr);
+			ptr += sizeof(inotify_event) + ev.len;
+			if(ev.mask & IN_Q_OVERFLOW)
+				return false; // Events have been lost, the polling fallback will pick up from here
+			if(ev.mask & IN_IGNORED) {
+				m_watchDirectories.erase(ev.wd);
+				continue;
+			}
+			auto it = m_watchDirectories.find(ev.wd);
+			if(it == m_watchDirectories.end() || ev.len == 0)
+				continue;
+			auto path = it->second.empty() ? std::string {ev.name} : (it->second + '/' + ev.name);
+			if(ev.mask & IN_ISDIR) {
+				// New directories have to be watched as well. Directories that are removed release their watch automatically.
+				if((ev.mask & (IN_CREATE | IN_MOVED_TO)) && !AddWatch(path, true))
+					return false;
+				continue;
+			}
+			if(ev.mask & (IN_CREATE | IN_MOVED_TO))
+				AddChange(std::move(path), ChangeType::Added);
+			else if(ev.mask & (IN_DELETE | IN_MOVED_FROM))
+				AddChange(std::move(path), ChangeType::Removed);
+			else
+				AddChange(std::move(path), ChangeType::Modified);
+		}
+	}
+}
+#endif
@@ -0,0 +1,201 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "image_metadata_cache.hpp"
+#include "materialmanager.h"
+#include "util_binary_io.hpp"
+#include <fsys/filesystem.h>
+#include <sharedutils/util_string.h>
+#include <sharedutils/util_file.h>
+#include <filesystem>
+#include <array>
+#include <mutex>
+#include <vector>
+
+static std::array<char, 4> IMAGE_METADATA_CACHE_HEADER {'I', 'M', 'D', 'C'};
+
+static std::string normalize_texture_path(const std::string &path)
+{
+	auto normalizedPath = FileManager::GetNormalizedPath(path);
+	ustring::to_lower(normalizedPath);
+	return normalizedPath;
+}
+
+static bool get_file_stats(const std::string &filePath, uint64_t &outModificationTime, uint64_t &outFileSize)
+{
+	std::string absPath;
+	if(!FileManager::FindAbsolutePath(MaterialManager::GetRootMaterialLocation() + '/' + filePath, absPath))
+		return false; // File doesn't exist or is located in an archive
+	std::error_code ec;
+	auto t = std::filesystem::last_write_time(absPath, ec);
+	if(ec)
+		return false;
+	auto size = std::filesystem::file_size(absPath, ec);
+	if(ec)
+		return false;
+	outModificationTime = static_cast<uint64_t>(t.time_since_epoch().count());
+	outFileSize = static_cast<uint64_t>(size);
+	return true;
+}
+
+static bool is_same_metadata(const msys::ImageMetadata &a, const msys::ImageMetadata &b)
+{
+	return a.width == b.width && a.height == b.height && a.format == b.format && a.layerCount == b.layerCount && a.mipmapCount == b.mipmapCount && a.flags == b.flags && a.dataOffset == b.dataOffset;
+}
+
+msys::ImageMetadataCache &msys::get_image_metadata_cache()
+{
+	static ImageMetadataCache cache {};
+	return cache;
+}
+// The cache is kept outside of the material directory, so it isn't picked up by the file watcher
+std::string msys::get_image_metadata_cache_path() { return "cache/" + MaterialManager::GetRootMaterialLocation() + '/' + ImageMetadataCache::FILE_NAME; }
+
+bool msys::ImageMetadataCache::IsDirty() const
+{
+	std::shared_lock lock {m_mutex};
+	return m_dirty;
+}
+size_t msys::ImageMetadataCache::GetEntryCount() const
+{
+	std::shared_lock lock {m_mutex};
+	return m_entries.size();
+}
+void msys::ImageMetadataCache::Clear()
+{
+	std::unique_lock lock {m_mutex};
+	m_entries.clear();
+	m_dirty = true;
+}
+void msys::ImageMetadataCache::Invalidate(const std::string &texturePath)
+{
+	auto key = normalize_texture_path(texturePath);
+	std::unique_lock lock {m_mutex};
+	if(m_entries.erase(key) > 0)
+		m_dirty = true;
+}
+
+std::optional<msys::ImageMetadata> msys::ImageMetadataCache::Find(const std::string &texturePath, std::string *outFilePath) const
+{
+	auto key = normalize_texture_path(texturePath);
+	Entry entry;
+	{
+		std::shared_lock lock {m_mutex};
+		auto it = m_entries.find(key);
+		if(it == m_entries.end())
+			return {};
+		entry = it->second;
+	}
+	if(!entry.validated) {
+		// Stat'ing the file is a lot cheaper than locating and opening it, but it's still only done once per entry
+		uint64_t modificationTime, fileSize;
+		if(!get_file_stats(entry.filePath, modificationTime, fileSize) || modificationTime != entry.modificationTime || fileSize != entry.fileSize)
+			return {};
+		std::unique_lock lock {m_mutex};
+		auto it = m_entries.find(key);
+		if(it != m_entries.end() && it->second.modificationTime == modificationTime && it->second.fileSize == fileSize)
+			it->second.validated = true;
+	}
+	if(outFilePath)
+		*outFilePath = std::move(entry.filePath);
+	return entry.metadata;
+}
+
+void msys::ImageMetadataCache::Store(const std::string &texturePath, const std::string &filePath, const ImageMetadata &metadata)
+{
+	auto key = normalize_texture_path(texturePath);
+	auto normalizedFilePath = normalize_texture_path(filePath);
+	{
+		// Textures are stored every time they're loaded, in which case the file doesn't have to be checked again
+		std::shared_lock lock {m_mutex};
+		auto it = m_entries.find(key);
+		if(it != m_entries.end()) {
+			auto &existing = it->second;
+			if(existing.validated && existing.filePath == normalizedFilePath) {
+				if(is_same_metadata(existing.metadata, metadata))
+					return;
+				auto sizeOnly = !umath::is_flag_set(metadata.flags, ImageMetadata::Flags::HeaderBit);
+				if(sizeOnly && umath::is_flag_set(existing.metadata.flags, ImageMetadata::Flags::HeaderBit) && existing.metadata.width == metadata.width && existing.metadata.height == metadata.height)
+					return;
+			}
+		}
+	}
+	Entry entry {};
+	entry.filePath = std::move(normalizedFilePath);
+	if(!get_file_stats(entry.filePath, entry.modificationTime, entry.fileSize))
+		return;
+	entry.metadata = metadata;
+	entry.validated = true;
+
+	std::unique_lock lock {m_mutex};
+	m_entries[key] = std::move(entry);
+	m_dirty = true;
+}
+
+using namespace msys::binary_io;
+
+bool msys::ImageMetadataCache::Load(const std::string &fileName)
+{
+	auto f = FileManager::OpenFile(fileName.c_str(), "rb");
+	if(f == nullptr)
+		return false;
+	// The file is read in one go and then parsed from memory
+	std::vector<uint8_t> data;
+	data.resize(f->GetSize());
+	if(f->Read(data.data(), data.size()) != data.size())
+		return false;
+	f = nullptr;
+
+	size_t offset = 0;
+	std::array<char, 4> header;
+	uint32_t version;
+	uint32_t numEntries;
+	if(!read_value(data, offset, header) || header != IMAGE_METADATA_CACHE_HEADER || !read_value(data, offset, version) || version != FORMAT_VERSION || !read_value(data, offset, numEntries))
+		return false;
+	std::unordered_map<std::string, Entry> entries;
+	entries.reserve(numEntries);
+	for(auto i = decltype(numEntries) {0u}; i < numEntries; ++i) {
+		std::string key;
+		Entry entry {};
+		if(!read_string(data, offset, key) || !read_string(data, offset, entry.filePath) || !read_value(data, offset, entry.modificationTime) || !read_value(data, offset, entry.fileSize) || !read_value(data, offset, entry.metadata))
+			return false;
+		entries[std::move(key)] = std::move(entry);
+	}
+
+	std::unique_lock lock {m_mutex};
+	// Entries that have been added in the meantime take precedence
+	for(auto &pair : m_entries)
+		entries[pair.first] = std::move(pair.second);
+	m_entries = std::move(entries);
+	m_loaded = true;
+	return true;
+}
+
+bool msys::ImageMetadataCache::Save(const std::string &fileName)
+{
+	std::vector<uint8_t> data;
+	{
+		std::shared_lock lock {m_mutex};
+		data.reserve(IMAGE_METADATA_CACHE_HEADER.size() + sizeof(uint32_t) * 2 + m_entries.size() * 128);
+		write_value(data, IMAGE_METADATA_CACHE_HEADER);
+		write_value(data, FORMAT_VERSION);
+		write_value(data, static_cast<uint32_t>(m_entries.size()));
+		for(auto &pair : m_entries) {
+			auto &entry = pair.second;
+			write_string(data, pair.first);
+			write_string(data, entry.filePath);
+			write_value(data, entry.modificationTime);
+			write_value(data, entry.fileSize);
+			write_value(data, entry.metadata);
+		}
+	}
+	FileManager::CreatePath(ufile::get_path_from_filename(fileName).c_str());
+	auto f = FileManager::OpenFile<VFilePtrReal>(fileName.c_str(), "wb");
+	if(f == nullptr)
+		return false;
+	f->Write(data.data(), data.size());
+	std::unique_lock lock {m_mutex};
+	m_dirty = false;
+	return true;
+}
@@ -3,6 +3,7 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 
 #include "impl_texture_formats.h"
+#include "directory_index.hpp"
 #include <fsys/filesystem.h>
 #include <sharedutils/util_file.h>
 
@@ -32,9 +33,12 @@ const std::vector<MaterialManager::ImageFormat> &MaterialManager::get_supported_
 }
 std::string translate_image_path(const std::string &imgFile, TextureType &type, std::string path, const std::function<VFilePtr(const std::string &)> &fileHandler, bool *optOutFound)
 {
+	// The directory index only covers the material directory
+	auto &dirIndex = msys::get_material_directory_index();
+	auto useDirIndex = dirIndex.IsActive() && ustring::compare<std::string>(path, MaterialManager::GetRootMaterialLocation() + '/', false);
 	path += FileManager::GetNormalizedPath(imgFile);
 	ustring::to_lower(path);
-	auto formats = MaterialManager::get_supported_image_formats();
+	auto &formats = MaterialManager::get_supported_image_formats();
 	type = formats.front().type;
 
 	std::string ext {};
@@ -45,7 +49,36 @@ std::string translate_image_path(const std::string &imgFile, TextureType &type,
 		type = it->type;
 		bFoundType = true;
 	}
-	if(bFoundType == false) {
+	if(bFoundType == false && useDirIndex) {
+		static const std::vector<std::string> imageFormatExtensions = []() {
+			std::vector<std::string> extensions;
+			for(auto &format : MaterialManager::get_supported_image_formats())
+				extensions.push_back(format.extension);
+			return extensions;
+		}();
+		auto indexedExt = dirIndex.FindFirstExtension(msys::DirectoryIndex::NormalizePath(imgFile), imageFormatExtensions);
+		if(indexedExt.has_value()) {
+			auto it = std::find_if(formats.begin(), formats.end(), [&indexedExt](const MaterialManager::ImageFormat &format) { return *indexedExt == format.extension; });
+			path += '.' + *indexedExt;
+			type = it->type;
+			bFoundType = true;
+		}
+		else if(fileHandler) {
+			// The file handler may import the texture, in which case it has to be added to the index
+			fileHandler(path);
+			for(auto &format : formats) {
+				auto formatPath = path + '.' + format.extension;
+				if(FileManager::Exists(formatPath)) {
+					dirIndex.AddFile(FileManager::GetNormalizedPath(imgFile) + '.' + format.extension);
+					path = std::move(formatPath);
+					type = format.type;
+					bFoundType = true;
+					break;
+				}
+			}
+		}
+	}
+	else if(bFoundType == false) {
 		auto fFindFormat = [&formats, &path, &type, &bFoundType]() -> bool {
 			for(auto &format : formats) {
 				auto formatPath = path;
@@ -0,0 +1,237 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "import_cache.hpp"
+#include "directory_index.hpp"
+#include "material_sort_key.hpp"
+#include "materialmanager.h"
+#include "util_binary_io.hpp"
+#include <fsys/filesystem.h>
+#include <sharedutils/util_file.h>
+#include <array>
+#include <mutex>
+
+static std::array<char, 4> IMPORT_CACHE_HEADER {'I', 'M', 'P', 'C'};
+
+// FNV-1a, the keys have to be stable across program runs, which std::hash doesn't guarantee
+static uint64_t hash_bytes(const void *data, size_t size, uint64_t hash = 14'695'981'039'346'656'037ull)
+{
+	auto *bytes = static_cast<const uint8_t *>(data);
+	for(auto i = decltype(size) {0u}; i < size; ++i) {
+		hash ^= bytes[i];
+		hash *= 1'099'511'628'211ull;
+	}
+	return hash;
+}
+
+static bool read_file(const std::string &filePath, std::vector<uint8_t> &outData)
+{
+	auto f = FileManager::OpenFile(filePath.c_str(), "rb");
+	if(f == nullptr)
+		return false;
+	outData.resize(f->GetSize());
+	return f->Read(outData.data(), outData.size()) == outData.size();
+}
+
+msys::ImportCache &msys::get_import_cache()
+{
+	static ImportCache cache {};
+	return cache;
+}
+std::string msys::get_import_cache_path() { return "cache/" + MaterialManager::GetRootMaterialLocation() + '/' + ImportCache::FILE_NAME; }
+
+uint64_t msys::ImportCache::ComputeKey(const void *data, size_t size, const std::string &converter)
+{
+	auto key = hash_bytes(data, size);
+	key = CombineKeys(key, hash_bytes(converter.data(), converter.size()));
+	return CombineKeys(key, CONVERTER_VERSION);
+}
+std::optional<uint64_t> msys::ImportCache::ComputeFileKey(const std::string &filePath, const std::string &converter)
+{
+	std::vector<uint8_t> data;
+	if(!read_file(filePath, data))
+		return {};
+	return ComputeKey(data.data(), data.size(), converter);
+}
+uint64_t msys::ImportCache::CombineKeys(uint64_t key0, uint64_t key1) { return hash_combine(key0, key1); }
+std::string msys::ImportCache::KeyToString(uint64_t key)
+{
+	static constexpr const char *digits = "0123456789abcdef";
+	std::string str(16, '0');
+	for(auto i = str.size(); i > 0; --i) {
+		str[i - 1] = digits[key & 0xF];
+		key >>= 4;
+	}
+	return str;
+}
+
+bool msys::ImportCache::IsDirty() const
+{
+	std::shared_lock lock {m_mutex};
+	return m_dirty;
+}
+size_t msys::ImportCache::GetEntryCount() const
+{
+	std::shared_lock lock {m_mutex};
+	return m_entries.size();
+}
+void msys::ImportCache::Clear()
+{
+	std::unique_lock lock {m_mutex};
+	m_entries.clear();
+	m_dirty = true;
+}
+void msys::ImportCache::Invalidate(uint64_t key)
+{
+	std::unique_lock lock {m_mutex};
+	if(m_entries.erase(key) > 0)
+		m_dirty = true;
+}
+
+std::optional<msys::ImportCache::Entry> msys::ImportCache::Find(uint64_t key) const
+{
+	Entry entry;
+	{
+		std::shared_lock lock {m_mutex};
+		auto it = m_entries.find(key);
+		if(it == m_entries.end())
+			return {};
+		entry = it->second;
+	}
+	if(entry.fileHashes.size() != entry.files.size())
+		return {};
+	std::vector<uint8_t> data;
+	for(size_t i = 0; i < entry.files.size(); ++i) {
+		// Output has been deleted or modified, the import has to be repeated
+		if(!read_file(entry.files[i], data) || hash_bytes(data.data(), data.size()) != entry.fileHashes[i])
+			return {};
+	}
+	return entry;
+}
+
+bool msys::ImportCache::Store(uint64_t key, Entry entry)
+{
+	entry.fileHashes.clear();
+	entry.fileHashes.reserve(entry.files.size());
+	std::vector<uint8_t> data;
+	for(auto &filePath : entry.files) {
+		filePath = FileManager::GetNormalizedPath(filePath);
+		if(!read_file(filePath, data))
+			return false;
+		entry.fileHashes.push_back(hash_bytes(data.data(), data.size()));
+	}
+	std::unique_lock lock {m_mutex};
+	m_entries[key] = std::move(entry);
+	m_dirty = true;
+	return true;
+}
+
+bool msys::ImportCache::Restore(uint64_t key, const std::string &outFilePath)
+{
+	auto entry = Find(key);
+	if(!entry || entry->files.empty())
+		return false;
+	auto &srcFilePath = entry->files.front();
+	if(srcFilePath == FileManager::GetNormalizedPath(outFilePath))
+		return true;
+	std::vector<uint8_t> data;
+	if(!read_file(srcFilePath, data))
+		return false;
+	FileManager::CreatePath(ufile::get_path_from_filename(outFilePath).c_str());
+	auto f = FileManager::OpenFile<VFilePtrReal>(outFilePath.c_str(), "wb");
+	if(f == nullptr)
+		return false;
+	if(f->Write(data.data(), data.size()) != data.size())
+		return false;
+	f = nullptr;
+	if(auto relPath = to_material_relative_path(outFilePath))
+		notify_material_file_created(*relPath);
+	return true;
+}
+
+using namespace msys::binary_io;
+
+bool msys::ImportCache::Load(const std::string &fileName)
+{
+	std::vector<uint8_t> data;
+	if(!read_file(fileName, data))
+		return false;
+
+	size_t offset = 0;
+	std::array<char, 4> header;
+	uint32_t version;
+	uint32_t converterVersion;
+	uint32_t numEntries;
+	if(!read_value(data, offset, header) || header != IMPORT_CACHE_HEADER || !read_value(data, offset, version) || version != FORMAT_VERSION || !read_value(data, offset, converterVersion) || !read_value(data, offset, numEntries))
+		return false;
+	std::unordered_map<uint64_t, Entry> entries;
+	// The converter version is part of the keys, so outdated entries could never be hit again
+	if(converterVersion == CONVERTER_VERSION) {
+		entries.reserve(numEntries);
+		auto readStrings = [&data, &offset](std::vector<std::string> &outStrings) -> bool {
+			uint32_t count;
+			if(!read_value(data, offset, count))
+				return false;
+			outStrings.resize(count);
+			for(auto &str : outStrings) {
+				if(!read_string(data, offset, str))
+					return false;
+			}
+			return true;
+		};
+		for(auto i = decltype(numEntries) {0u}; i < numEntries; ++i) {
+			uint64_t key;
+			Entry entry {};
+			if(!read_value(data, offset, key) || !readStrings(entry.assets) || !readStrings(entry.files))
+				return false;
+			entry.fileHashes.resize(entry.files.size());
+			for(auto &hash : entry.fileHashes) {
+				if(!read_value(data, offset, hash))
+					return false;
+			}
+			entries[key] = std::move(entry);
+		}
+	}
+
+	std::unique_lock lock {m_mutex};
+	// Entries that have been added in the meantime take precedence
+	for(auto &pair : m_entries)
+		entries[pair.first] = std::move(pair.second);
+	m_entries = std::move(entries);
+	m_loaded = true;
+	return true;
+}
+
+bool msys::ImportCache::Save(const std::string &fileName)
+{
+	std::vector<uint8_t> data;
+	{
+		std::shared_lock lock {m_mutex};
+		data.reserve(IMPORT_CACHE_HEADER.size() + sizeof(uint32_t) * 3 + m_entries.size() * 128);
+		write_value(data, IMPORT_CACHE_HEADER);
+		write_value(data, FORMAT_VERSION);
+		write_value(data, CONVERTER_VERSION);
+		write_value(data, static_cast<uint32_t>(m_entries.size()));
+		auto writeStrings = [&data](const std::vector<std::string> &strings) {
+			write_value(data, static_cast<uint32_t>(strings.size()));
+			for(auto &str : strings)
+				write_string(data, str);
+		};
+		for(auto &pair : m_entries) {
+			write_value(data, pair.first);
+			writeStrings(pair.second.assets);
+			writeStrings(pair.second.files);
+			for(auto hash : pair.second.fileHashes)
+				write_value(data, hash);
+		}
+	}
+	FileManager::CreatePath(ufile::get_path_from_filename(fileName).c_str());
+	auto f = FileManager::OpenFile<VFilePtrReal>(fileName.c_str(), "wb");
+	if(f == nullptr)
+		return false;
+	f->Write(data.data(), data.size());
+	std::unique_lock lock {m_mutex};
+	m_dirty = false;
+	return true;
+}
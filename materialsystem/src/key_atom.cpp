@@ -0,0 +1,113 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "key_atom.hpp"
+#include <unordered_map>
+#include <shared_mutex>
+#include <mutex>
+#include <deque>
+#include <array>
+
+namespace msys {
+	struct KeyAtomTable {
+		KeyAtomTable();
+		KeyAtom Intern(const std::string &key);
+		std::shared_mutex mutex;
+		std::unordered_map<std::string, KeyAtom> keyToAtom;
+		std::deque<std::string> names; // std::deque, so references to names are never invalidated
+	};
+};
+
+msys::KeyAtomTable::KeyAtomTable()
+{
+	// Has to match the order of the key_atoms enum!
+	// Note: These are intentionally not using the Material identifiers, since the table may be
+	// initialized before the static strings of Material have been.
+	constexpr std::array<const char *, key_atoms::Count> builtinKeys = {
+	  "diffuse_map",
+	  "albedo_map",
+	  "albedo_map2",
+	  "albedo_map3",
+	  "normal_map",
+	  "emission_map",
+	  "parallax_map",
+	  "alpha_map",
+	  "rma_map",
+	  "dudv_map",
+	  "wrinkle_stretch_map",
+	  "wrinkle_compress_map",
+	  "exponent_map",
+
+	  "alpha_mode",
+	  "alpha_cutoff",
+	  "color_factor",
+	  "bloom_color_factor",
+	};
+	keyToAtom.reserve(256);
+	for(auto *key : builtinKeys)
+		Intern(key);
+}
+msys::KeyAtom msys::KeyAtomTable::Intern(const std::string &key)
+{
+	auto it = keyToAtom.find(key);
+	if(it != keyToAtom.end())
+		return it->second;
+	auto atom = static_cast<KeyAtom>(names.size());
+	names.push_back(key);
+	keyToAtom[key] = atom;
+	return atom;
+}
+
+static msys::KeyAtomTable &get_key_atom_table()
+{
+	static msys::KeyAtomTable table {};
+	return table;
+}
+
+msys::KeyAtom msys::intern_key(const std::string &key)
+{
+	auto &table = get_key_atom_table();
+	{
+		std::shared_lock lock {table.mutex};
+		auto it = table.keyToAtom.find(key);
+		if(it != table.keyToAtom.end())
+			return it->second;
+	}
+	std::unique_lock lock {table.mutex};
+	return table.Intern(key);
+}
+msys::KeyAtom msys::find_key_atom(const std::string &key)
+{
+	auto &table = get_key_atom_table();
+	std::shared_lock lock {table.mutex};
+	auto it = table.keyToAtom.find(key);
+	return (it != table.keyToAtom.end()) ? it->second : INVALID_KEY_ATOM;
+}
+uint32_t msys::find_key_atoms(const std::vector<const std::string *> &keys, std::vector<KeyAtom> &outAtoms)
+{
+	auto &table = get_key_atom_table();
+	outAtoms.resize(keys.size());
+	std::shared_lock lock {table.mutex};
+	for(auto i = decltype(keys.size()) {0u}; i < keys.size(); ++i) {
+		auto it = table.keyToAtom.find(*keys[i]);
+		outAtoms[i] = (it != table.keyToAtom.end()) ? it->second : INVALID_KEY_ATOM;
+	}
+	return static_cast<uint32_t>(table.names.size());
+}
+const std::string &msys::get_key_name(KeyAtom atom)
+{
+	auto &table = get_key_atom_table();
+	std::shared_lock lock {table.mutex};
+	if(atom >= table.names.size()) {
+		static std::string empty;
+		return empty;
+	}
+	return table.names[atom];
+}
+uint32_t msys::get_key_atom_count()
+{
+	auto &table = get_key_atom_table();
+	std::shared_lock lock {table.mutex};
+	return static_cast<uint32_t>(table.names.size());
+}
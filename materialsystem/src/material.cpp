@@ -6,9 +6,12 @@
 #include "material_copy.hpp"
 #include "materialmanager.h"
 #include "material_manager2.hpp"
+#include "data_value_type.hpp"
+#include "directory_index.hpp"
 #include <sharedutils/alpha_mode.hpp>
 #include <sharedutils/util_shaderinfo.hpp>
 #include <sstream>
+#include <array>
 #include <fsys/filesystem.h>
 #include <datasystem_vector.h>
 #include <sharedutils/util_string.h>
@@ -65,19 +68,156 @@ void Material::Assign(const Material &other)
 	m_stateFlags = StateFlags::Loaded;
 	if(umath::is_flag_set(other.m_stateFlags, StateFlags::Error))
 		m_stateFlags |= StateFlags::Error;
-	m_data = other.m_data;
+	ShareDataBlock(other);
 	m_shaderInfo = other.m_shaderInfo;
 	m_shader = other.m_shader ? std::make_unique<std::string>(*other.m_shader) : nullptr;
 	// m_index = other.m_index;
+	CompileParameters();
 
 	if(IsValid())
 		UpdateTextures();
 }
 
+static Material::ChangeFlags get_change_flags(ds::Base &value)
+{
+	switch(msys::get_data_value_type(value)) {
+	case msys::DataValueType::Texture:
+		return Material::ChangeFlags::TexturesBit;
+	case msys::DataValueType::Block:
+	case msys::DataValueType::Container:
+		// We don't know whether the block contains any textures
+		return Material::ChangeFlags::ParametersBit | Material::ChangeFlags::TexturesBit;
+	default:
+		return Material::ChangeFlags::ParametersBit;
+	}
+}
+static void assign_unchanged_values(ds::Block &oldData, ds::Block &newData, Material::ChangeFlags &changes);
+// Compares a value of the new data block with the value of the same key in the old data block. Textures which still refer
+// to the same texture take over the texture of the old value.
+static void assign_unchanged_value(ds::Base &oldValue, ds::Base &newValue, Material::ChangeFlags &changes)
+{
+	auto type = msys::get_data_value_type(newValue);
+	if(type != msys::get_data_value_type(oldValue)) {
+		changes |= get_change_flags(oldValue) | get_change_flags(newValue);
+		return;
+	}
+	switch(type) {
+	case msys::DataValueType::Block:
+		assign_unchanged_values(static_cast<ds::Block &>(oldValue), static_cast<ds::Block &>(newValue), changes);
+		break;
+	case msys::DataValueType::Container:
+		{
+			auto &oldChildren = static_cast<ds::Container &>(oldValue).GetBlocks();
+			auto &newChildren = static_cast<ds::Container &>(newValue).GetBlocks();
+			if(oldChildren.size() != newChildren.size())
+				changes |= get_change_flags(newValue);
+			auto n = umath::min(oldChildren.size(), newChildren.size());
+			for(size_t i = 0; i < n; ++i)
+				assign_unchanged_value(*oldChildren[i], *newChildren[i], changes);
+			break;
+		}
+	case msys::DataValueType::Texture:
+		{
+			auto &oldTexInfo = static_cast<ds::Texture &>(oldValue).GetValue();
+			auto &newTexInfo = static_cast<ds::Texture &>(newValue).GetValue();
+			if(oldTexInfo.name != newTexInfo.name) {
+				changes |= Material::ChangeFlags::TexturesBit;
+				break;
+			}
+			newTexInfo = oldTexInfo;
+			break;
+		}
+	case msys::DataValueType::Unknown:
+		if(&oldValue != &newValue)
+			changes |= Material::ChangeFlags::ParametersBit;
+		break;
+	default:
+		if(static_cast<ds::Value &>(oldValue).GetString() != static_cast<ds::Value &>(newValue).GetString())
+			changes |= Material::ChangeFlags::ParametersBit;
+		break;
+	}
+}
+static void assign_unchanged_values(ds::Block &oldData, ds::Block &newData, Material::ChangeFlags &changes)
+{
+	auto *oldValues = oldData.GetData();
+	auto *newValues = newData.GetData();
+	if(!oldValues || !newValues) {
+		for(auto *values : {oldValues, newValues}) {
+			if(!values)
+				continue;
+			for(auto &pair : *values)
+				changes |= get_change_flags(*pair.second);
+		}
+		return;
+	}
+	for(auto &pair : *newValues) {
+		auto it = oldValues->find(pair.first);
+		if(it == oldValues->end()) {
+			changes |= get_change_flags(*pair.second);
+			continue;
+		}
+		assign_unchanged_value(*it->second, *pair.second, changes);
+	}
+	// Values that have been removed
+	for(auto &pair : *oldValues) {
+		if(newValues->find(pair.first) == newValues->end())
+			changes |= get_change_flags(*pair.second);
+	}
+}
+
+bool Material::CanAssignChanges(const Material &other) const
+{
+	if(!m_data || !other.m_data || !IsValid() || !other.IsValid())
+		return false;
+	return IsError() == other.IsError() && GetShaderIdentifier() == other.GetShaderIdentifier();
+}
+
+Material::ChangeFlags Material::AssignChanges(const Material &other)
+{
+	if(!CanAssignChanges(other)) {
+		Assign(other);
+		return ChangeFlags::ParametersBit | ChangeFlags::TexturesBit | ChangeFlags::ShaderBit;
+	}
+	// The textures that are kept are written into a copy of the other block, the other material must not be modified
+	auto data = msys::shallow_copy_data_block(*other.m_data, *m_manager.CreateDataSettings());
+	auto changes = ChangeFlags::None;
+	assign_unchanged_values(*m_data, *data, changes);
+	if(changes == ChangeFlags::None)
+		return changes;
+	m_data = data;
+	m_dataBlockShared = false;
+	CompileParameters();
+	// The texture pointers still refer to the old data block
+	umath::set_flag(m_stateFlags, StateFlags::TexturesUpdated, false);
+	OnChangesAssigned(changes);
+	return changes;
+}
+
+Material::ChangeFlags Material::ApplyValues(const std::unordered_map<std::string, std::shared_ptr<ds::Base>> &values)
+{
+	if(values.empty() || !m_data)
+		return ChangeFlags::None;
+	auto changes = ChangeFlags::None;
+	auto &data = GetMutableDataBlock();
+	for(auto &pair : values) {
+		auto &oldValue = data->GetValue(pair.first);
+		if(oldValue)
+			changes |= get_change_flags(*oldValue);
+		changes |= get_change_flags(*pair.second);
+		data->AddData(pair.first, pair.second);
+	}
+	OnChangesAssigned(changes);
+	return changes;
+}
+
+void Material::OnChangesAssigned(ChangeFlags changes) { UpdateTextures(); }
+
 void Material::Reset()
 {
-	umath::set_flag(m_stateFlags, StateFlags::Loaded, false);
+	umath::set_flag(m_stateFlags, StateFlags::Loaded | StateFlags::ParametersDirty, false);
 	m_data = nullptr;
+	m_dataBlockShared = false;
+	m_parameters.Clear();
 	m_shaderInfo.reset();
 	m_shader = nullptr;
 	m_texDiffuse = nullptr;
@@ -87,6 +227,8 @@ void Material::Reset()
 	m_texParallax = nullptr;
 	m_texRma = nullptr;
 	m_texAlpha = nullptr;
+	m_sortKey = 0;
+	m_renderFeatureFlags = msys::RenderFeatureFlags::None;
 }
 
 void Material::Initialize(const util::WeakHandle<util::ShaderInfo> &shaderInfo, const std::shared_ptr<ds::Block> &data)
@@ -94,6 +236,7 @@ void Material::Initialize(const util::WeakHandle<util::ShaderInfo> &shaderInfo,
 	Reset();
 	SetShaderInfo(shaderInfo);
 	m_data = data;
+	CompileParameters();
 	Initialize(m_data);
 }
 
@@ -102,15 +245,50 @@ void Material::Initialize(const std::string &shader, const std::shared_ptr<ds::B
 	Reset();
 	m_shader = std::make_unique<std::string>(shader);
 	m_data = data;
+	CompileParameters();
 	Initialize(m_data);
 }
 
 void Material::Initialize(const std::shared_ptr<ds::Block> &data) {}
 
+void Material::CompileParameters()
+{
+	umath::set_flag(m_stateFlags, StateFlags::ParametersDirty, false);
+	if(!m_data) {
+		m_parameters.Clear();
+		return;
+	}
+	using BuiltinParameter = msys::ParameterSchema::BuiltinParameter;
+	m_parameters.Compile(m_manager.FindParameterSchema(GetShaderIdentifier()), *m_data);
+
+	// The alpha mode may also be specified by name
+	auto alphaMode = static_cast<AlphaMode>(m_parameters.Get<int32_t>(BuiltinParameter::AlphaMode));
+	if(m_data->IsString("alpha_mode")) {
+		auto e = magic_enum::enum_cast<AlphaMode>(m_data->GetString("alpha_mode"));
+		alphaMode = e.has_value() ? *e : AlphaMode::Opaque;
+		m_parameters.Set<int32_t>(BuiltinParameter::AlphaMode, umath::to_integral(alphaMode));
+	}
+	m_alphaMode = alphaMode;
+}
+void Material::UpdateParameters() const
+{
+	if(umath::is_flag_set(m_stateFlags, StateFlags::ParametersDirty))
+		const_cast<Material *>(this)->CompileParameters();
+}
+const msys::CompiledParameters &Material::GetCompiledParameters() const
+{
+	UpdateParameters();
+	return m_parameters;
+}
+
 void *Material::GetUserData() { return m_userData; }
 void Material::SetUserData(void *data) { m_userData = data; }
 
-bool Material::IsTranslucent() const { return m_alphaMode == AlphaMode::Blend; }
+bool Material::IsTranslucent() const
+{
+	UpdateParameters();
+	return m_alphaMode == AlphaMode::Blend;
+}
 
 void Material::UpdateTextures()
 {
@@ -124,30 +302,56 @@ void Material::UpdateTextures()
 		return;
 	umath::set_flag(m_stateFlags, StateFlags::TexturesUpdated);
 
-	m_texDiffuse = GetTextureInfo(DIFFUSE_MAP_IDENTIFIER);
+	UpdateParameters();
+
+	using BuiltinParameter = msys::ParameterSchema::BuiltinParameter;
+	m_texDiffuse = m_parameters.GetTexture(BuiltinParameter::DiffuseMap);
 	if(!m_texDiffuse)
-		m_texDiffuse = GetTextureInfo(ALBEDO_MAP_IDENTIFIER);
-
-	m_texNormal = GetTextureInfo(NORMAL_MAP_IDENTIFIER);
-	m_texGlow = GetTextureInfo(EMISSION_MAP_IDENTIFIER);
-	m_texParallax = GetTextureInfo(PARALLAX_MAP_IDENTIFIER);
-	m_texAlpha = GetTextureInfo(ALPHA_MAP_IDENTIFIER);
-	m_texRma = GetTextureInfo(RMA_MAP_IDENTIFIER);
-
-	auto &data = GetDataBlock();
-	if(data->IsString("alpha_mode")) {
-		auto e = magic_enum::enum_cast<AlphaMode>(data->GetString("alpha_mode"));
-		m_alphaMode = e.has_value() ? *e : AlphaMode::Opaque;
-	}
-	else
-		m_alphaMode = static_cast<AlphaMode>(data->GetInt("alpha_mode", umath::to_integral(AlphaMode::Opaque)));
+		m_texDiffuse = m_parameters.GetTexture(BuiltinParameter::AlbedoMap);
+
+	m_texNormal = m_parameters.GetTexture(BuiltinParameter::NormalMap);
+	m_texGlow = m_parameters.GetTexture(BuiltinParameter::EmissionMap);
+	m_texParallax = m_parameters.GetTexture(BuiltinParameter::ParallaxMap);
+	m_texAlpha = m_parameters.GetTexture(BuiltinParameter::AlphaMap);
+	m_texRma = m_parameters.GetTexture(BuiltinParameter::RmaMap);
 
 	++m_updateIndex;
+	UpdateRenderSortData();
 	OnTexturesUpdated();
 }
 
 void Material::OnTexturesUpdated() {}
 
+uint64_t Material::ComputeTextureSetHash() const
+{
+	// Texture names are used instead of the texture objects, since the latter may not have been loaded yet
+	uint64_t hash = 0;
+	for(auto *tex : {m_texDiffuse, m_texNormal, m_texGlow, m_texParallax, m_texAlpha, m_texRma})
+		hash = msys::hash_combine(hash, tex ? std::hash<std::string> {}(tex->name) : 0);
+	return hash;
+}
+msys::RenderFeatureFlags Material::ComputeRenderFeatureFlags() const
+{
+	auto flags = msys::RenderFeatureFlags::None;
+	if(m_texNormal)
+		flags |= msys::RenderFeatureFlags::NormalMapBit;
+	if(m_texRma)
+		flags |= msys::RenderFeatureFlags::RmaMapBit;
+	if(m_texGlow)
+		flags |= msys::RenderFeatureFlags::EmissionMapBit;
+	if(m_texParallax)
+		flags |= msys::RenderFeatureFlags::ParallaxMapBit;
+	if(IsTranslucent())
+		flags |= msys::RenderFeatureFlags::TranslucentBit;
+	return flags;
+}
+void Material::UpdateRenderSortData()
+{
+	m_sortKey = msys::make_sort_key(msys::get_shader_sort_id(GetShaderIdentifier()), m_alphaMode, ComputeTextureSetHash());
+	m_renderFeatureFlags = ComputeRenderFeatureFlags();
+	m_manager.UpdateRenderSortData(*this);
+}
+
 void Material::SetShaderInfo(const util::WeakHandle<util::ShaderInfo> &shaderInfo)
 {
 	m_shaderInfo = shaderInfo;
@@ -156,6 +360,8 @@ void Material::SetShaderInfo(const util::WeakHandle<util::ShaderInfo> &shaderInf
 
 Material::~Material()
 {
+	if(m_index != std::numeric_limits<MaterialIndex>::max())
+		m_manager.ReleaseMaterialIndex(*this);
 	for(auto &hCb : m_callOnLoaded) {
 		if(hCb.IsValid() == true)
 			hCb.Remove();
@@ -188,57 +394,57 @@ bool Material::Save(udm::AssetData outData, std::string &outErr)
 		for(auto &pair : *block.GetData()) {
 			auto &key = pair.first;
 			auto &val = pair.second;
-			if(val->IsBlock()) {
-				auto &block = static_cast<ds::Block &>(*pair.second);
-				dataBlockToUdm(prop[key], block);
-				continue;
-			}
-			if(val->IsContainer()) {
-				auto &container = static_cast<ds::Container &>(*pair.second);
-				auto &children = container.GetBlocks();
-				auto udmChildren = prop.AddArray(key, children.size());
-				uint32_t idx = 0;
-				for(auto &child : children) {
-					if(child->IsContainer() || child->IsBlock())
-						continue;
-					auto *dsValue = dynamic_cast<ds::Value *>(pair.second.get());
-					if(dsValue == nullptr)
-						continue;
-					udmChildren[idx++] = dsValue->GetString();
+			switch(msys::get_data_value_type(*val)) {
+			case msys::DataValueType::Block:
+				dataBlockToUdm(prop[key], static_cast<ds::Block &>(*val));
+				break;
+			case msys::DataValueType::Container:
+				{
+					auto &container = static_cast<ds::Container &>(*val);
+					auto &children = container.GetBlocks();
+					auto udmChildren = prop.AddArray(key, children.size());
+					uint32_t idx = 0;
+					for(auto &child : children) {
+						if(child->IsContainer() || child->IsBlock())
+							continue;
+						auto *dsValue = dynamic_cast<ds::Value *>(child.get());
+						if(dsValue == nullptr)
+							continue;
+						udmChildren[idx++] = dsValue->GetString();
+					}
+					udmChildren.Resize(idx);
+					break;
 				}
-				udmChildren.Resize(idx);
-				continue;
-			}
-			auto *dsValue = dynamic_cast<ds::Value *>(val.get());
-			assert(dsValue);
-			if(dsValue) {
-				auto *dsStr = dynamic_cast<ds::String *>(dsValue);
-				if(dsStr)
-					prop[key] = dsStr->GetString();
-				auto *dsInt = dynamic_cast<ds::Int *>(dsValue);
-				if(dsInt)
-					prop[key] = dsInt->GetInt();
-				auto *dsFloat = dynamic_cast<ds::Float *>(dsValue);
-				if(dsFloat)
-					prop[key] = dsFloat->GetFloat();
-				auto *dsBool = dynamic_cast<ds::Bool *>(dsValue);
-				if(dsBool)
-					prop[key] = dsBool->GetBool();
-				auto *dsVec = dynamic_cast<ds::Vector *>(dsValue);
-				if(dsVec)
-					prop[key] = dsVec->GetVector();
-				auto *dsVec4 = dynamic_cast<ds::Vector4 *>(dsValue);
-				if(dsVec4)
-					prop[key] = dsVec4->GetVector4();
-				auto *dsVec2 = dynamic_cast<ds::Vector2 *>(dsValue);
-				if(dsVec2)
-					prop[key] = dsVec2->GetVector2();
-				auto *dsTex = dynamic_cast<ds::Texture *>(dsValue);
-				if(dsTex)
-					udm["textures"][key] = dsTex->GetString();
-				auto *dsCol = dynamic_cast<ds::Color *>(dsValue);
-				if(dsCol)
-					prop[key] = dsCol->GetColor().ToVector4();
+			case msys::DataValueType::String:
+				prop[key] = static_cast<ds::String &>(*val).GetString();
+				break;
+			case msys::DataValueType::Int:
+				prop[key] = static_cast<ds::Int &>(*val).GetInt();
+				break;
+			case msys::DataValueType::Float:
+				prop[key] = static_cast<ds::Float &>(*val).GetFloat();
+				break;
+			case msys::DataValueType::Bool:
+				prop[key] = static_cast<ds::Bool &>(*val).GetBool();
+				break;
+			case msys::DataValueType::Vector:
+				prop[key] = static_cast<ds::Vector &>(*val).GetVector();
+				break;
+			case msys::DataValueType::Vector4:
+				prop[key] = static_cast<ds::Vector4 &>(*val).GetVector4();
+				break;
+			case msys::DataValueType::Vector2:
+				prop[key] = static_cast<ds::Vector2 &>(*val).GetVector2();
+				break;
+			case msys::DataValueType::Texture:
+				udm["textures"][key] = static_cast<ds::Texture &>(*val).GetString();
+				break;
+			case msys::DataValueType::Color:
+				prop[key] = static_cast<ds::Color &>(*val).GetColor().ToVector4();
+				break;
+			default:
+				assert(false);
+				break;
 			}
 		}
 	};
@@ -252,10 +458,12 @@ extern const std::array<std::string, 5> g_knownMaterialFormats;
 bool Material::Save(const std::string &relFileName, std::string &outErr, bool absolutePath)
 {
 	auto udmData = udm::Data::Create();
-	std::string err;
-	auto result = Save(udmData->GetAssetData(), err);
-	if(result == false)
+	if(!Save(udmData->GetAssetData(), outErr))
 		return false;
+	return WriteUdmData(*udmData, relFileName, outErr, absolutePath);
+}
+bool Material::WriteUdmData(udm::Data &udmData, const std::string &relFileName, std::string &outErr, bool absolutePath)
+{
 	auto fileName = relFileName;
 	if(absolutePath == false) {
 		auto assetFilePath = GetManager().FindAssetFilePath(fileName);
@@ -286,37 +494,44 @@ bool Material::Save(const std::string &relFileName, std::string &outErr, bool ab
 		outErr = "Unable to open file '" + fileName + "'!";
 		return false;
 	}
+	auto result = false;
 	if(binary)
-		result = udmData->Save(f);
+		result = udmData.Save(f);
 	else
-		result = udmData->SaveAscii(f, udm::AsciiSaveFlags::None);
+		result = udmData.SaveAscii(f, udm::AsciiSaveFlags::None);
 	if(result == false) {
 		outErr = "Unable to save UDM data!";
 		return false;
 	}
+	f = nullptr;
+	if(auto relPath = msys::to_material_relative_path(fileName))
+		msys::notify_material_file_created(*relPath);
 	return true;
 }
-bool Material::Save(std::string &outErr)
+void Material::GetDefaultSaveFilePath(std::string &outFileName, bool &outAbsolutePath)
 {
 	auto mdlName = GetName();
-	std::string absFileName;
-	auto result = FileManager::FindAbsolutePath("materials/" + mdlName, absFileName);
-	auto absolutePath = false;
-	if(result == false)
-		absFileName = mdlName;
-	else {
-		auto path = util::Path::CreateFile(absFileName);
-		path.MakeRelative(util::get_program_path());
-		absFileName = path.GetString();
-		absolutePath = true;
+	outAbsolutePath = false;
+	if(FileManager::FindAbsolutePath("materials/" + mdlName, outFileName) == false) {
+		outFileName = mdlName;
+		return;
 	}
-	return Save(absFileName, outErr, absolutePath);
+	auto path = util::Path::CreateFile(outFileName);
+	path.MakeRelative(util::get_program_path());
+	outFileName = path.GetString();
+	outAbsolutePath = true;
+}
+bool Material::Save(std::string &outErr)
+{
+	std::string fileName;
+	auto absolutePath = false;
+	GetDefaultSaveFilePath(fileName, absolutePath);
+	return Save(fileName, outErr, absolutePath);
 }
 bool Material::SaveLegacy(std::shared_ptr<VFilePtrInternalReal> f) const
 {
-	auto &rootData = GetDataBlock();
 	std::stringstream ss;
-	ss << rootData->ToString(GetShaderIdentifier());
+	ss << m_data->ToString(GetShaderIdentifier());
 
 	f->WriteString(ss.str());
 	return true;
@@ -424,38 +639,42 @@ TextureInfo *Material::GetRMAMap()
 	return m_texRma;
 }
 
-AlphaMode Material::GetAlphaMode() const { return m_alphaMode; }
+AlphaMode Material::GetAlphaMode() const
+{
+	UpdateParameters();
+	return m_alphaMode;
+}
 float Material::GetAlphaCutoff() const
 {
-	auto &data = GetDataBlock();
-	return data->GetFloat("alpha_cutoff", 0.5f);
+	UpdateParameters();
+	if(!m_parameters.IsCompiled())
+		return 0.5f;
+	return m_parameters.Get<float>(msys::ParameterSchema::BuiltinParameter::AlphaCutoff);
 }
 
 void Material::SetColorFactor(const Vector4 &colorFactor)
 {
-	auto &data = GetDataBlock();
+	auto &data = GetMutableDataBlock();
 	data->AddValue("vector4", "color_factor", std::to_string(colorFactor.r) + ' ' + std::to_string(colorFactor.g) + ' ' + std::to_string(colorFactor.b) + ' ' + std::to_string(colorFactor.a));
 }
 Vector4 Material::GetColorFactor() const
 {
-	auto &data = GetDataBlock();
-	auto colFactor = data->GetValue("color_factor");
-	if(colFactor == nullptr || typeid(*colFactor) != typeid(ds::Vector4))
+	UpdateParameters();
+	if(!m_parameters.IsCompiled())
 		return {1.f, 1.f, 1.f, 1.f};
-	return static_cast<ds::Vector4 &>(*colFactor).GetValue();
+	return m_parameters.Get<Vector4>(msys::ParameterSchema::BuiltinParameter::ColorFactor);
 }
 void Material::SetBloomColorFactor(const Vector4 &bloomColorFactor)
 {
-	auto &data = GetDataBlock();
+	auto &data = GetMutableDataBlock();
 	data->AddValue("vector4", "bloom_color_factor", std::to_string(bloomColorFactor.r) + ' ' + std::to_string(bloomColorFactor.g) + ' ' + std::to_string(bloomColorFactor.b) + ' ' + std::to_string(bloomColorFactor.a));
 }
 std::optional<Vector4> Material::GetBloomColorFactor() const
 {
-	auto &data = GetDataBlock();
-	auto colFactor = data->GetValue("bloom_color_factor");
-	if(colFactor == nullptr || typeid(*colFactor) != typeid(ds::Vector4))
+	UpdateParameters();
+	if(!m_parameters.IsDefined(msys::ParameterSchema::BuiltinParameter::BloomColorFactor))
 		return {};
-	return static_cast<ds::Vector4 &>(*colFactor).GetValue();
+	return m_parameters.Get<Vector4>(msys::ParameterSchema::BuiltinParameter::BloomColorFactor);
 }
 
 void Material::SetName(const std::string &name) { m_name = name; }
@@ -473,13 +692,35 @@ const std::string &Material::GetShaderIdentifier() const
 	return m_shader ? *m_shader : empty;
 }
 
-const TextureInfo *Material::GetTextureInfo(const std::string &key) const { return const_cast<Material *>(this)->GetTextureInfo(key); }
+// The well-known identifiers (e.g. DIFFUSE_MAP_IDENTIFIER) are resolved by their address, so the most common lookups
+// don't have to hash the key
+static msys::KeyAtom find_builtin_key_atom(const std::string &key)
+{
+	static const std::array<std::pair<const std::string *, msys::KeyAtom>, 14> builtinKeys {{
+	  {&Material::DIFFUSE_MAP_IDENTIFIER, msys::key_atoms::DiffuseMap},
+	  {&Material::ALBEDO_MAP_IDENTIFIER, msys::key_atoms::AlbedoMap},
+	  {&Material::ALBEDO_MAP2_IDENTIFIER, msys::key_atoms::AlbedoMap2},
+	  {&Material::ALBEDO_MAP3_IDENTIFIER, msys::key_atoms::AlbedoMap3},
+	  {&Material::NORMAL_MAP_IDENTIFIER, msys::key_atoms::NormalMap},
+	  {&Material::GLOW_MAP_IDENTIFIER, msys::key_atoms::EmissionMap},
+	  {&Material::EMISSION_MAP_IDENTIFIER, msys::key_atoms::EmissionMap},
+	  {&Material::PARALLAX_MAP_IDENTIFIER, msys::key_atoms::ParallaxMap},
+	  {&Material::ALPHA_MAP_IDENTIFIER, msys::key_atoms::AlphaMap},
+	  {&Material::RMA_MAP_IDENTIFIER, msys::key_atoms::RmaMap},
+	  {&Material::DUDV_MAP_IDENTIFIER, msys::key_atoms::DudvMap},
+	  {&Material::WRINKLE_STRETCH_MAP_IDENTIFIER, msys::key_atoms::WrinkleStretchMap},
+	  {&Material::WRINKLE_COMPRESS_MAP_IDENTIFIER, msys::key_atoms::WrinkleCompressMap},
+	  {&Material::EXPONENT_MAP_IDENTIFIER, msys::key_atoms::ExponentMap},
+	}};
+	for(auto &pair : builtinKeys) {
+		if(pair.first == &key)
+			return pair.second;
+	}
+	return msys::INVALID_KEY_ATOM;
+}
 
-TextureInfo *Material::GetTextureInfo(const std::string &key)
+static TextureInfo *get_texture_info(const std::shared_ptr<ds::Base> &base)
 {
-	if(!m_data)
-		return nullptr;
-	auto &base = m_data->GetValue(key);
 	if(base == nullptr || base->IsBlock())
 		return nullptr;
 	auto &val = static_cast<ds::Value &>(*base);
@@ -490,10 +731,70 @@ TextureInfo *Material::GetTextureInfo(const std::string &key)
 	return &const_cast<TextureInfo &>(datTex.GetValue());
 }
 
-const std::shared_ptr<ds::Block> &Material::GetDataBlock() const
+const TextureInfo *Material::GetTextureInfo(const std::string &key) const { return const_cast<Material *>(this)->GetTextureInfo(key); }
+
+TextureInfo *Material::GetTextureInfo(const std::string &key)
+{
+	if(!m_data)
+		return nullptr;
+	auto atom = find_builtin_key_atom(key);
+	if(atom != msys::INVALID_KEY_ATOM)
+		return Material::GetTextureInfo(atom);
+	// The compiled texture slots point to the same values, so a single lookup in the data block is enough
+	return get_texture_info(m_data->GetValue(key));
+}
+
+const TextureInfo *Material::GetTextureInfo(msys::KeyAtom key) const { return const_cast<Material *>(this)->GetTextureInfo(key); }
+
+TextureInfo *Material::GetTextureInfo(msys::KeyAtom key)
+{
+	if(!m_data)
+		return nullptr;
+	UpdateParameters();
+	auto idx = m_parameters.GetSchema()->FindParameter(key);
+	if(idx != msys::INVALID_PARAMETER_INDEX && m_parameters.GetSchema()->GetParameter(idx)->type == msys::ParameterType::Texture)
+		return m_parameters.GetTexture(idx);
+	return get_texture_info(GetValue(key));
+}
+
+const std::shared_ptr<ds::Base> &Material::GetValue(msys::KeyAtom key) const
 {
-	static std::shared_ptr<ds::Block> nptr = nullptr;
-	return (m_data != nullptr) ? m_data : nptr;
+	UpdateParameters();
+	// The key has been interned after the parameters were compiled, so it's not part of the compiled values
+	if(m_data && key >= m_parameters.GetAtomCount())
+		return m_data->GetValue(msys::get_key_name(key));
+	return m_parameters.GetValue(key);
+}
+
+std::shared_ptr<const ds::Block> Material::GetDataBlock() const { return m_data; }
+const std::shared_ptr<ds::Block> &Material::GetMutableDataBlock()
+{
+	DetachDataBlock();
+	// The caller may change any value, so everything that has been derived from the block has to be updated
+	umath::set_flag(m_stateFlags, StateFlags::ParametersDirty);
+	umath::set_flag(m_stateFlags, StateFlags::TexturesUpdated, false);
+	return m_data;
+}
+// If the other material has released the block in the meantime, there's no need to copy it
+bool Material::IsDataBlockShared() const { return m_data && m_dataBlockShared && m_data.use_count() > 1; }
+void Material::ShareDataBlock(const Material &other)
+{
+	m_data = other.m_data;
+	if(!m_data)
+		return;
+	m_dataBlockShared = true;
+	other.m_dataBlockShared = true;
+}
+void Material::DetachDataBlock()
+{
+	if(!IsDataBlockShared()) {
+		m_dataBlockShared = false;
+		return;
+	}
+	// Values are shared with the other materials until they're replaced
+	m_data = msys::shallow_copy_data_block(*m_data, *m_manager.CreateDataSettings());
+	m_dataBlockShared = false;
+	CompileParameters();
 }
 
 msys::MaterialHandle Material::GetHandle() { return shared_from_this(); }
@@ -504,13 +805,18 @@ std::shared_ptr<Material> Material::Copy() const
 	if(!IsValid())
 		r = GetManager().CreateMaterial("pbr", nullptr);
 	else if(m_shaderInfo.expired() == false)
-		r = GetManager().CreateMaterial(m_shaderInfo->GetIdentifier(), std::shared_ptr<ds::Block>(m_data->Copy()));
+		r = GetManager().CreateMaterial(m_shaderInfo->GetIdentifier(), m_data);
 	else
-		r = GetManager().CreateMaterial(*m_shader, std::shared_ptr<ds::Block>(m_data->Copy()));
+		r = GetManager().CreateMaterial(*m_shader, m_data);
+	if(m_data) {
+		m_dataBlockShared = true;
+		r->m_dataBlockShared = true;
+	}
 	if(IsLoaded())
 		r->SetLoaded(true);
 	r->m_stateFlags = m_stateFlags;
-	umath::set_flag(r->m_stateFlags, StateFlags::TexturesUpdated, false);
+	// The parameters of the copy have already been compiled from the current block
+	umath::set_flag(r->m_stateFlags, StateFlags::TexturesUpdated | StateFlags::ParametersDirty, false);
 	return r;
 }
 
@@ -0,0 +1,84 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "material_instance.hpp"
+#include "material_manager2.hpp"
+#include "textureinfo.h"
+#include <datasystem.h>
+
+msys::MaterialInstance::MaterialInstance(MaterialManager &manager, const MaterialHandle &parent) : m_manager {manager}, m_parent {parent} {}
+
+MaterialIndex msys::MaterialInstance::GetIndex() const { return m_material ? m_material->GetIndex() : std::numeric_limits<MaterialIndex>::max(); }
+
+void msys::MaterialInstance::SetOverride(const std::string &key, const std::shared_ptr<ds::Base> &value)
+{
+	if(value == nullptr) {
+		ClearOverride(key);
+		return;
+	}
+	m_overrides[key] = value;
+	if(!m_material) {
+		Update();
+		return;
+	}
+	// Only the new value has to be applied, everything else is already up to date
+	m_material->ApplyValues({{key, value}});
+}
+void msys::MaterialInstance::SetOverride(const std::string &key, const std::string &type, const std::string &value)
+{
+	// Let the data system take care of parsing the value
+	auto dataSettings = m_manager.CreateDataSettings();
+	auto tmp = std::make_shared<ds::Block>(*dataSettings);
+	tmp->AddValue(type, key, value);
+	auto &val = tmp->GetValue(key);
+	if(val == nullptr)
+		return;
+	SetOverride(key, val);
+}
+void msys::MaterialInstance::SetColorFactor(const Vector4 &colorFactor) { SetOverride("color_factor", "vector4", std::to_string(colorFactor.r) + ' ' + std::to_string(colorFactor.g) + ' ' + std::to_string(colorFactor.b) + ' ' + std::to_string(colorFactor.a)); }
+void msys::MaterialInstance::SetTexture(const std::string &key, const std::string &texture)
+{
+	auto dataSettings = m_manager.CreateDataSettings();
+	SetOverride(key, std::make_shared<ds::Texture>(*dataSettings, texture)); // Data settings will be overwritten once the override is applied
+}
+void msys::MaterialInstance::ClearOverride(const std::string &key)
+{
+	if(m_overrides.erase(key) == 0)
+		return;
+	Update();
+}
+void msys::MaterialInstance::ClearOverrides()
+{
+	if(m_overrides.empty())
+		return;
+	m_overrides.clear();
+	Update();
+}
+bool msys::MaterialInstance::HasOverride(const std::string &key) const { return m_overrides.find(key) != m_overrides.end(); }
+
+const std::shared_ptr<ds::Base> &msys::MaterialInstance::GetValue(const std::string &key) const
+{
+	auto it = m_overrides.find(key);
+	if(it != m_overrides.end())
+		return it->second;
+	auto data = m_parent->GetDataBlock();
+	if(!data) {
+		static std::shared_ptr<ds::Base> nptr = nullptr;
+		return nptr;
+	}
+	return data->GetValue(key);
+}
+
+void msys::MaterialInstance::Update()
+{
+	if(!m_material) {
+		// The copy has the shader of the parent and shares its data block, which is only copied once an override is applied
+		m_material = m_parent->Copy();
+	}
+	else if(m_material->GetShaderIdentifier() == m_parent->GetShaderIdentifier())
+		m_material->AssignChanges(*m_parent); // Textures that are still in use are kept
+	else
+		m_material->Assign(*m_parent);
+	m_material->ApplyValues(m_overrides);
+}
@@ -0,0 +1,65 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "material_load_batch.hpp"
+#include "material_manager2.hpp"
+#include <chrono>
+
+msys::MaterialLoadBatch::MaterialLoadBatch(MaterialManager &manager, OnMaterialLoaded onLoaded) : m_manager {manager}, m_onLoaded {std::move(onLoaded)} {}
+msys::MaterialLoadBatch::~MaterialLoadBatch()
+{
+	// The jobs reference the manager, so they have to be completed before the batch goes out of scope.
+	// The results are discarded.
+	for(auto i = m_numFinalized; i < m_items.size(); ++i) {
+		auto &result = m_items[i].result;
+		if(result.valid())
+			result.wait();
+	}
+}
+bool msys::MaterialLoadBatch::FinalizeNext(bool wait)
+{
+	if(IsComplete())
+		return false;
+	auto idx = m_numFinalized;
+	auto &item = m_items[idx];
+	auto mat = item.cached;
+	if(!mat) {
+		if(!wait && item.result.wait_for(std::chrono::seconds {0}) != std::future_status::ready)
+			return false;
+		auto result = item.result.get();
+		if(result.fallback)
+			mat = item.reload ? m_manager.ReloadAsset(item.path) : m_manager.LoadAsset(item.path);
+		else if(result.data) {
+			auto *asset = m_manager.FindCachedAsset(item.path);
+			if(asset && !item.reload)
+				mat = m_manager.GetAssetObject(*asset); // Has been loaded in the meantime (e.g. the path was specified more than once)
+			else {
+				mat = m_manager.CreateMaterialObject(result.shader, result.data);
+				if(mat) {
+					mat->SetLoaded(true);
+					mat->SetName(m_manager.ToCacheIdentifier(item.path));
+					mat = asset ? m_manager.ReplaceCachedMaterial(*asset, item.path, mat) : m_manager.AddLoadedMaterial(item.path, mat, result.contentHash);
+				}
+			}
+		}
+	}
+	if(!mat)
+		++m_numFailed;
+	m_materials[idx] = mat;
+	++m_numFinalized;
+	if(m_onLoaded)
+		m_onLoaded(item.path, mat);
+	return true;
+}
+bool msys::MaterialLoadBatch::Poll()
+{
+	while(FinalizeNext(false))
+		;
+	return IsComplete();
+}
+void msys::MaterialLoadBatch::Wait()
+{
+	while(FinalizeNext(true))
+		;
+}
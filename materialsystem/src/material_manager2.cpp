@@ -9,22 +9,45 @@
 #include "material_manager2.hpp"
 #include "source_vmt_format_handler.hpp"
 #include "source2_vmat_format_handler.hpp"
+#include "image_metadata_cache.hpp"
+#include "import_cache.hpp"
+#include "material_instance.hpp"
+#include "data_value_type.hpp"
+#include "directory_index.hpp"
 #include <fsys/filesystem.h>
 #include <fsys/ifile.hpp>
+#include <sharedutils/util_string.h>
+#include <sharedutils/util_file.h>
+#include <sharedutils/util.h>
+#include <thread>
+#include <future>
+#include <algorithm>
+#include <array>
 
 #include <udm.hpp>
+#include <datasystem_vector.h>
 msys::MaterialFormatHandler::MaterialFormatHandler(util::IAssetManager &assetManager) : util::IAssetFormatHandler {assetManager} {}
 
 bool msys::udm_to_data_block(udm::LinkedPropertyWrapper &udmDataRoot, ds::Block &root)
 {
+	// The values are constructed directly from the typed UDM data, without a round-trip through strings.
+	// The data settings of the values will be overwritten when they're added to the block.
+	auto dataSettings = ds::create_data_settings({});
 	std::function<void(const std::string &key, udm::LinkedPropertyWrapper &prop, ds::Block &block, bool texture)> udmToDataSys = nullptr;
-	udmToDataSys = [&udmToDataSys](const std::string &key, udm::LinkedPropertyWrapper &prop, ds::Block &block, bool texture) {
+	udmToDataSys = [&udmToDataSys, &dataSettings](const std::string &key, udm::LinkedPropertyWrapper &prop, ds::Block &block, bool texture) {
 		prop.InitializeProperty();
 		if(prop.prop) {
+			auto &settings = *dataSettings;
 			switch(prop.prop->type) {
 			case udm::Type::String:
-				block.AddValue(texture ? "texture" : "string", key, prop.prop->ToValue<std::string>(""));
-				break;
+				{
+					auto str = prop.prop->ToValue<std::string>("");
+					if(texture)
+						block.AddData(key, std::make_shared<ds::Texture>(settings, str));
+					else
+						block.AddData(key, std::make_shared<ds::String>(settings, str));
+					break;
+				}
 			case udm::Type::Int8:
 			case udm::Type::UInt8:
 			case udm::Type::Int16:
@@ -33,33 +56,24 @@ bool msys::udm_to_data_block(udm::LinkedPropertyWrapper &udmDataRoot, ds::Block
 			case udm::Type::UInt32:
 			case udm::Type::Int64:
 			case udm::Type::UInt64:
-				block.AddValue("int", key, std::to_string(prop.prop->ToValue<int32_t>(0)));
+				block.AddData(key, std::make_shared<ds::Int>(settings, prop.prop->ToValue<int32_t>(0)));
 				break;
 			case udm::Type::Float:
 			case udm::Type::Double:
-				block.AddValue("float", key, std::to_string(prop.prop->ToValue<float>(0.f)));
+				block.AddData(key, std::make_shared<ds::Float>(settings, prop.prop->ToValue<float>(0.f)));
 				break;
 			case udm::Type::Boolean:
-				block.AddValue("bool", key, std::to_string(prop.prop->ToValue<bool>(false)));
+				block.AddData(key, std::make_shared<ds::Bool>(settings, prop.prop->ToValue<bool>(false)));
 				break;
 			case udm::Type::Vector2:
-				{
-					auto v = prop.prop->ToValue<Vector2>(Vector2 {});
-					block.AddValue("vector2", key, std::to_string(v.x) + ' ' + std::to_string(v.y));
-					break;
-				}
+				block.AddData(key, std::make_shared<ds::Vector2>(settings, prop.prop->ToValue<Vector2>(Vector2 {})));
+				break;
 			case udm::Type::Vector3:
-				{
-					auto v = prop.prop->ToValue<Vector3>(Vector3 {});
-					block.AddValue("vector", key, std::to_string(v.x) + ' ' + std::to_string(v.y) + ' ' + std::to_string(v.z));
-					break;
-				}
+				block.AddData(key, std::make_shared<ds::Vector>(settings, prop.prop->ToValue<Vector3>(Vector3 {})));
+				break;
 			case udm::Type::Vector4:
-				{
-					auto v = prop.prop->ToValue<Vector4>(Vector4 {});
-					block.AddValue("vector4", key, std::to_string(v.x) + ' ' + std::to_string(v.y) + ' ' + std::to_string(v.z) + ' ' + std::to_string(v.w));
-					break;
-				}
+				block.AddData(key, std::make_shared<ds::Vector4>(settings, prop.prop->ToValue<Vector4>(Vector4 {})));
+				break;
 			case udm::Type::Element:
 				{
 					auto childBlock = block.AddBlock(key);
@@ -81,11 +95,99 @@ bool msys::udm_to_data_block(udm::LinkedPropertyWrapper &udmDataRoot, ds::Block
 		udmToDataSys(std::string {udmProp.key}, udmProp.property, root, false);
 	return true;
 }
-bool msys::PmatFormatHandler::LoadData(MaterialProcessor &processor, MaterialLoadInfo &info)
+std::shared_ptr<ds::Block> msys::shallow_copy_data_block(const ds::Block &block, ds::Settings &dataSettings)
+{
+	auto data = std::make_shared<ds::Block>(dataSettings);
+	auto *values = block.GetData();
+	if(!values)
+		return data;
+	for(auto &pair : *values) {
+		auto &val = pair.second;
+		// Nested blocks and containers may be modified in-place, so they can't be shared. The same applies to
+		// textures, which receive the loaded texture object.
+		if(val->IsBlock() || val->IsContainer() || get_data_value_type(*val) == DataValueType::Texture)
+			data->AddData(pair.first, std::shared_ptr<ds::Base> {val->Copy()});
+		else
+			data->AddData(pair.first, val);
+	}
+	return data;
+}
+static uint64_t hash_data_value(ds::Base &val)
+{
+	auto type = msys::get_data_value_type(val);
+	uint64_t hash = static_cast<uint64_t>(type);
+	switch(type) {
+	case msys::DataValueType::Block:
+		return msys::hash_combine(hash, msys::hash_data_block(static_cast<ds::Block &>(val)));
+	case msys::DataValueType::Container:
+		for(auto &child : static_cast<ds::Container &>(val).GetBlocks())
+			hash = msys::hash_combine(hash, hash_data_value(*child));
+		return hash;
+	case msys::DataValueType::Unknown:
+		return hash;
+	default:
+		return msys::hash_combine(hash, std::hash<std::string> {}(static_cast<ds::Value &>(val).GetString()));
+	}
+}
+uint64_t msys::hash_data_block(const ds::Block &block)
+{
+	auto *values = block.GetData();
+	if(!values)
+		return 0;
+	// The iteration order of the block is undefined, so the entries are combined with a commutative operation
+	uint64_t hash = values->size();
+	for(auto &pair : *values)
+		hash += hash_combine(std::hash<std::string> {}(pair.first), hash_data_value(*pair.second));
+	return hash;
+}
+static bool compare_data_values(ds::Base &a, ds::Base &b)
+{
+	auto type = msys::get_data_value_type(a);
+	if(type != msys::get_data_value_type(b))
+		return false;
+	switch(type) {
+	case msys::DataValueType::Block:
+		return msys::compare_data_blocks(static_cast<ds::Block &>(a), static_cast<ds::Block &>(b));
+	case msys::DataValueType::Container:
+		{
+			auto &childrenA = static_cast<ds::Container &>(a).GetBlocks();
+			auto &childrenB = static_cast<ds::Container &>(b).GetBlocks();
+			if(childrenA.size() != childrenB.size())
+				return false;
+			for(size_t i = 0; i < childrenA.size(); ++i) {
+				if(!compare_data_values(*childrenA[i], *childrenB[i]))
+					return false;
+			}
+			return true;
+		}
+	case msys::DataValueType::Unknown:
+		return &a == &b;
+	default:
+		return static_cast<ds::Value &>(a).GetString() == static_cast<ds::Value &>(b).GetString();
+	}
+}
+bool msys::compare_data_blocks(const ds::Block &a, const ds::Block &b)
+{
+	auto *valuesA = a.GetData();
+	auto *valuesB = b.GetData();
+	auto numValuesA = valuesA ? valuesA->size() : 0;
+	auto numValuesB = valuesB ? valuesB->size() : 0;
+	if(numValuesA != numValuesB)
+		return false;
+	if(numValuesA == 0)
+		return true;
+	for(auto &pair : *valuesA) {
+		auto it = valuesB->find(pair.first);
+		if(it == valuesB->end() || !compare_data_values(*pair.second, *it->second))
+			return false;
+	}
+	return true;
+}
+bool msys::load_pmat_data(MaterialManager &manager, std::unique_ptr<ufile::IFile> &&f, std::string &outShader, std::shared_ptr<ds::Block> &outData)
 {
 	std::shared_ptr<udm::Data> udmData = nullptr;
 	try {
-		udmData = udm::Data::Load(std::move(m_file));
+		udmData = udm::Data::Load(std::move(f));
 	}
 	catch(const udm::Exception &e) {
 		return false;
@@ -94,26 +196,21 @@ bool msys::PmatFormatHandler::LoadData(MaterialProcessor &processor, MaterialLoa
 		return false;
 	auto udmDataRoot = udmData->GetAssetData().GetData();
 
-	auto dataSettings = static_cast<MaterialManager &>(GetAssetManager()).CreateDataSettings();
+	auto dataSettings = manager.CreateDataSettings();
 	auto root = std::make_shared<ds::Block>(*dataSettings);
 	auto it = udmDataRoot.begin_el();
 	if(it == udmDataRoot.end_el())
 		return false;
 	auto &firstEl = *it;
-	shader = firstEl.key;
 	if(!udm_to_data_block(firstEl.property, *root))
 		return false;
-	data = root;
+	outShader = firstEl.key;
+	outData = root;
 	return true;
 }
-msys::PmatFormatHandler::PmatFormatHandler(util::IAssetManager &assetManager) : MaterialFormatHandler {assetManager} {}
-
-///////////
-
-msys::WmiFormatHandler::WmiFormatHandler(util::IAssetManager &assetManager) : MaterialFormatHandler {assetManager} {}
-bool msys::WmiFormatHandler::LoadData(MaterialProcessor &processor, MaterialLoadInfo &info)
+bool msys::load_wmi_data(ufile::IFile &f, std::string &outShader, std::shared_ptr<ds::Block> &outData)
 {
-	auto root = ds::System::ReadData(*m_file, {});
+	auto root = ds::System::ReadData(f, {});
 	if(root == nullptr)
 		return false;
 	auto *data = root->GetData();
@@ -132,11 +229,19 @@ bool msys::WmiFormatHandler::LoadData(MaterialProcessor &processor, MaterialLoad
 		return false;
 	root->DetachData(*matData);
 
-	this->data = matData;
-	this->shader = shader;
+	outData = matData;
+	outShader = shader;
 	return true;
 }
 
+bool msys::PmatFormatHandler::LoadData(MaterialProcessor &processor, MaterialLoadInfo &info) { return load_pmat_data(static_cast<MaterialManager &>(GetAssetManager()), std::move(m_file), shader, data); }
+msys::PmatFormatHandler::PmatFormatHandler(util::IAssetManager &assetManager) : MaterialFormatHandler {assetManager} {}
+
+///////////
+
+msys::WmiFormatHandler::WmiFormatHandler(util::IAssetManager &assetManager) : MaterialFormatHandler {assetManager} {}
+bool msys::WmiFormatHandler::LoadData(MaterialProcessor &processor, MaterialLoadInfo &info) { return load_wmi_data(*m_file, shader, data); }
+
 ///////////
 
 std::unique_ptr<util::IAssetProcessor> msys::MaterialLoader::CreateAssetProcessor(const std::string &identifier, const std::string &ext, std::unique_ptr<util::IAssetFormatHandler> &&formatHandler)
@@ -154,17 +259,33 @@ msys::MaterialLoadInfo::MaterialLoadInfo(util::AssetLoadFlags flags) : util::Ass
 msys::MaterialProcessor::MaterialProcessor(util::AssetFormatLoader &loader, std::unique_ptr<util::IAssetFormatHandler> &&handler) : util::FileAssetProcessor {loader, std::move(handler)} {}
 bool msys::MaterialProcessor::Load()
 {
+	if(is_load_cancelled(cancellationToken))
+		return false;
 	auto &matHandler = static_cast<MaterialFormatHandler &>(*handler);
 	auto r = matHandler.LoadData(*this, static_cast<MaterialLoadInfo &>(*loadInfo));
 	if(!r)
 		return false;
-	auto mat = static_cast<MaterialManager &>(matHandler.GetAssetManager()).CreateMaterialObject(matHandler.shader, matHandler.data);
+	if(is_load_cancelled(cancellationToken)) {
+		matHandler.data = nullptr;
+		return false;
+	}
+	auto &manager = static_cast<MaterialManager &>(matHandler.GetAssetManager());
+	auto mat = manager.CreateMaterialObject(matHandler.shader, matHandler.data);
 	mat->SetLoaded(true);
 	mat->SetName(identifier);
 	material = mat;
+	// Hashing is done here, so it runs on the loader thread
+	if(manager.IsDeduplicationEnabled() && matHandler.data)
+		contentHash = hash_combine(std::hash<std::string> {}(matHandler.shader), hash_data_block(*matHandler.data));
 	return true;
 }
-bool msys::MaterialProcessor::Finalize() { return true; }
+bool msys::MaterialProcessor::Finalize()
+{
+	if(!is_load_cancelled(cancellationToken))
+		return true;
+	material = nullptr;
+	return false;
+}
 
 std::shared_ptr<msys::MaterialManager> msys::MaterialManager::Create()
 {
@@ -187,11 +308,36 @@ msys::MaterialManager::MaterialManager()
 	SetFileHandler(std::move(fileHandler));
 	SetRootDirectory("materials");
 	m_loader = std::make_unique<MaterialLoader>(*this);
+	m_baseParameterSchema = ParameterSchema::Create();
+
+	auto &imgMetadataCache = get_image_metadata_cache();
+	if(!imgMetadataCache.IsLoaded())
+		imgMetadataCache.Load(get_image_metadata_cache_path());
+	auto &importCache = get_import_cache();
+	if(!importCache.IsLoaded())
+		importCache.Load(get_import_cache_path());
+	initialize_material_directory_index();
 
 	// TODO: New extensions might be added after the model manager has been created
 	//for(auto &ext : get_model_extensions())
 	//	RegisterFileExtension(ext);
 }
+msys::MaterialManager::~MaterialManager()
+{
+	{
+		// Materials may outlive the manager, in which case they must not release their indices anymore
+		std::scoped_lock lock {m_materialIndexMutex};
+		for(auto *mat : m_materialIndices)
+			mat->SetIndex(std::numeric_limits<MaterialIndex>::max());
+		m_materialIndices.Clear();
+	}
+	auto &imgMetadataCache = get_image_metadata_cache();
+	if(imgMetadataCache.IsDirty())
+		imgMetadataCache.Save(get_image_metadata_cache_path());
+	auto &importCache = get_import_cache();
+	if(importCache.IsDirty())
+		importCache.Save(get_import_cache_path());
+}
 void msys::MaterialManager::Initialize()
 {
 	RegisterFormatHandler<PmatFormatHandler>("pmat_b");
@@ -214,8 +360,28 @@ std::shared_ptr<Material> msys::MaterialManager::ReloadAsset(const std::string &
 	auto matNew = LoadAsset(path, util::AssetLoadFlags::IgnoreCache | util::AssetLoadFlags::DontCache, optOutResult);
 	if(!matNew)
 		return nullptr;
-	auto matOld = GetAssetObject(*asset);
-	matOld->Assign(*matNew);
+	return ReplaceCachedMaterial(*asset, path, matNew);
+}
+std::shared_ptr<Material> msys::MaterialManager::ReplaceCachedMaterial(util::Asset &asset, const std::string &path, const std::shared_ptr<Material> &matNew)
+{
+	auto matOld = GetAssetObject(asset);
+	if(GetDeduplicatedNameCount(*matOld) > 1) {
+		// Other names still refer to the deduplicated material, so this name gets a material (and material index) of its own
+		auto identifier = ToCacheIdentifier(path);
+		auto remainingNames = ReleaseDeduplicatedName(*matOld, identifier);
+		if(ToCacheIdentifier(matOld->GetName()) == identifier && !remainingNames.empty()) {
+			// The material was loaded under this name first, so it has to move to one of the remaining names.
+			// Otherwise it would be saved to the file of this name.
+			matOld->SetName(remainingNames.front());
+		}
+		AssignMaterialIndex(*matNew);
+		asset.assetObject = matNew;
+		OnAssetReloaded(path);
+		return matNew;
+	}
+	// Only the parts of the material that have actually changed are updated
+	matOld->AssignChanges(*matNew);
+	UpdateMaterialInstances(*matOld);
 	OnAssetReloaded(path);
 	return matOld;
 }
@@ -242,12 +408,385 @@ void msys::MaterialManager::SetErrorMaterial(Material *mat)
 	}
 }
 Material *msys::MaterialManager::GetErrorMaterial() const { return m_error.get(); }
-void msys::MaterialManager::InitializeProcessor(util::IAssetProcessor &processor) {}
+void msys::MaterialManager::RegisterParameterSchema(const std::string &shader, const std::shared_ptr<ParameterSchema> &schema) { m_parameterSchemas[shader] = schema; }
+const std::shared_ptr<const msys::ParameterSchema> &msys::MaterialManager::FindParameterSchema(const std::string &shader) const
+{
+	auto it = m_parameterSchemas.find(shader);
+	return (it != m_parameterSchemas.end()) ? it->second : m_baseParameterSchema;
+}
+void msys::MaterialManager::SetWorkerThreadCount(uint32_t count)
+{
+	if(count == m_workerThreadCount)
+		return;
+	m_workerThreadCount = count;
+	m_workerPool = nullptr;
+}
+std::string msys::MaterialManager::GetImportFileExtension() const { return (m_importFormat == util::AssetFormatType::Binary) ? Material::FORMAT_MATERIAL_BINARY : Material::FORMAT_MATERIAL_ASCII; }
+ctpl::thread_pool &msys::MaterialManager::GetWorkerPool()
+{
+	if(!m_workerPool) {
+		auto numThreads = m_workerThreadCount;
+		if(numThreads == 0)
+			numThreads = umath::max(std::thread::hardware_concurrency(), 1u);
+		m_workerPool = std::make_unique<ctpl::thread_pool>(numThreads);
+	}
+	return *m_workerPool;
+}
+void msys::MaterialManager::ProbeTextureSizes(const std::vector<Material *> &materials)
+{
+	// Group by name, so that every image header is only read once
+	std::unordered_map<std::string, std::vector<TextureInfo *>> textures;
+	std::function<void(ds::Block &)> collectTextures = nullptr;
+	collectTextures = [&collectTextures, &textures](ds::Block &block) {
+		auto *data = block.GetData();
+		if(!data)
+			return;
+		for(auto &pair : *data) {
+			auto &val = pair.second;
+			if(val->IsBlock()) {
+				collectTextures(static_cast<ds::Block &>(*val));
+				continue;
+			}
+			if(val->IsContainer() || typeid(*val) != typeid(ds::Texture))
+				continue;
+			auto &texInfo = static_cast<ds::Texture &>(*val).GetValue();
+			if(texInfo.GetSizeState() != TextureInfo::SizeState::Unknown)
+				continue;
+			textures[texInfo.name].push_back(&texInfo);
+		}
+	};
+	for(auto *mat : materials) {
+		if(!mat)
+			continue;
+		// The resolved sizes are stored in the texture values, which may be shared with other materials. That's fine,
+		// since the size only depends on the texture name.
+		auto &data = mat->m_data;
+		if(data)
+			collectTextures(*data);
+	}
+	if(textures.empty())
+		return;
+
+	auto &pool = GetWorkerPool();
+	std::vector<std::future<void>> results;
+	results.reserve(textures.size());
+	for(auto &pair : textures) {
+		auto &texInfos = pair.second;
+		results.push_back(pool.push([&texInfos](int) {
+			auto &texInfo = *texInfos.front();
+			auto found = texInfo.ResolveSize();
+			for(auto *other : texInfos) {
+				if(other == &texInfo)
+					continue;
+				if(found)
+					other->SetSize(texInfo.GetWidth(), texInfo.GetHeight());
+				else
+					other->SetSizeUnavailable();
+			}
+		}));
+	}
+	for(auto &r : results)
+		r.wait();
+}
+uint32_t msys::MaterialManager::SaveMaterials(const std::vector<Material *> &materials, const std::vector<std::string> &fileNames, bool absolutePath, std::vector<std::string> *outErrors)
+{
+	std::vector<std::string> errors;
+	errors.resize(materials.size());
+	if(!fileNames.empty() && fileNames.size() != materials.size()) {
+		std::fill(errors.begin(), errors.end(), "Number of file names does not match number of materials!");
+		if(outErrors)
+			*outErrors = std::move(errors);
+		return 0;
+	}
+	// Only the conversion to UDM data is done in parallel. Resolving the file paths and writing the files touches the file system
+	// and the material directory index, which is done on this thread afterwards.
+	std::vector<std::shared_ptr<udm::Data>> udmData;
+	udmData.resize(materials.size());
+	std::vector<std::future<bool>> results;
+	results.reserve(materials.size());
+	auto &pool = GetWorkerPool();
+	for(size_t i = 0; i < materials.size(); ++i) {
+		// Every job only writes to its own slots, so no synchronization is required
+		results.push_back(pool.push([&materials, &errors, &udmData, i](int) -> bool {
+			auto *mat = materials[i];
+			if(!mat) {
+				errors[i] = "Invalid material!";
+				return false;
+			}
+			auto data = udm::Data::Create();
+			if(!mat->Save(data->GetAssetData(), errors[i]))
+				return false;
+			udmData[i] = std::move(data);
+			return true;
+		}));
+	}
+	uint32_t numSaved = 0;
+	for(auto i = decltype(results.size()) {0u}; i < results.size(); ++i) {
+		auto success = results[i].get();
+		if(success) {
+			auto *mat = materials[i];
+			std::string fileName;
+			auto absolute = absolutePath;
+			if(fileNames.empty())
+				mat->GetDefaultSaveFilePath(fileName, absolute);
+			else
+				fileName = fileNames[i];
+			success = mat->WriteUdmData(*udmData[i], fileName, errors[i], absolute);
+			udmData[i] = nullptr;
+		}
+		if(success)
+			++numSaved;
+		else if(errors[i].empty())
+			errors[i] = "Unknown error";
+	}
+	if(outErrors)
+		*outErrors = std::move(errors);
+	return numSaved;
+}
+void msys::MaterialManager::SetDeduplicationEnabled(bool enabled)
+{
+	m_deduplicationEnabled = enabled;
+	if(enabled)
+		return;
+	// Materials that have already been deduplicated remain shared
+	m_deduplicationTable.clear();
+	m_deduplicatedMaterials.clear();
+}
+void msys::MaterialManager::PruneDeduplicatedNames(DeduplicatedMaterial &dedupMat) const
+{
+	// Names may have been removed from the cache (or replaced) since they were deduplicated
+	auto mat = dedupMat.material.lock();
+	auto &names = dedupMat.names;
+	auto &self = const_cast<MaterialManager &>(*this);
+	names.erase(std::remove_if(names.begin(), names.end(),
+	              [&self, &mat](const std::string &name) {
+		              auto *asset = self.FindCachedAsset(name);
+		              return !mat || !asset || self.GetAssetObject(*asset) != mat;
+	              }),
+	  names.end());
+}
+uint32_t msys::MaterialManager::GetDeduplicatedNameCount(const Material &mat) const
+{
+	auto it = m_deduplicatedMaterials.find(&mat);
+	if(it == m_deduplicatedMaterials.end() || it->second.material.lock().get() != &mat)
+		return 1;
+	auto &dedupMat = const_cast<DeduplicatedMaterial &>(it->second);
+	PruneDeduplicatedNames(dedupMat);
+	return umath::max(static_cast<uint32_t>(dedupMat.names.size()), 1u);
+}
+std::vector<std::string> msys::MaterialManager::ReleaseDeduplicatedName(const Material &mat, const std::string &name)
+{
+	auto it = m_deduplicatedMaterials.find(&mat);
+	if(it == m_deduplicatedMaterials.end())
+		return {};
+	auto &names = it->second.names;
+	names.erase(std::remove(names.begin(), names.end(), name), names.end());
+	PruneDeduplicatedNames(it->second);
+	return names;
+}
+std::shared_ptr<Material> msys::MaterialManager::FindDuplicateMaterial(uint64_t hash, Material &mat)
+{
+	auto it = m_deduplicationTable.find(hash);
+	if(it == m_deduplicationTable.end())
+		return nullptr;
+	auto data = mat.GetDataBlock();
+	if(!data)
+		return nullptr;
+	auto &candidates = it->second;
+	for(auto itCandidate = candidates.begin(); itCandidate != candidates.end();) {
+		auto itMat = m_deduplicatedMaterials.find(*itCandidate);
+		auto candidate = (itMat != m_deduplicatedMaterials.end() && itMat->second.hash == hash) ? itMat->second.material.lock() : nullptr;
+		if(!candidate || candidate.get() != *itCandidate) {
+			// Material has been released in the meantime
+			if(itMat != m_deduplicatedMaterials.end() && itMat->second.material.expired())
+				m_deduplicatedMaterials.erase(itMat);
+			itCandidate = candidates.erase(itCandidate);
+			continue;
+		}
+		++itCandidate;
+		auto candidateData = candidate->GetDataBlock();
+		if(candidate->IsError() || candidate->GetShaderIdentifier() != mat.GetShaderIdentifier() || !candidateData || !compare_data_blocks(*candidateData, *data)) {
+			++m_deduplicationStats.hashCollisions;
+			continue;
+		}
+		return candidate;
+	}
+	if(candidates.empty())
+		m_deduplicationTable.erase(it);
+	return nullptr;
+}
+std::shared_ptr<Material> msys::MaterialManager::DeduplicateMaterial(uint64_t hash, Material &mat)
+{
+	auto existing = FindDuplicateMaterial(hash, mat);
+	if(!existing)
+		return nullptr;
+	m_deduplicatedMaterials[existing.get()].names.push_back(mat.GetName());
+	++m_deduplicationStats.deduplicatedMaterials;
+	return existing;
+}
+void msys::MaterialManager::RegisterDeduplicatedMaterial(uint64_t hash, const std::shared_ptr<Material> &mat)
+{
+	m_deduplicationTable[hash].push_back(mat.get());
+	m_deduplicatedMaterials[mat.get()] = {mat, hash, {mat->GetName()}};
+	++m_deduplicationStats.uniqueMaterials;
+}
+uint32_t msys::MaterialManager::GetMaterialIndexCount() const
+{
+	std::scoped_lock lock {m_materialIndexMutex};
+	return m_materialIndices.GetSlotCount();
+}
+void msys::MaterialManager::AssignMaterialIndex(Material &mat)
+{
+	if(mat.GetIndex() != std::numeric_limits<MaterialIndex>::max())
+		return;
+	{
+		std::scoped_lock lock {m_materialIndexMutex};
+		auto handle = m_materialIndices.Insert(&mat);
+		if(!handle.IsValid())
+			return; // Maximum number of materials has been reached
+		mat.SetIndex(handle.GetIndex());
+	}
+	UpdateRenderSortData(mat);
+}
+void msys::MaterialManager::ReleaseMaterialIndex(Material &mat)
+{
+	std::scoped_lock lock {m_materialIndexMutex};
+	auto idx = mat.GetIndex();
+	auto *entry = m_materialIndices.Get(idx);
+	if(!entry || *entry != &mat)
+		return;
+	m_materialIndices.Erase(idx);
+	mat.SetIndex(std::numeric_limits<MaterialIndex>::max());
+	// The next material that gets this index may not have any sort data yet
+	if(idx < m_sortKeys.size()) {
+		m_sortKeys[idx] = 0;
+		m_renderFeatureFlags[idx] = RenderFeatureFlags::None;
+	}
+}
+void msys::MaterialManager::UpdateRenderSortData(const Material &mat)
+{
+	auto idx = mat.GetIndex();
+	if(idx == std::numeric_limits<MaterialIndex>::max())
+		return; // Material hasn't been registered yet, the data will be updated once it is
+	if(idx >= m_sortKeys.size()) {
+		m_sortKeys.resize(idx + 1, 0);
+		m_renderFeatureFlags.resize(idx + 1, RenderFeatureFlags::None);
+	}
+	m_sortKeys[idx] = mat.GetSortKey();
+	m_renderFeatureFlags[idx] = mat.GetRenderFeatureFlags();
+}
+std::shared_ptr<msys::MaterialInstance> msys::MaterialManager::CreateMaterialInstance(Material &parent)
+{
+	auto instance = std::shared_ptr<MaterialInstance> {new MaterialInstance {*this, parent.GetHandle()}};
+	instance->Update();
+	auto &instances = m_materialInstances[&parent];
+	// Clean up instances that have been destroyed in the meantime
+	instances.erase(std::remove_if(instances.begin(), instances.end(), [](const std::weak_ptr<MaterialInstance> &wpInstance) { return wpInstance.expired(); }), instances.end());
+	instances.push_back(instance);
+	return instance;
+}
+void msys::MaterialManager::UpdateMaterialInstances(const Material &parent)
+{
+	auto it = m_materialInstances.find(&parent);
+	if(it == m_materialInstances.end())
+		return;
+	auto &instances = it->second;
+	for(auto itInstance = instances.begin(); itInstance != instances.end();) {
+		auto instance = itInstance->lock();
+		if(!instance) {
+			itInstance = instances.erase(itInstance);
+			continue;
+		}
+		instance->Update();
+		++itInstance;
+	}
+	if(instances.empty())
+		m_materialInstances.erase(it);
+}
+void msys::MaterialManager::InitializeProcessor(util::IAssetProcessor &processor)
+{
+	auto &matProcessor = static_cast<MaterialProcessor &>(processor);
+	auto identifier = ToCacheIdentifier(matProcessor.identifier);
+	matProcessor.cancellationToken = m_loadQueue.CreateCancellationToken(identifier);
+	// Materials that are loaded through LoadAssets are recorded under the same identifier, so they're only added to the manifest once
+	if(m_loadRecorder && !umath::is_flag_set(matProcessor.loadInfo->flags, util::AssetLoadFlags::DontCache))
+		m_loadRecorder->Record(identifier, matProcessor.loadInfo->flags);
+}
+uint32_t msys::MaterialManager::PreloadManifest(const AssetLoadManifest &manifest)
+{
+	uint32_t numQueued = 0;
+	auto &entries = manifest.GetEntries();
+	// Assets that have been requested earlier get a higher priority, so they're dispatched first
+	auto priority = static_cast<AssetLoadQueue::Priority>(std::min<size_t>(entries.size(), std::numeric_limits<AssetLoadQueue::Priority>::max()));
+	for(auto &entry : entries) {
+		auto entryPriority = priority;
+		if(priority > 0)
+			--priority;
+		if(FindCachedAsset(entry.identifier))
+			continue;
+		QueueAsset(entry.identifier, entryPriority, std::make_unique<MaterialLoadInfo>(entry.flags));
+		++numQueued;
+	}
+	return numQueued;
+}
+void msys::MaterialManager::QueueAsset(const std::string &path, AssetLoadQueue::Priority priority, std::unique_ptr<MaterialLoadInfo> &&loadInfo)
+{
+	if(!loadInfo)
+		loadInfo = std::make_unique<MaterialLoadInfo>();
+	m_loadQueue.Push(ToCacheIdentifier(path), priority, std::move(loadInfo));
+}
+bool msys::MaterialManager::SetAssetLoadPriority(const std::string &path, AssetLoadQueue::Priority priority) { return m_loadQueue.SetPriority(ToCacheIdentifier(path), priority); }
+bool msys::MaterialManager::CancelAssetLoad(const std::string &path)
+{
+	auto identifier = ToCacheIdentifier(path);
+	if(m_loadQueue.Remove(identifier))
+		return true;
+	if(!m_loadQueue.Cancel(identifier))
+		return false;
+	m_cancelledLoads.insert(identifier);
+	return true;
+}
+uint32_t msys::MaterialManager::DispatchQueuedAssets(uint32_t maxCount)
+{
+	uint32_t numDispatched = 0;
+	while(numDispatched < maxCount) {
+		auto request = m_loadQueue.Pop();
+		if(!request)
+			break;
+		if(FindCachedAsset(request->identifier))
+			continue;
+		// The result of the cancelled job may not have been cleared yet (see ClearCancelledLoads). The identifier is kept
+		// until the job has completed, in case it hasn't yet.
+		if(m_cancelledLoads.count(request->identifier) > 0)
+			ClearCachedResult(GetIdentifierHash(request->identifier));
+		PreloadAsset(request->identifier, util::static_unique_pointer_cast<util::AssetLoadInfo, MaterialLoadInfo>(std::move(request->loadInfo)));
+		++numDispatched;
+	}
+	return numDispatched;
+}
+void msys::MaterialManager::ClearCancelledLoads()
+{
+	// Cancelled jobs fail, so their results have to be cleared, otherwise later requests for the same asset would fail as well
+	for(auto &identifier : m_loadQueue.PollCompletedCancellations()) {
+		if(m_cancelledLoads.erase(identifier) > 0)
+			ClearCachedResult(GetIdentifierHash(identifier));
+	}
+}
 util::AssetObject msys::MaterialManager::InitializeAsset(const util::Asset &asset, const util::AssetLoadJob &job)
 {
 	auto &matProcessor = *static_cast<MaterialProcessor *>(job.processor.get());
-	matProcessor.material->SetIndex(asset.index);
-	return matProcessor.material;
+	auto &mat = matProcessor.material;
+	// Materials that are loaded without being cached (e.g. for reloading) must not be replaced
+	auto deduplicate = m_deduplicationEnabled && matProcessor.contentHash.has_value() && !mat->IsError() && !umath::is_flag_set(matProcessor.loadInfo->flags, util::AssetLoadFlags::DontCache);
+	if(deduplicate) {
+		auto existing = DeduplicateMaterial(*matProcessor.contentHash, *mat);
+		if(existing)
+			return existing;
+	}
+	AssignMaterialIndex(*mat);
+	if(deduplicate)
+		RegisterDeduplicatedMaterial(*matProcessor.contentHash, mat);
+	return mat;
 }
 std::shared_ptr<ds::Settings> msys::MaterialManager::CreateDataSettings() const { return ds::create_data_settings({}); }
 std::shared_ptr<Material> msys::MaterialManager::CreateMaterialObject(const std::string &shader, const std::shared_ptr<ds::Block> &data) { return Material::Create(*this, shader, data); }
@@ -256,28 +795,163 @@ std::shared_ptr<Material> msys::MaterialManager::CreateMaterial(const std::strin
 	auto mat = CreateMaterialObject(shader, data);
 	auto asset = std::make_shared<util::Asset>();
 	asset->assetObject = mat;
-	auto index = AddToIndex(asset);
-	mat->SetIndex(index);
+	// The asset index keeps the material alive, the material index is assigned separately, so that it can be re-used
+	AddToIndex(asset);
+	AssignMaterialIndex(*mat);
 	mat->SetLoaded(true);
 	return mat;
 }
 std::shared_ptr<Material> msys::MaterialManager::CreateMaterial(const std::string &identifier, const std::string &shader, const std::shared_ptr<ds::Block> &data)
 {
 	auto tmpMat = CreateMaterialObject(shader, data);
-	std::shared_ptr<Material> mat = nullptr;
 	auto *asset = FindCachedAsset(identifier);
 	if(asset) {
-		mat = GetAssetObject(*asset);
+		auto mat = GetAssetObject(*asset);
 		mat->Assign(*tmpMat);
+		UpdateMaterialInstances(*mat);
+		return mat;
 	}
-	else {
-		auto asset = std::make_shared<util::Asset>();
-		asset->assetObject = tmpMat;
-		auto idx = AddToCache(identifier, asset);
-		mat = tmpMat;
-		mat->SetIndex(idx);
-		mat->SetLoaded(true);
-		mat->SetName(ToCacheIdentifier(identifier));
+	return AddLoadedMaterial(identifier, tmpMat, {});
+}
+std::shared_ptr<Material> msys::MaterialManager::AddLoadedMaterial(const std::string &identifier, const std::shared_ptr<Material> &mat, std::optional<uint64_t> contentHash)
+{
+	auto deduplicate = m_deduplicationEnabled && contentHash.has_value() && !mat->IsError();
+	auto asset = std::make_shared<util::Asset>();
+	mat->SetName(ToCacheIdentifier(identifier));
+	if(deduplicate) {
+		auto existing = DeduplicateMaterial(*contentHash, *mat);
+		if(existing) {
+			asset->assetObject = existing;
+			AddToCache(identifier, asset);
+			return existing;
+		}
 	}
+	asset->assetObject = mat;
+	AddToCache(identifier, asset);
+	AssignMaterialIndex(*mat);
+	mat->SetLoaded(true);
+	if(deduplicate)
+		RegisterDeduplicatedMaterial(*contentHash, mat);
 	return mat;
 }
+extern const std::array<std::string, 5> g_knownMaterialFormats;
+bool msys::MaterialManager::StartFileWatcher(const FileWatcherSettings &settings)
+{
+	StopFileWatcher();
+	m_fileWatcher = FileWatcher::Create(util::get_program_path() + '/' + GetRootDirectory().GetString(), settings);
+	return m_fileWatcher != nullptr;
+}
+void msys::MaterialManager::StopFileWatcher() { m_fileWatcher = nullptr; }
+void msys::MaterialManager::Poll()
+{
+	util::TFileAssetManager<Material, MaterialLoadInfo>::Poll();
+	ClearCancelledLoads();
+	ProcessFileChanges();
+}
+void msys::MaterialManager::ProcessFileChanges()
+{
+	if(m_fileWatcher) {
+		std::vector<std::string> reloadPaths;
+		auto &imageFormats = ::MaterialManager::get_supported_image_formats();
+		for(auto &change : m_fileWatcher->Poll()) {
+			std::string ext;
+			if(!ufile::get_extension(change.path, &ext))
+				continue;
+			ustring::to_lower(ext);
+			auto isMaterial = std::find(g_knownMaterialFormats.begin(), g_knownMaterialFormats.end(), ext) != g_knownMaterialFormats.end();
+			auto isImage = !isMaterial && std::find_if(imageFormats.begin(), imageFormats.end(), [&ext](const ::MaterialManager::ImageFormat &format) { return format.extension == ext; }) != imageFormats.end();
+			// Other files in the material directory are ignored
+			if(!isMaterial && !isImage)
+				continue;
+			if(change.type == FileWatcher::ChangeType::Added)
+				notify_material_file_created(change.path);
+			else if(change.type == FileWatcher::ChangeType::Removed)
+				notify_material_file_removed(change.path);
+			auto identifier = change.path;
+			ufile::remove_extension_from_filename(identifier);
+			if(isImage) {
+				get_image_metadata_cache().Invalidate(identifier);
+				OnImageFileChanged(change, identifier);
+				continue;
+			}
+			// Removed materials remain loaded until they are released, and materials that haven't been loaded don't have to be reloaded
+			if(change.type == FileWatcher::ChangeType::Removed || !FindCachedAsset(identifier))
+				continue;
+			reloadPaths.push_back(std::move(identifier));
+		}
+		if(!reloadPaths.empty())
+			m_fileReloadBatches.push_back(LoadAssets(reloadPaths, util::AssetLoadFlags::IgnoreCache));
+	}
+	for(auto it = m_fileReloadBatches.begin(); it != m_fileReloadBatches.end();) {
+		if((*it)->Poll())
+			it = m_fileReloadBatches.erase(it);
+		else
+			++it;
+	}
+}
+std::shared_ptr<msys::MaterialLoadBatch> msys::MaterialManager::LoadAssets(std::span<const std::string> paths, util::AssetLoadFlags flags, const MaterialLoadBatch::OnMaterialLoaded &onLoaded)
+{
+	auto batch = std::shared_ptr<MaterialLoadBatch> {new MaterialLoadBatch {*this, onLoaded}};
+	batch->m_items.reserve(paths.size());
+	batch->m_materials.resize(paths.size());
+	auto ignoreCache = umath::is_flag_set(flags, util::AssetLoadFlags::IgnoreCache);
+	auto &pool = GetWorkerPool();
+	for(auto &path : paths) {
+		batch->m_items.push_back({});
+		auto &item = batch->m_items.back();
+		item.path = path;
+		auto *asset = FindCachedAsset(path);
+		if(m_loadRecorder && !asset)
+			m_loadRecorder->Record(ToCacheIdentifier(path), flags);
+		if(asset) {
+			if(!ignoreCache) {
+				item.cached = GetAssetObject(*asset);
+				continue;
+			}
+			item.reload = true;
+		}
+		// The file is located here, file lookups are not guaranteed to be thread-safe
+		auto assetFilePath = FindAssetFilePath(path);
+		std::string ext;
+		if(!assetFilePath || !ufile::get_extension(*assetFilePath, &ext)) {
+			std::promise<MaterialLoadBatch::ParseResult> failed;
+			failed.set_value({});
+			item.result = failed.get_future();
+			continue;
+		}
+		ustring::to_lower(ext);
+		if(ext != "pmat" && ext != "pmat_b" && ext != "wmi") {
+			// Formats that have to be imported first are loaded through the regular load path
+			MaterialLoadBatch::ParseResult result {};
+			result.fallback = true;
+			std::promise<MaterialLoadBatch::ParseResult> fallback;
+			fallback.set_value(std::move(result));
+			item.result = fallback.get_future();
+			continue;
+		}
+		auto filePath = GetRootDirectory();
+		filePath += util::Path::CreateFile(*assetFilePath);
+		item.result = pool.push([this, filePath = filePath.GetString(), ext](int) -> MaterialLoadBatch::ParseResult {
+			MaterialLoadBatch::ParseResult result {};
+			auto openMode = filemanager::FileMode::Read;
+			openMode |= filemanager::FileMode::Binary;
+			auto fp = filemanager::open_file(filePath, openMode);
+			if(!fp)
+				return result;
+			std::unique_ptr<ufile::IFile> f = std::make_unique<fsys::File>(fp);
+			std::string shader;
+			std::shared_ptr<ds::Block> data = nullptr;
+			auto success = (ext == "wmi") ? load_wmi_data(*f, shader, data) : load_pmat_data(*this, std::move(f), shader, data);
+			if(!success)
+				return result;
+			// The material object is created by MaterialLoadBatch on the calling thread, since creating it may load its textures,
+			// which is not thread-safe
+			if(IsDeduplicationEnabled() && data)
+				result.contentHash = hash_combine(std::hash<std::string> {}(shader), hash_data_block(*data));
+			result.shader = std::move(shader);
+			result.data = std::move(data);
+			return result;
+		});
+	}
+	return batch;
+}
@@ -0,0 +1,223 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "material_parameter_layout.hpp"
+#include "material.h"
+#include "textureinfo.h"
+#include "key_atom.hpp"
+#include <sharedutils/alpha_mode.hpp>
+#include <datasystem.h>
+#include <datasystem_vector.h>
+
+uint32_t msys::get_parameter_type_size(ParameterType type)
+{
+	switch(type) {
+	case ParameterType::Bool:
+		return sizeof(bool);
+	case ParameterType::Int:
+		return sizeof(int32_t);
+	case ParameterType::Float:
+		return sizeof(float);
+	case ParameterType::Vector2:
+		return sizeof(Vector2);
+	case ParameterType::Vector3:
+		return sizeof(Vector3);
+	case ParameterType::Vector4:
+		return sizeof(Vector4);
+	case ParameterType::Texture:
+		return sizeof(TextureInfo *);
+	}
+	static_assert(umath::to_integral(ParameterType::Count) == 7, "Update this implementation when new parameter types have been added!");
+	return 0;
+}
+
+std::shared_ptr<msys::ParameterSchema> msys::ParameterSchema::Create()
+{
+	auto schema = std::shared_ptr<ParameterSchema> {new ParameterSchema {}};
+	// Order has to match the BuiltinParameter enum!
+	schema->AddParameter<int32_t>("alpha_mode", umath::to_integral(AlphaMode::Opaque));
+	schema->AddParameter<float>("alpha_cutoff", 0.5f);
+	schema->AddParameter<Vector4>("color_factor", Vector4 {1.f, 1.f, 1.f, 1.f});
+	schema->AddParameter<Vector4>("bloom_color_factor", Vector4 {0.f, 0.f, 0.f, 0.f});
+
+	TextureInfo *nullTex = nullptr;
+	schema->AddParameter(Material::DIFFUSE_MAP_IDENTIFIER, nullTex);
+	schema->AddParameter(Material::ALBEDO_MAP_IDENTIFIER, nullTex);
+	schema->AddParameter(Material::NORMAL_MAP_IDENTIFIER, nullTex);
+	schema->AddParameter(Material::EMISSION_MAP_IDENTIFIER, nullTex);
+	schema->AddParameter(Material::PARALLAX_MAP_IDENTIFIER, nullTex);
+	schema->AddParameter(Material::ALPHA_MAP_IDENTIFIER, nullTex);
+	schema->AddParameter(Material::RMA_MAP_IDENTIFIER, nullTex);
+	static_assert(umath::to_integral(BuiltinParameter::Count) == 11, "Update this implementation when new built-in parameters have been added!");
+	return schema;
+}
+std::shared_ptr<msys::ParameterSchema> msys::ParameterSchema::Create(const ParameterSchema &base)
+{
+	auto schema = std::shared_ptr<ParameterSchema> {new ParameterSchema {base}};
+	return schema;
+}
+msys::ParameterIndex msys::ParameterSchema::AddParameter(const std::string &name, ParameterType type, const void *defaultValue)
+{
+	auto it = m_nameToIndex.find(name);
+	if(it != m_nameToIndex.end()) {
+		auto &param = m_parameters[it->second];
+		if(param.type != type)
+			return INVALID_PARAMETER_INDEX;
+		std::memcpy(m_defaultData.data() + param.offset, defaultValue, get_parameter_type_size(type));
+		return it->second;
+	}
+	auto size = get_parameter_type_size(type);
+	// Keep all values 4-byte aligned, except for pointers which are aligned to their own size
+	auto alignment = (type == ParameterType::Texture) ? static_cast<uint32_t>(alignof(TextureInfo *)) : 4u;
+	auto offset = static_cast<uint32_t>(m_defaultData.size());
+	offset = (offset + alignment - 1) & ~(alignment - 1);
+	m_defaultData.resize(offset + size, 0);
+	std::memcpy(m_defaultData.data() + offset, defaultValue, size);
+
+	auto idx = static_cast<ParameterIndex>(m_parameters.size());
+	auto atom = intern_key(name);
+	m_parameters.push_back({name, atom, type, offset});
+	m_nameToIndex[name] = idx;
+	if(atom >= m_atomToIndex.size())
+		m_atomToIndex.resize(atom + 1, INVALID_PARAMETER_INDEX);
+	m_atomToIndex[atom] = idx;
+	return idx;
+}
+msys::ParameterIndex msys::ParameterSchema::FindParameter(const std::string &name) const
+{
+	auto it = m_nameToIndex.find(name);
+	return (it != m_nameToIndex.end()) ? it->second : INVALID_PARAMETER_INDEX;
+}
+const msys::ParameterSchema::Parameter *msys::ParameterSchema::GetParameter(ParameterIndex idx) const { return (idx < m_parameters.size()) ? &m_parameters[idx] : nullptr; }
+
+///////////
+
+void msys::CompiledParameters::Clear()
+{
+	m_schema = nullptr;
+	m_data.clear();
+	m_defined.clear();
+	m_values.clear();
+	m_atomCount = 0;
+}
+const std::shared_ptr<ds::Base> &msys::CompiledParameters::GetValue(KeyAtom atom) const
+{
+	auto it = m_values.find(atom);
+	if(it == m_values.end()) {
+		static std::shared_ptr<ds::Base> nptr = nullptr;
+		return nptr;
+	}
+	return it->second;
+}
+void msys::CompiledParameters::SetValue(KeyAtom atom, const std::shared_ptr<ds::Base> &value)
+{
+	if(value == nullptr) {
+		m_values.erase(atom);
+		return;
+	}
+	m_values[atom] = value;
+}
+const msys::ParameterSchema::Parameter *msys::CompiledParameters::GetParameter(ParameterIndex idx, ParameterType type) const
+{
+	if(!m_schema)
+		return nullptr;
+	auto *param = m_schema->GetParameter(idx);
+	return (param && param->type == type) ? param : nullptr;
+}
+void msys::CompiledParameters::Compile(const std::shared_ptr<const ParameterSchema> &schema, ds::Block &data)
+{
+	m_schema = schema;
+	m_data = schema->GetDefaultData();
+	auto &params = schema->GetParameters();
+	m_defined.clear();
+	m_defined.resize(params.size(), false);
+
+	// Keys are only mapped to atoms that already exist (all at once, to keep the time spent under the atom table lock short).
+	// Arbitrary keys from material files are never interned here, so the global atom table doesn't grow with the number of loaded materials.
+	m_values.clear();
+	auto *values = data.GetData();
+	if(values) {
+		std::vector<const std::string *> keys;
+		keys.reserve(values->size());
+		for(auto &pair : *values)
+			keys.push_back(&pair.first);
+		std::vector<KeyAtom> atoms;
+		m_atomCount = find_key_atoms(keys, atoms);
+		m_values.reserve(values->size());
+		auto i = 0u;
+		for(auto &pair : *values) {
+			auto atom = atoms[i++];
+			if(atom != INVALID_KEY_ATOM)
+				m_values[atom] = pair.second;
+		}
+	}
+	else
+		m_atomCount = get_key_atom_count();
+	for(auto i = decltype(params.size()) {0u}; i < params.size(); ++i) {
+		auto &param = params[i];
+		auto &base = GetValue(param.atom);
+		if(base == nullptr || base->IsBlock() || base->IsContainer())
+			continue;
+		auto &val = static_cast<ds::Value &>(*base);
+		auto *ptr = m_data.data() + param.offset;
+		auto defined = true;
+		switch(param.type) {
+		case ParameterType::Bool:
+			{
+				auto v = val.GetBool();
+				std::memcpy(ptr, &v, sizeof(v));
+				break;
+			}
+		case ParameterType::Int:
+			{
+				auto v = static_cast<int32_t>(val.GetInt());
+				std::memcpy(ptr, &v, sizeof(v));
+				break;
+			}
+		case ParameterType::Float:
+			{
+				auto v = val.GetFloat();
+				std::memcpy(ptr, &v, sizeof(v));
+				break;
+			}
+		case ParameterType::Vector2:
+			{
+				defined = (typeid(val) == typeid(ds::Vector2));
+				if(defined) {
+					auto v = val.GetVector2();
+					std::memcpy(ptr, &v, sizeof(v));
+				}
+				break;
+			}
+		case ParameterType::Vector3:
+			{
+				defined = (typeid(val) == typeid(ds::Vector));
+				if(defined) {
+					auto v = val.GetVector();
+					std::memcpy(ptr, &v, sizeof(v));
+				}
+				break;
+			}
+		case ParameterType::Vector4:
+			{
+				defined = (typeid(val) == typeid(ds::Vector4));
+				if(defined) {
+					auto v = val.GetVector4();
+					std::memcpy(ptr, &v, sizeof(v));
+				}
+				break;
+			}
+		case ParameterType::Texture:
+			{
+				defined = (typeid(val) == typeid(ds::Texture));
+				if(defined) {
+					auto *v = &static_cast<ds::Texture &>(val).GetValue();
+					std::memcpy(ptr, &v, sizeof(v));
+				}
+				break;
+			}
+		}
+		m_defined[i] = defined;
+	}
+}
@@ -0,0 +1,40 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "material_sort_key.hpp"
+#include <unordered_map>
+#include <shared_mutex>
+#include <mutex>
+
+namespace msys {
+	struct ShaderSortIdRegistry {
+		std::shared_mutex mutex;
+		std::unordered_map<std::string, uint32_t> shaderToId;
+	};
+};
+
+static msys::ShaderSortIdRegistry &get_shader_sort_id_registry()
+{
+	static msys::ShaderSortIdRegistry registry {};
+	return registry;
+}
+
+uint32_t msys::get_shader_sort_id(const std::string &shader)
+{
+	auto &registry = get_shader_sort_id_registry();
+	{
+		std::shared_lock lock {registry.mutex};
+		auto it = registry.shaderToId.find(shader);
+		if(it != registry.shaderToId.end())
+			return it->second;
+	}
+	std::unique_lock lock {registry.mutex};
+	auto it = registry.shaderToId.find(shader);
+	if(it != registry.shaderToId.end())
+		return it->second;
+	// Ids that don't fit into the sort key are clamped to the last one, which only affects the sort order of those shaders
+	auto id = static_cast<uint32_t>(umath::min<size_t>(registry.shaderToId.size(), SORT_KEY_SHADER_MASK));
+	registry.shaderToId[shader] = id;
+	return id;
+}
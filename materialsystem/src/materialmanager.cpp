@@ -4,6 +4,8 @@
 
 #include "materialmanager.h"
 #include "textureinfo.h"
+#include "material_manager2.hpp"
+#include "directory_index.hpp"
 #include <sharedutils/alpha_mode.hpp>
 #include <fsys/filesystem.h>
 #include <fsys/ifile.hpp>
@@ -12,6 +14,7 @@
 #include <sharedutils/util_file.h>
 #include <sharedutils/util.h>
 #include <array>
+#include <mutex>
 #include <udm.hpp>
 #ifndef DISABLE_VMT_SUPPORT
 #include <VMTFile.h>
@@ -37,16 +40,22 @@ MaterialManager::LoadInfo::LoadInfo() : material(nullptr) {}
 static std::string g_materialLocation = "materials";
 std::optional<std::string> MaterialManager::FindMaterialPath(const std::string &material)
 {
-	std::string ext;
-	auto path = PathToIdentifier(material, &ext);
-	//path += '.' +ext;
-	if(FileManager::Exists(g_materialLocation + '/' + path) == false)
+	auto resolved = ResolveMaterialPath(material);
+	if(resolved->exists == false)
 		return {};
-	return path;
+	return resolved->path;
 }
 
-MaterialManager::MaterialManager() : m_error {} {}
-MaterialManager::~MaterialManager() { Clear(); }
+MaterialManager::MaterialManager() : m_error {}
+{
+	// Only the names of the material whose file has changed have to be resolved again
+	m_materialFileListener = msys::add_material_file_listener([this](const std::string &path) { InvalidatePathResolution(path); });
+}
+MaterialManager::~MaterialManager()
+{
+	msys::remove_material_file_listener(m_materialFileListener);
+	Clear();
+}
 
 void MaterialManager::SetRootMaterialLocation(const std::string &location) { g_materialLocation = location; }
 const std::string &MaterialManager::GetRootMaterialLocation() { return g_materialLocation; }
@@ -69,7 +78,10 @@ Material *MaterialManager::CreateMaterial(const std::string *identifier, const s
 		auto dataSettings = ds::create_data_settings(ENUM_VARS);
 		root = std::make_shared<ds::Block>(*dataSettings);
 	}
-	Material *mat; //auto *mat = CreateMaterial<Material>(shader,root); // Claims ownership of 'root' and frees the memory at destruction
+	Material *mat = nullptr; //auto *mat = CreateMaterial<Material>(shader,root); // Claims ownership of 'root' and frees the memory at destruction
+	// Materials are constructed by msys::MaterialManager, which this manager has no access to
+	if(mat == nullptr)
+		return nullptr;
 	mat->SetName(matId);
 	AddMaterial(matId, *mat);
 	return mat;
@@ -78,44 +90,135 @@ Material *MaterialManager::CreateMaterial(const std::string *identifier, const s
 void MaterialManager::AddMaterial(const std::string &identifier, Material &mat)
 {
 	auto nidentifier = ToMaterialIdentifier(identifier);
-	auto it = m_nameToMaterialIndex.find(nidentifier);
-	if(it != m_nameToMaterialIndex.end()) {
-		///m_materials[it->second] = mat.GetHandle();
-		//mat.SetIndex(it->second);
+	if(FindMaterialRecord(nidentifier) != nullptr)
 		return;
+	// The material may already be registered under a different name (e.g. the error material)
+	// The material index is owned by msys::MaterialManager, so the slot in this table is tracked separately
+	auto hMat = GetMaterialHandle(mat.GetLegacyIndex());
+	auto *record = m_materials.Find(hMat);
+	if(record == nullptr || record->material != &mat) {
+		hMat = m_materials.Insert(MaterialRecord {&mat, mat.GetHandle()});
+		if(!hMat.IsValid())
+			return;
+		mat.SetLegacyIndex(hMat.GetIndex());
 	}
-	//mat.SetIndex(m_materials.size());
-	if(m_materials.size() == m_materials.capacity())
-		m_materials.reserve(m_materials.size() * 1.1 + 100);
-	//m_materials.push_back(mat.GetHandle());
-	m_nameToMaterialIndex[nidentifier] = mat.GetIndex();
+	m_nameToMaterial[nidentifier] = hMat;
+}
+MaterialManager::MaterialRecord *MaterialManager::FindMaterialRecord(const std::string &nidentifier)
+{
+	auto it = m_nameToMaterial.find(nidentifier);
+	if(it == m_nameToMaterial.end())
+		return nullptr;
+	return m_materials.Find(it->second);
 }
+const MaterialManager::MaterialRecord *MaterialManager::FindMaterialRecord(const std::string &nidentifier) const { return const_cast<MaterialManager *>(this)->FindMaterialRecord(nidentifier); }
 
 extern const std::array<std::string, 5> g_knownMaterialFormats = {Material::FORMAT_MATERIAL_BINARY, Material::FORMAT_MATERIAL_ASCII, "wmi", "vmat_c", "vmt"};
-std::string MaterialManager::PathToIdentifier(const std::string &path, std::string *ext, bool &hadExtension) const
+std::shared_ptr<const MaterialManager::ResolvedMaterialPath> MaterialManager::ResolveMaterialPath(const std::string &path) const
 {
+	{
+		std::shared_lock lock {m_pathResolutionMutex};
+		auto it = m_pathResolutionCache.find(path);
+		if(it != m_pathResolutionCache.end())
+			return it->second;
+	}
+	// Has to be queried before the lookup. If a file is created or removed in the meantime, the result may be outdated
+	// before it has been added to the cache, in which case it's not cached.
+	auto fileGeneration = msys::get_material_file_generation();
+	auto resolved = std::make_shared<ResolvedMaterialPath>();
 	auto matPath = FileManager::GetNormalizedPath(path);
 	std::string fext;
 	auto hasExt = ufile::get_extension(matPath, &fext);
 	if(hasExt) {
-		auto lext = fext;
-		ustring::to_lower(lext);
-		auto it = std::find(g_knownMaterialFormats.begin(), g_knownMaterialFormats.end(), lext);
+		ustring::to_lower(fext);
+		auto it = std::find(g_knownMaterialFormats.begin(), g_knownMaterialFormats.end(), fext);
 		if(it == g_knownMaterialFormats.end())
 			hasExt = false; // Assume that it's part of the filename
 	}
+	auto &dirIndex = msys::get_material_directory_index();
 	if(hasExt == false) {
-		hadExtension = false;
-		for(auto &exts : g_knownMaterialFormats) {
-			*ext = exts;
-			if(FileManager::Exists(g_materialLocation + "\\" + matPath + '.' + *ext))
-				break;
+		std::optional<std::string> indexedExt {};
+		if(dirIndex.IsActive()) {
+			static const std::vector<std::string> knownMaterialFormats {g_knownMaterialFormats.begin(), g_knownMaterialFormats.end()};
+			indexedExt = dirIndex.FindFirstExtension(msys::DirectoryIndex::NormalizePath(matPath), knownMaterialFormats);
+			resolved->extension = indexedExt.has_value() ? *indexedExt : g_knownMaterialFormats.back();
+			resolved->exists = indexedExt.has_value();
+		}
+		else {
+			for(auto &ext : g_knownMaterialFormats) {
+				resolved->extension = ext;
+				if(FileManager::Exists(g_materialLocation + '/' + matPath + '.' + ext)) {
+					resolved->exists = true;
+					break;
+				}
+			}
 		}
-		matPath += '.' + *ext;
+		matPath += '.' + resolved->extension;
 	}
-	else
-		hadExtension = true;
-	return matPath;
+	else {
+		resolved->hadExtension = true;
+		resolved->extension = std::move(fext);
+		resolved->exists = dirIndex.IsActive() ? dirIndex.Exists(msys::DirectoryIndex::NormalizePath(matPath)) : FileManager::Exists(g_materialLocation + '/' + matPath);
+	}
+	resolved->identifier = ToMaterialIdentifier(matPath);
+	resolved->path = std::move(matPath);
+
+	std::unique_lock lock {m_pathResolutionMutex};
+	if(msys::get_material_file_generation() != fileGeneration)
+		return resolved;
+	auto it = m_pathResolutionCache.find(path);
+	if(it != m_pathResolutionCache.end())
+		return it->second; // Another thread has resolved the same name in the meantime
+	m_pathResolutionCache[path] = resolved;
+	m_pathResolutionNames[resolved->identifier].push_back(path);
+	m_pathResolutionOrder.push_back(path);
+	// Every cached name has at least one entry in the order queue, so this also limits the size of the cache. A name that has been
+	// invalidated and resolved again may be evicted earlier than necessary, which only means that it has to be resolved once more.
+	while(m_pathResolutionOrder.size() > MAX_PATH_RESOLUTION_CACHE_SIZE) {
+		ErasePathResolution(m_pathResolutionOrder.front());
+		m_pathResolutionOrder.pop_front();
+	}
+	return resolved;
+}
+void MaterialManager::ErasePathResolution(const std::string &path) const
+{
+	auto it = m_pathResolutionCache.find(path);
+	if(it == m_pathResolutionCache.end())
+		return;
+	auto itNames = m_pathResolutionNames.find(it->second->identifier);
+	if(itNames != m_pathResolutionNames.end()) {
+		auto &names = itNames->second;
+		names.erase(std::remove(names.begin(), names.end(), path), names.end());
+		if(names.empty())
+			m_pathResolutionNames.erase(itNames);
+	}
+	m_pathResolutionCache.erase(it);
+}
+void MaterialManager::InvalidatePathResolutionCache()
+{
+	std::unique_lock lock {m_pathResolutionMutex};
+	m_pathResolutionCache.clear();
+	m_pathResolutionNames.clear();
+	m_pathResolutionOrder.clear();
+}
+void MaterialManager::InvalidatePathResolutionByIdentifier(const std::string &identifier)
+{
+	std::unique_lock lock {m_pathResolutionMutex};
+	auto it = m_pathResolutionNames.find(identifier);
+	if(it == m_pathResolutionNames.end())
+		return;
+	// Includes names that have been cached as non-existent, as well as names that resolve to a different format of the same material
+	for(auto &name : it->second)
+		m_pathResolutionCache.erase(name);
+	m_pathResolutionNames.erase(it);
+}
+void MaterialManager::InvalidatePathResolution(const std::string &path) { InvalidatePathResolutionByIdentifier(ToMaterialIdentifier(FileManager::GetNormalizedPath(path))); }
+std::string MaterialManager::PathToIdentifier(const std::string &path, std::string *ext, bool &hadExtension) const
+{
+	auto resolved = ResolveMaterialPath(path);
+	*ext = resolved->extension;
+	hadExtension = resolved->hadExtension;
+	return resolved->path;
 }
 
 std::string MaterialManager::PathToIdentifier(const std::string &path, std::string *ext) const
@@ -131,19 +234,36 @@ std::string MaterialManager::PathToIdentifier(const std::string &path) const
 
 Material *MaterialManager::FindMaterial(const std::string &identifier, std::string &internalMatId) const
 {
-	internalMatId = PathToIdentifier(identifier);
-	auto it = m_nameToMaterialIndex.find(ToMaterialIdentifier(internalMatId));
-	if(it == m_nameToMaterialIndex.end())
-		return nullptr;
-	return m_materials.at(it->second).get();
+	auto resolved = ResolveMaterialPath(identifier);
+	internalMatId = resolved->path;
+	auto *record = FindMaterialRecord(resolved->identifier);
+	return record ? record->material : nullptr;
 }
 Material *MaterialManager::FindMaterial(const std::string &identifier) const
 {
-	std::string internalMatId;
-	return FindMaterial(identifier, internalMatId);
+	auto *record = FindMaterialRecord(ResolveMaterialPath(identifier)->identifier);
+	return record ? record->material : nullptr;
+}
+Material *MaterialManager::GetMaterial(MaterialIndex index)
+{
+	auto *record = m_materials.Get(index);
+	return record ? record->material : nullptr;
 }
-Material *MaterialManager::GetMaterial(MaterialIndex index) { return (index < m_materials.size()) ? m_materials.at(index).get() : nullptr; }
 const Material *MaterialManager::GetMaterial(MaterialIndex index) const { return const_cast<MaterialManager *>(this)->GetMaterial(index); }
+Material *MaterialManager::GetMaterial(msys::SlotHandle handle)
+{
+	auto *record = m_materials.Find(handle);
+	return record ? record->material : nullptr;
+}
+const Material *MaterialManager::GetMaterial(msys::SlotHandle handle) const { return const_cast<MaterialManager *>(this)->GetMaterial(handle); }
+msys::SlotHandle MaterialManager::GetMaterialHandle(MaterialIndex index) const { return m_materials.GetHandle(index); }
+msys::SlotHandle MaterialManager::FindMaterialHandle(const std::string &identifier) const
+{
+	auto it = m_nameToMaterial.find(ResolveMaterialPath(identifier)->identifier);
+	if(it == m_nameToMaterial.end() || !m_materials.IsValid(it->second))
+		return {};
+	return it->second;
+}
 std::shared_ptr<ds::Settings> MaterialManager::CreateDataSettings() const { return ds::create_data_settings(ENUM_VARS); }
 
 std::string MaterialManager::ToMaterialIdentifier(const std::string &id) const
@@ -157,24 +277,24 @@ std::string MaterialManager::ToMaterialIdentifier(const std::string &id) const
 
 bool MaterialManager::Load(const std::string &path, LoadInfo &info, bool bReload)
 {
-	std::string ext;
-	auto &matId = info.identifier;
-	auto bHadExtension = false;
-	matId = FileManager::GetNormalizedPath(path);
-	auto it = m_nameToMaterialIndex.find(ToMaterialIdentifier(matId));
-	if(it != m_nameToMaterialIndex.end()) {
-		auto &hMat = m_materials.at(it->second);
-		if(hMat.IsValid()) {
-			info.material = hMat.get();
-			info.shader = info.material->GetShaderIdentifier();
-			if(bReload == false)
-				return true;
-		}
+	if(bReload)
+		InvalidatePathResolution(path);
+	auto resolved = ResolveMaterialPath(path);
+	auto *record = FindMaterialRecord(resolved->identifier);
+	if(record != nullptr) {
+		info.material = record->material;
+		info.shader = info.material->GetShaderIdentifier();
+		if(bReload == false)
+			return true;
 	}
-	matId = PathToIdentifier(matId, &ext, bHadExtension);
+	if(resolved->exists == false)
+		return false;
+	auto &matId = info.identifier;
+	matId = resolved->path;
+	auto &ext = resolved->extension;
 	std::string absPath = g_materialLocation + "\\";
 	absPath += path;
-	if(bHadExtension == false)
+	if(resolved->hadExtension == false)
 		absPath += '.' + ext;
 	auto sub = matId;
 	std::string openMode = "r";
@@ -298,73 +418,12 @@ bool MaterialManager::LoadUdm(std::shared_ptr<VFilePtrInternal> &f, LoadInfo &lo
 	auto dataSettings = CreateDataSettings();
 	auto root = std::make_shared<ds::Block>(*dataSettings);
 
-	std::function<void(const std::string &key, udm::LinkedPropertyWrapper &prop, ds::Block &block, bool texture)> udmToDataSys = nullptr;
-	udmToDataSys = [&udmToDataSys, &dataSettings](const std::string &key, udm::LinkedPropertyWrapper &prop, ds::Block &block, bool texture) {
-		prop.InitializeProperty();
-		if(prop.prop) {
-			switch(prop.prop->type) {
-			case udm::Type::String:
-				block.AddValue(texture ? "texture" : "string", key, prop.prop->ToValue<std::string>(""));
-				break;
-			case udm::Type::Int8:
-			case udm::Type::UInt8:
-			case udm::Type::Int16:
-			case udm::Type::UInt16:
-			case udm::Type::Int32:
-			case udm::Type::UInt32:
-			case udm::Type::Int64:
-			case udm::Type::UInt64:
-				block.AddValue("int", key, std::to_string(prop.prop->ToValue<int32_t>(0)));
-				break;
-			case udm::Type::Float:
-			case udm::Type::Double:
-				block.AddValue("float", key, std::to_string(prop.prop->ToValue<float>(0.f)));
-				break;
-			case udm::Type::Boolean:
-				block.AddValue("bool", key, std::to_string(prop.prop->ToValue<bool>(false)));
-				break;
-			case udm::Type::Vector2:
-				{
-					auto v = prop.prop->ToValue<Vector2>(Vector2 {});
-					block.AddValue("vector2", key, std::to_string(v.x) + ' ' + std::to_string(v.y));
-					break;
-				}
-			case udm::Type::Vector3:
-				{
-					auto v = prop.prop->ToValue<Vector3>(Vector3 {});
-					block.AddValue("vector", key, std::to_string(v.x) + ' ' + std::to_string(v.y) + ' ' + std::to_string(v.z));
-					break;
-				}
-			case udm::Type::Vector4:
-				{
-					auto v = prop.prop->ToValue<Vector4>(Vector4 {});
-					block.AddValue("vector4", key, std::to_string(v.x) + ' ' + std::to_string(v.y) + ' ' + std::to_string(v.z) + ' ' + std::to_string(v.w));
-					break;
-				}
-			case udm::Type::Element:
-				{
-					auto childBlock = block.AddBlock(key);
-					for(auto udmChild : prop.ElIt())
-						udmToDataSys(std::string {udmChild.key}, udmChild.property, *childBlock, texture);
-					break;
-				}
-			}
-			static_assert(umath::to_integral(udm::Type::Count) == 36u);
-		}
-		prop.GetValuePtr<float>();
-	};
 	auto it = data.begin_el();
 	if(it == data.end_el())
 		return false;
 	auto &firstEl = *it;
-
-	auto udmTextures = firstEl.property["textures"];
-	for(auto udmTex : udmTextures.ElIt())
-		udmToDataSys(std::string {udmTex.key}, udmTex.property, *root, true);
-
-	auto udmProps = firstEl.property["properties"];
-	for(auto udmProp : udmProps.ElIt())
-		udmToDataSys(std::string {udmProp.key}, udmProp.property, *root, false);
+	if(!msys::udm_to_data_block(firstEl.property, *root))
+		return false;
 
 	loadInfo.shader = firstEl.key;
 	loadInfo.root = root;
@@ -380,16 +439,12 @@ void MaterialManager::SetErrorMaterial(Material *mat)
 	}
 }
 Material *MaterialManager::GetErrorMaterial() const { return m_error.get(); }
-const std::vector<MaterialHandle> &MaterialManager::GetMaterials() const { return m_materials; }
+const MaterialManager::MaterialTable &MaterialManager::GetMaterials() const { return m_materials; }
 uint32_t MaterialManager::Clear()
 {
-	for(auto &hMaterial : m_materials) {
-		//if(hMaterial.IsValid())
-		//	hMaterial->Remove();
-	}
-	auto n = m_materials.size();
-	m_materials.clear();
-	m_nameToMaterialIndex.clear();
+	auto n = m_materials.GetSize();
+	m_materials.Clear();
+	m_nameToMaterial.clear();
 	return n;
 }
 void MaterialManager::SetTextureImporter(const std::function<VFilePtr(const std::string &, const std::string &)> &fileHandler) { m_textureImporter = fileHandler; }
@@ -397,27 +452,23 @@ const std::function<std::shared_ptr<VFilePtrInternal>(const std::string &, const
 uint32_t MaterialManager::ClearUnused()
 {
 	uint32_t n = 0;
-	for(auto it = m_materials.begin(); it != m_materials.end();) {
-		auto &hMaterial = *it;
+	for(auto it = m_materials.begin(); it != m_materials.end(); ++it) {
+		auto &record = *it;
 		// Note: If a material has a use count of 2 (i.e. 2 handles), it means it's not actually being used, since the material itself
 		// has one handle, and the material manager has one as well.
-		if(hMaterial.IsValid() && hMaterial.use_count() <= 2 && hMaterial.get() != m_error.get()) {
-			auto matIdx = hMaterial->GetIndex();
-			/*for(auto it=m_nameToMaterialIndex.begin();it!=m_nameToMaterialIndex.end();++it)
-			{
-				if(it->second != matIdx)
-					continue;
-				m_nameToMaterialIndex.erase(it);
-				break;
-			}*/
-			//	hMaterial->Remove();
-			//it = m_materials.erase(it);
-			*it = {};
-			++it;
+		if(record.handle && record.handle.use_count() <= 2 && record.material != m_error.get()) {
+			// The slot will be re-used by the next material that is added
+			m_materials.Erase(it.GetIndex());
 			++n;
 		}
-		else
-			++it;
+	}
+	if(n > 0) {
+		for(auto it = m_nameToMaterial.begin(); it != m_nameToMaterial.end();) {
+			if(m_materials.IsValid(it->second))
+				++it;
+			else
+				it = m_nameToMaterial.erase(it);
+		}
 	}
 	return n;
 }
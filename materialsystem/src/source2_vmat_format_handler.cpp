@@ -9,6 +9,7 @@
 #include "source2_vmat_format_handler.hpp"
 #include "material_manager2.hpp"
 #include "material.h"
+#include "import_cache.hpp"
 #include <fsys/ifile.hpp>
 
 #ifndef DISABLE_VMAT_SUPPORT
@@ -20,8 +21,31 @@
 msys::Source2VmatFormatHandler::Source2VmatFormatHandler(util::IAssetManager &assetManager) : util::IImportAssetFormatHandler {assetManager} {}
 bool msys::Source2VmatFormatHandler::Import(const std::string &outputPath, std::string &outFilePath)
 {
+	// Skip the conversion if the exact same VMAT has been imported before
+	std::vector<uint8_t> data;
+	data.resize(m_file->GetSize());
+	data.resize(m_file->Read(data.data(), data.size()));
+	m_file->Seek(0);
+	auto ext = static_cast<MaterialManager &>(GetAssetManager()).GetImportFileExtension();
+	auto &importCache = get_import_cache();
+	auto key = ImportCache::ComputeKey(data.data(), data.size(), GetConverterName() + '.' + ext);
+	if(importCache.Restore(key, outputPath + '.' + ext)) {
+		outFilePath = outputPath + '.' + ext;
+		return true;
+	}
+
 	auto resource = source2::load_resource(*m_file);
-	return resource ? LoadVMat(*resource, outputPath, outFilePath) : false;
+	if(!resource)
+		return false;
+	m_generatedFiles.clear();
+	m_cacheable = true;
+	if(!LoadVMat(*resource, outputPath, outFilePath))
+		return false;
+	if(m_cacheable) {
+		m_generatedFiles.insert(m_generatedFiles.begin(), outFilePath);
+		importCache.Store(key, {{}, std::move(m_generatedFiles)});
+	}
+	return true;
 }
 bool msys::Source2VmatFormatHandler::LoadVMat(::source2::resource::Resource &resource, const std::string &outputPath, std::string &outFilePath)
 {
@@ -146,7 +170,7 @@ bool msys::Source2VmatFormatHandler::LoadVMat(::source2::resource::Resource &res
 	if(!mat)
 		return false;
 	std::string err;
-	outFilePath = outputPath + ".pmat";
+	outFilePath = outputPath + '.' + static_cast<MaterialManager &>(GetAssetManager()).GetImportFileExtension();
 	if(!mat->Save(outFilePath, err, true)) {
 		m_error = std::move(err);
 		return false;
@@ -11,6 +11,7 @@
 #include "material_manager2.hpp"
 #include "textureinfo.h"
 #include "detail_mode.hpp"
+#include "import_cache.hpp"
 #include <sharedutils/util_string.h>
 #include <datasystem.h>
 
@@ -32,12 +33,29 @@ bool msys::SourceVmtFormatHandler::Import(const std::string &outputPath, std::st
 		return false;
 	data.resize(size);
 
+	// Skip the conversion if the exact same VMT has been imported before
+	auto ext = static_cast<MaterialManager &>(GetAssetManager()).GetImportFileExtension();
+	auto &importCache = get_import_cache();
+	auto key = ImportCache::ComputeKey(data.data(), data.size(), GetConverterName() + '.' + ext);
+	if(importCache.Restore(key, outputPath + '.' + ext)) {
+		outFilePath = outputPath + '.' + ext;
+		return true;
+	}
+
 	VTFLib::CVMTFile vmt {};
 	if(vmt.Load(data.data(), static_cast<vlUInt>(size)) != vlTrue) {
 		m_error = "VMT Parsing error in material: " + std::string {vlGetLastError()};
 		return false;
 	}
-	return LoadVMT(vmt, outputPath, outFilePath);
+	m_generatedFiles.clear();
+	m_cacheable = true;
+	if(!LoadVMT(vmt, outputPath, outFilePath))
+		return false;
+	if(m_cacheable) {
+		m_generatedFiles.insert(m_generatedFiles.begin(), outFilePath);
+		importCache.Store(key, {{}, std::move(m_generatedFiles)});
+	}
+	return true;
 }
 
 // Find highest dx node version and merge its values with the specified node
@@ -490,7 +508,7 @@ bool msys::SourceVmtFormatHandler::LoadVMT(VTFLib::CVMTFile &vmt, const std::str
 	if(!mat)
 		return false;
 	std::string err;
-	outFilePath = outputPath + ".pmat";
+	outFilePath = outputPath + '.' + static_cast<MaterialManager &>(GetAssetManager()).GetImportFileExtension();
 	if(!mat->Save(outFilePath, err, true)) {
 		m_error = std::move(err);
 		return false;
@@ -11,6 +11,7 @@
 #include "material_manager2.hpp"
 #include "textureinfo.h"
 #include "detail_mode.hpp"
+#include "import_cache.hpp"
 #include <sharedutils/util_string.h>
 #include <datasystem.h>
 
@@ -31,13 +32,30 @@ bool msys::SourceVmtFormatHandler2::Import(const std::string &outputPath, std::s
 		return false;
 	data.resize(size);
 
+	// Skip the conversion if the exact same VMT has been imported before
+	auto ext = static_cast<MaterialManager &>(GetAssetManager()).GetImportFileExtension();
+	auto &importCache = get_import_cache();
+	auto key = ImportCache::ComputeKey(data.data(), data.size(), GetConverterName() + '.' + ext);
+	if(importCache.Restore(key, outputPath + '.' + ext)) {
+		outFilePath = outputPath + '.' + ext;
+		return true;
+	}
+
 	ValveKeyValueFormat::setLogCallback([](const std::string &message, ValveKeyValueFormat::LogLevel severity) { std::cout << message << std::endl; });
 	auto kvNode = ValveKeyValueFormat::parseKVBuffer(data);
 	if(!kvNode) {
 		m_error = "TODO";
 		return false;
 	}
-	return LoadVMT(*kvNode, outputPath, outFilePath);
+	m_generatedFiles.clear();
+	m_cacheable = true;
+	if(!LoadVMT(*kvNode, outputPath, outFilePath))
+		return false;
+	if(m_cacheable) {
+		m_generatedFiles.insert(m_generatedFiles.begin(), outFilePath);
+		importCache.Store(key, {{}, std::move(m_generatedFiles)});
+	}
+	return true;
 }
 
 // Find highest dx node version and merge its values with the specified node
@@ -504,7 +522,7 @@ bool msys::SourceVmtFormatHandler2::LoadVMT(ValveKeyValueFormat::KVNode &vmt, co
 	if(!mat)
 		return false;
 	std::string err;
-	outFilePath = outputPath + ".pmat";
+	outFilePath = outputPath + '.' + static_cast<MaterialManager &>(GetAssetManager()).GetImportFileExtension();
 	if(!mat->Save(outFilePath, err, true)) {
 		m_error = std::move(err);
 		return false;
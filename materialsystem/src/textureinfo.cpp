@@ -4,42 +4,64 @@
 
 #include "textureinfo.h"
 #include "impl_texture_formats.h"
+#include "image_metadata_cache.hpp"
 #include <util_image.hpp>
 #include <sharedutils/util_file.h>
+#include <sharedutils/util_string.h>
+#include <fsys/filesystem.h>
 #include <cstring>
+#include <thread>
 
-static bool read_image_size(std::string &imgFile, uint32_t &width, uint32_t &height)
+static bool read_image_size(const std::string &imgFile, uint32_t &width, uint32_t &height)
 {
+	auto &cache = msys::get_image_metadata_cache();
+	auto metadata = cache.Find(imgFile);
+	if(metadata.has_value()) {
+		width = metadata->width;
+		height = metadata->height;
+		return true;
+	}
 	TextureType type;
-	imgFile = translate_image_path(imgFile, type);
-	auto r = uimg::read_image_size(imgFile, width, height);
+	auto path = translate_image_path(imgFile, type);
+	if(uimg::read_image_size(path, width, height) == false)
+		return false;
+	msys::ImageMetadata newMetadata {};
+	newMetadata.width = width;
+	newMetadata.height = height;
 	auto rootPath = MaterialManager::GetRootMaterialLocation() + "/";
-	imgFile = imgFile.substr(rootPath.length());
-	return r;
+	cache.Store(imgFile, path.substr(rootPath.length()), newMetadata);
+	return true;
+}
+
+// Resolves the extension of the image file, same as translate_image_path. If the material directory index is active,
+// that's a lookup in the index instead of a file system query. The image header is not read.
+static std::string translate_texture_name(const std::string &name)
+{
+	TextureType type;
+	auto path = translate_image_path(name, type);
+	return path.substr(MaterialManager::GetRootMaterialLocation().length() + 1);
+}
+static const std::vector<std::string> &get_image_format_extensions()
+{
+	static const std::vector<std::string> extensions = []() {
+		std::vector<std::string> extensions;
+		for(auto &format : MaterialManager::get_supported_image_formats())
+			extensions.push_back(format.extension);
+		return extensions;
+	}();
+	return extensions;
 }
 
 ds::Texture::Texture(ds::Settings &dataSettings, const std::string &value, bool bCubemap) : Value(dataSettings)
 {
-	auto str = value;
-	if(str.empty()) {
-		m_value.texture = nullptr;
-		m_value.width = 0;
-		m_value.height = 0;
+	// The image size is resolved lazily, reading the image header here would require opening the image file of
+	// every texture of every material that is being loaded.
+	m_value.texture = nullptr;
+	if(value.empty()) {
+		m_value.SetSize(0, 0);
 		return;
 	}
-	uint32_t width;
-	uint32_t height;
-	if(read_image_size(str, width, height) == true) {
-		m_value.texture = NULL;
-		m_value.width = width;
-		m_value.height = height;
-	}
-	else {
-		m_value.texture = NULL;
-		m_value.width = 0;
-		m_value.height = 0;
-	}
-	m_value.name = str;
+	m_value.name = translate_texture_name(value);
 }
 ds::Texture::Texture(ds::Settings &dataSettings, const std::string &value) : Texture(dataSettings, value, false) {}
 ds::Texture::Texture(ds::Settings &dataSettings, const TextureInfo &value) : Value(dataSettings), m_value(value) {}
@@ -51,7 +73,7 @@ std::string ds::Texture::GetString() const
 {
 	auto name = m_value.name;
 	ustring::replace(name, "\\", "/");
-	ufile::remove_extension_from_filename(name); // TODO: Allow manual extension if it was specified explicitly?
+	ufile::remove_extension_from_filename(name, get_image_format_extensions()); // TODO: Allow manual extension if it was specified explicitly?
 	return name;
 }
 int ds::Texture::GetInt() const { return 0; }
@@ -70,6 +92,82 @@ REGISTER_DATA_TYPE(ds::Cubemap,cubemap)*/
 
 ///////////////////////////
 
-TextureInfo::TextureInfo() : name(), width(0), height(0), texture(nullptr) {}
+TextureInfo::TextureInfo() : name(), width {*this, false}, height {*this, true}, texture(nullptr), m_width(0), m_height(0), m_sizeState {SizeState::Unknown} {}
 
-TextureInfo::TextureInfo(const TextureInfo &other) : name(other.name), width(other.width), height(other.height), texture(other.texture) {}
+TextureInfo::TextureInfo(const TextureInfo &other) : name(), width {*this, false}, height {*this, true}, texture(nullptr), m_width(0), m_height(0), m_sizeState {SizeState::Unknown} { operator=(other); }
+TextureInfo &TextureInfo::operator=(const TextureInfo &other)
+{
+	if(this == &other)
+		return *this;
+	name = other.name;
+	texture = other.texture;
+	auto state = other.m_sizeState.load(std::memory_order_acquire);
+	if(state == SizeState::Probing)
+		state = SizeState::Unknown; // The other instance is still reading the header, we'll have to do it ourselves if needed
+	m_width = (state == SizeState::Known) ? other.m_width : 0;
+	m_height = (state == SizeState::Known) ? other.m_height : 0;
+	m_sizeState.store(state, std::memory_order_release);
+	return *this;
+}
+bool TextureInfo::IsSizeKnown() const { return m_sizeState.load(std::memory_order_acquire) == SizeState::Known; }
+TextureInfo::SizeState TextureInfo::GetSizeState() const { return m_sizeState.load(std::memory_order_acquire); }
+void TextureInfo::SetSize(uint32_t width, uint32_t height)
+{
+	m_width = width;
+	m_height = height;
+	m_sizeState.store(SizeState::Known, std::memory_order_release);
+}
+void TextureInfo::SetSizeUnavailable()
+{
+	m_width = 0;
+	m_height = 0;
+	m_sizeState.store(SizeState::Unavailable, std::memory_order_release);
+}
+bool TextureInfo::ResolveSize()
+{
+	auto state = m_sizeState.load(std::memory_order_acquire);
+	for(;;) {
+		switch(state) {
+		case SizeState::Known:
+			return true;
+		case SizeState::Unavailable:
+			return false;
+		case SizeState::Probing:
+			// Another thread is already reading the header
+			std::this_thread::yield();
+			state = m_sizeState.load(std::memory_order_acquire);
+			continue;
+		default:
+			break;
+		}
+		if(m_sizeState.compare_exchange_weak(state, SizeState::Probing, std::memory_order_acq_rel))
+			break;
+	}
+	uint32_t w = 0;
+	uint32_t h = 0;
+	auto r = !name.empty() && read_image_size(name, w, h);
+	m_width = r ? w : 0;
+	m_height = r ? h : 0;
+	m_sizeState.store(r ? SizeState::Known : SizeState::Unavailable, std::memory_order_release);
+	return r;
+}
+uint32_t TextureInfo::GetWidth() const
+{
+	const_cast<TextureInfo *>(this)->ResolveSize();
+	return m_width;
+}
+uint32_t TextureInfo::GetHeight() const
+{
+	const_cast<TextureInfo *>(this)->ResolveSize();
+	return m_height;
+}
+
+TextureInfo::SizeField::operator unsigned int() const { return m_height ? m_owner.GetHeight() : m_owner.GetWidth(); }
+TextureInfo::SizeField &TextureInfo::SizeField::operator=(unsigned int value)
+{
+	if(m_height)
+		m_owner.SetSize(m_owner.m_width, value);
+	else
+		m_owner.SetSize(value, m_owner.m_height);
+	return *this;
+}
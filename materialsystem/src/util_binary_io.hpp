@@ -0,0 +1,50 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef __MSYS_UTIL_BINARY_IO_HPP__
+#define __MSYS_UTIL_BINARY_IO_HPP__
+
+#include <mathutil/umath.h>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cinttypes>
+#include <limits>
+
+// Helpers for the binary cache files of the material system, which are read in one go and then parsed from memory
+namespace msys::binary_io {
+	template<typename T>
+	bool read_value(const std::vector<uint8_t> &data, size_t &offset, T &outValue)
+	{
+		if(offset + sizeof(T) > data.size())
+			return false;
+		std::memcpy(&outValue, data.data() + offset, sizeof(T));
+		offset += sizeof(T);
+		return true;
+	}
+	inline bool read_string(const std::vector<uint8_t> &data, size_t &offset, std::string &outValue)
+	{
+		uint16_t len;
+		if(!read_value(data, offset, len) || offset + len > data.size())
+			return false;
+		outValue.assign(reinterpret_cast<const char *>(data.data() + offset), len);
+		offset += len;
+		return true;
+	}
+	template<typename T>
+	void write_value(std::vector<uint8_t> &data, const T &value)
+	{
+		auto offset = data.size();
+		data.resize(offset + sizeof(T));
+		std::memcpy(data.data() + offset, &value, sizeof(T));
+	}
+	inline void write_string(std::vector<uint8_t> &data, const std::string &value)
+	{
+		auto len = static_cast<uint16_t>(umath::min(value.length(), static_cast<size_t>(std::numeric_limits<uint16_t>::max())));
+		write_value(data, len);
+		data.insert(data.end(), value.begin(), value.begin() + len);
+	}
+};
+
+#endif
@@ -0,0 +1,244 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+// Measures how long it takes to load binary pmat_b material files with msys::load_pmat_data, which builds the material
+// values directly from the typed UDM data. For comparison, the files are also loaded with the previous conversion, which
+// formatted every value as a string and parsed it again with ds::Block::AddValue, and with udm::Data::Load only, which is the
+// part of the load time that doesn't depend on the conversion.
+// Usage: bench_pmat_b_load [pmat_b files or directories...]
+// Directories are searched recursively for pmat_b files. If no paths are specified, NUM_GENERATED_MATERIALS materials are
+// generated in the "bench_pmat_b" directory first. The paths are relative to the program directory.
+
+#include "benchmark_util.hpp"
+#include <material_manager2.hpp>
+#include <material.h>
+#include <textureinfo.h>
+#include <datasystem.h>
+#include <fsys/filesystem.h>
+#include <fsys/ifile.hpp>
+#include <sharedutils/util_file.h>
+#include <sharedutils/util_string.h>
+#include <udm.hpp>
+#include <iostream>
+#include <iomanip>
+#include <functional>
+#include <cstdlib>
+#include <vector>
+#include <string>
+
+static constexpr uint32_t NUM_GENERATED_MATERIALS = 1'000;
+static constexpr auto GENERATED_MATERIAL_DIRECTORY = "bench_pmat_b/";
+
+static bool is_pmat_b_file(const std::string &path)
+{
+	std::string ext;
+	return ufile::get_extension(path, &ext) && ustring::compare(ext.c_str(), Material::FORMAT_MATERIAL_BINARY, false);
+}
+
+// Adds the path if it is a file, or all pmat_b files in it and its sub-directories if it is a directory
+static void collect_files(const std::string &path, std::vector<std::string> &outFiles)
+{
+	if(!FileManager::IsDir(path)) {
+		outFiles.push_back(path);
+		return;
+	}
+	std::vector<std::string> dirs {path + '/'};
+	while(!dirs.empty()) {
+		auto dir = std::move(dirs.back());
+		dirs.pop_back();
+		std::vector<std::string> files;
+		std::vector<std::string> subDirs;
+		FileManager::FindFiles((dir + '*').c_str(), &files, &subDirs);
+		for(auto &f : files) {
+			if(is_pmat_b_file(f))
+				outFiles.push_back(dir + f);
+		}
+		for(auto &subDir : subDirs) {
+			if(subDir == "." || subDir == "..")
+				continue;
+			dirs.push_back(dir + subDir + '/');
+		}
+	}
+}
+
+// Typical pbr materials, with a few textures and a mix of scalar and vector properties
+static bool generate_materials(msys::MaterialManager &manager, std::vector<std::string> &outFiles)
+{
+	FileManager::CreatePath(GENERATED_MATERIAL_DIRECTORY);
+	for(auto i = decltype(NUM_GENERATED_MATERIALS) {0u}; i < NUM_GENERATED_MATERIALS; ++i) {
+		auto dataSettings = manager.CreateDataSettings();
+		auto data = std::make_shared<ds::Block>(*dataSettings);
+		auto name = "material_" + std::to_string(i);
+		for(auto *key : {Material::ALBEDO_MAP_IDENTIFIER.c_str(), Material::NORMAL_MAP_IDENTIFIER.c_str(), Material::RMA_MAP_IDENTIFIER.c_str(), Material::EMISSION_MAP_IDENTIFIER.c_str()})
+			data->AddData(key, std::make_shared<ds::Texture>(*dataSettings, "bench/" + name + '_' + key));
+		data->AddValue("vector4", "color_factor", "1 0.5 0.25 1");
+		data->AddValue("vector", "emission_factor", "0.1 0.2 0.3");
+		data->AddValue("vector2", "uv_scale", "2 2");
+		data->AddValue("float", "metalness_factor", std::to_string((i % 10) / 10.f));
+		data->AddValue("float", "roughness_factor", "0.8");
+		data->AddValue("float", "alpha_cutoff", "0.5");
+		data->AddValue("int", "alpha_mode", "0");
+		data->AddValue("bool", "debug_mode", "0");
+		data->AddValue("string", "surface_material", "concrete");
+		auto mat = manager.CreateMaterial("pbr", data);
+		auto path = GENERATED_MATERIAL_DIRECTORY + name + '.' + Material::FORMAT_MATERIAL_BINARY;
+		std::string err;
+		if(!mat->Save(path, err, true)) {
+			std::cerr << "Unable to generate material '" << path << "': " << err << std::endl;
+			return false;
+		}
+		outFiles.push_back(std::move(path));
+	}
+	return true;
+}
+
+static std::unique_ptr<ufile::IFile> open_file(const std::string &path)
+{
+	auto f = filemanager::open_file(path, filemanager::FileMode::Read | filemanager::FileMode::Binary);
+	if(!f)
+		return nullptr;
+	return std::make_unique<fsys::File>(f);
+}
+
+static std::shared_ptr<udm::Data> load_udm(const std::string &path)
+{
+	auto f = open_file(path);
+	if(!f)
+		return nullptr;
+	try {
+		return udm::Data::Load(std::move(f));
+	}
+	catch(const udm::Exception &e) {
+		return nullptr;
+	}
+}
+
+// The conversion load_pmat_data used before the values were built from the typed UDM data
+static void udm_to_data_block_strings(udm::LinkedPropertyWrapper &udmDataRoot, ds::Block &root)
+{
+	std::function<void(const std::string &key, udm::LinkedPropertyWrapper &prop, ds::Block &block, bool texture)> udmToDataSys = nullptr;
+	udmToDataSys = [&udmToDataSys](const std::string &key, udm::LinkedPropertyWrapper &prop, ds::Block &block, bool texture) {
+		prop.InitializeProperty();
+		if(!prop.prop)
+			return;
+		switch(prop.prop->type) {
+		case udm::Type::String:
+			block.AddValue(texture ? "texture" : "string", key, prop.prop->ToValue<std::string>(""));
+			break;
+		case udm::Type::Int8:
+		case udm::Type::UInt8:
+		case udm::Type::Int16:
+		case udm::Type::UInt16:
+		case udm::Type::Int32:
+		case udm::Type::UInt32:
+		case udm::Type::Int64:
+		case udm::Type::UInt64:
+			block.AddValue("int", key, std::to_string(prop.prop->ToValue<int32_t>(0)));
+			break;
+		case udm::Type::Float:
+		case udm::Type::Double:
+			block.AddValue("float", key, std::to_string(prop.prop->ToValue<float>(0.f)));
+			break;
+		case udm::Type::Boolean:
+			block.AddValue("bool", key, std::to_string(prop.prop->ToValue<bool>(false)));
+			break;
+		case udm::Type::Vector2:
+			{
+				auto v = prop.prop->ToValue<Vector2>(Vector2 {});
+				block.AddValue("vector2", key, std::to_string(v.x) + ' ' + std::to_string(v.y));
+				break;
+			}
+		case udm::Type::Vector3:
+			{
+				auto v = prop.prop->ToValue<Vector3>(Vector3 {});
+				block.AddValue("vector", key, std::to_string(v.x) + ' ' + std::to_string(v.y) + ' ' + std::to_string(v.z));
+				break;
+			}
+		case udm::Type::Vector4:
+			{
+				auto v = prop.prop->ToValue<Vector4>(Vector4 {});
+				block.AddValue("vector4", key, std::to_string(v.x) + ' ' + std::to_string(v.y) + ' ' + std::to_string(v.z) + ' ' + std::to_string(v.w));
+				break;
+			}
+		case udm::Type::Element:
+			{
+				auto childBlock = block.AddBlock(key);
+				for(auto udmChild : prop.ElIt())
+					udmToDataSys(std::string {udmChild.key}, udmChild.property, *childBlock, texture);
+				break;
+			}
+		}
+	};
+	auto udmTextures = udmDataRoot["textures"];
+	for(auto udmTex : udmTextures.ElIt())
+		udmToDataSys(std::string {udmTex.key}, udmTex.property, root, true);
+
+	auto udmProps = udmDataRoot["properties"];
+	for(auto udmProp : udmProps.ElIt())
+		udmToDataSys(std::string {udmProp.key}, udmProp.property, root, false);
+}
+
+static bool load_pmat_data_strings(msys::MaterialManager &manager, const std::string &path)
+{
+	auto udmData = load_udm(path);
+	if(!udmData)
+		return false;
+	auto udmDataRoot = udmData->GetAssetData().GetData();
+	auto it = udmDataRoot.begin_el();
+	if(it == udmDataRoot.end_el())
+		return false;
+	auto &firstEl = *it;
+	auto root = std::make_shared<ds::Block>(*manager.CreateDataSettings());
+	udm_to_data_block_strings(firstEl.property, *root);
+	return true;
+}
+
+static bool load_pmat_data_typed(msys::MaterialManager &manager, const std::string &path)
+{
+	auto f = open_file(path);
+	if(!f)
+		return false;
+	std::string shader;
+	std::shared_ptr<ds::Block> data = nullptr;
+	return msys::load_pmat_data(manager, std::move(f), shader, data);
+}
+
+static uint32_t load_all(const std::vector<std::string> &files, const std::function<bool(const std::string &)> &load)
+{
+	uint32_t numLoaded = 0;
+	for(auto &f : files) {
+		if(load(f))
+			++numLoaded;
+	}
+	return numLoaded;
+}
+
+int main(int argc, char *argv[])
+{
+	auto manager = msys::MaterialManager::Create();
+	std::vector<std::string> files;
+	for(auto i = 1; i < argc; ++i)
+		collect_files(argv[i], files);
+	if(argc < 2 && !generate_materials(*manager, files))
+		return EXIT_FAILURE;
+
+	auto loadTyped = [&manager](const std::string &path) { return load_pmat_data_typed(*manager, path); };
+	auto numLoaded = load_all(files, loadTyped);
+	if(numLoaded == 0) {
+		std::cerr << "None of the files could be loaded!" << std::endl;
+		return EXIT_FAILURE;
+	}
+	std::cout << "Loading " << numLoaded << " of " << files.size() << " file(s)" << std::endl;
+
+	auto tUdm = msys::benchmark::to_milliseconds(msys::benchmark::measure([&files]() { load_all(files, [](const std::string &path) { return load_udm(path) != nullptr; }); }));
+	auto tStrings = msys::benchmark::to_milliseconds(msys::benchmark::measure([&files, &manager]() { load_all(files, [&manager](const std::string &path) { return load_pmat_data_strings(*manager, path); }); }));
+	auto tTyped = msys::benchmark::to_milliseconds(msys::benchmark::measure([&files, &loadTyped]() { load_all(files, loadTyped); }));
+
+	std::cout << std::setw(24) << "" << std::setw(12) << "ms" << std::setw(16) << "conversion ms" << std::endl;
+	std::cout << std::fixed << std::setprecision(2);
+	std::cout << std::setw(24) << "udm::Data::Load only" << std::setw(12) << tUdm << std::setw(16) << "-" << std::endl;
+	std::cout << std::setw(24) << "string round-trip" << std::setw(12) << tStrings << std::setw(16) << (tStrings - tUdm) << std::endl;
+	std::cout << std::setw(24) << "load_pmat_data (typed)" << std::setw(12) << tTyped << std::setw(16) << (tTyped - tUdm) << std::endl;
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,171 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+// Measures how texture decoding scales with the number of load threads of the legacy TextureManager (see
+// TextureManager::SetLoadThreadCount). The threads are set up the same way as TextureManager::TextureThread: every thread
+// pulls the next file from a shared queue and decodes it (DDS and KTX through gli, VTF through VTFLib, all other formats
+// through util_image).
+// Usage: bench_texture_decode_scaling <image files or directories...>
+// Directories are searched recursively for image files. The paths are relative to the program directory. Since the files are read from disk for every run, the first run also
+// includes the time it takes to load them into the file system cache, which is why only the fastest run is reported.
+
+#include "benchmark_util.hpp"
+#include <fsys/filesystem.h>
+#include <fsys/ifile.hpp>
+#include <sharedutils/util_file.h>
+#include <sharedutils/util_string.h>
+#include <util_image.hpp>
+#include <gli/gli.hpp>
+#ifndef DISABLE_VTF_SUPPORT
+#include <VTFFile.h>
+#endif
+#include <condition_variable>
+#include <iostream>
+#include <iomanip>
+#include <optional>
+#include <cstdlib>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <queue>
+#include <algorithm>
+#include <vector>
+#include <string>
+
+static std::string get_lower_extension(const std::string &path)
+{
+	std::string ext;
+	ufile::get_extension(path, &ext);
+	ustring::to_lower(ext);
+	return ext;
+}
+
+static bool is_image_file(const std::string &path)
+{
+	static const std::vector<std::string> extensions {"dds", "ktx", "png", "tga", "jpg", "jpeg", "bmp", "hdr",
+#ifndef DISABLE_VTF_SUPPORT
+	  "vtf"
+#endif
+	};
+	return std::find(extensions.begin(), extensions.end(), get_lower_extension(path)) != extensions.end();
+}
+
+// Adds the path if it is a file, or all image files in it and its sub-directories if it is a directory
+static void collect_files(const std::string &path, std::vector<std::string> &outFiles)
+{
+	if(!FileManager::IsDir(path)) {
+		outFiles.push_back(path);
+		return;
+	}
+	std::vector<std::string> dirs {path + '/'};
+	while(!dirs.empty()) {
+		auto dir = std::move(dirs.back());
+		dirs.pop_back();
+		std::vector<std::string> files;
+		std::vector<std::string> subDirs;
+		FileManager::FindFiles((dir + '*').c_str(), &files, &subDirs);
+		for(auto &f : files) {
+			if(is_image_file(f))
+				outFiles.push_back(dir + f);
+		}
+		for(auto &subDir : subDirs) {
+			if(subDir == "." || subDir == "..")
+				continue;
+			dirs.push_back(dir + subDir + '/');
+		}
+	}
+}
+
+static bool read_file(const std::string &path, std::vector<uint8_t> &outData)
+{
+	auto f = filemanager::open_file(path.c_str(), filemanager::FileMode::Read | filemanager::FileMode::Binary);
+	if(f == nullptr)
+		return false;
+	outData.resize(f->GetSize());
+	return f->Read(outData.data(), outData.size()) == outData.size();
+}
+
+static bool decode(const std::string &path)
+{
+	auto ext = get_lower_extension(path);
+	if(ext == "dds" || ext == "ktx") {
+		std::vector<uint8_t> data;
+		if(!read_file(path, data))
+			return false;
+		return !gli::load(static_cast<char *>(static_cast<void *>(data.data())), data.size()).empty();
+	}
+#ifndef DISABLE_VTF_SUPPORT
+	if(ext == "vtf") {
+		std::vector<uint8_t> data;
+		if(!read_file(path, data))
+			return false;
+		VTFLib::CVTFFile vtf {};
+		return vtf.Load(data.data(), static_cast<vlUInt>(data.size()), false);
+	}
+#endif
+	return uimg::load_image(path.c_str()) != nullptr;
+}
+
+static uint32_t decode_all(const std::vector<std::string> &files, uint32_t numThreads)
+{
+	std::mutex queueMutex;
+	std::queue<const std::string *> queue;
+	for(auto &f : files)
+		queue.push(&f);
+	std::atomic<uint32_t> numDecoded = 0;
+	std::vector<std::thread> threads;
+	threads.reserve(numThreads);
+	for(auto i = decltype(numThreads) {0u}; i < numThreads; ++i) {
+		threads.push_back(std::thread {[&]() {
+			for(;;) {
+				const std::string *path;
+				{
+					std::scoped_lock lock {queueMutex};
+					if(queue.empty())
+						break;
+					path = queue.front();
+					queue.pop();
+				}
+				if(decode(*path))
+					++numDecoded;
+			}
+		}});
+	}
+	for(auto &t : threads)
+		t.join();
+	return numDecoded;
+}
+
+int main(int argc, char *argv[])
+{
+	std::vector<std::string> files;
+	for(auto i = 1; i < argc; ++i)
+		collect_files(argv[i], files);
+	if(files.empty()) {
+		std::cerr << "Usage: " << argv[0] << " <image files or directories...>" << std::endl;
+		return EXIT_FAILURE;
+	}
+	auto numDecoded = decode_all(files, 1);
+	if(numDecoded == 0) {
+		std::cerr << "None of the files could be decoded!" << std::endl;
+		return EXIT_FAILURE;
+	}
+	std::cout << "Decoding " << numDecoded << " of " << files.size() << " file(s)" << std::endl;
+
+	auto maxThreads = std::max(std::thread::hardware_concurrency(), 1u);
+	std::vector<uint32_t> threadCounts;
+	for(uint32_t n = 1; n < maxThreads; n *= 2)
+		threadCounts.push_back(n);
+	threadCounts.push_back(maxThreads);
+
+	std::optional<double> tSingle {};
+	std::cout << std::setw(8) << "threads" << std::setw(12) << "ms" << std::setw(12) << "speedup" << std::endl;
+	for(auto numThreads : threadCounts) {
+		auto t = msys::benchmark::to_milliseconds(msys::benchmark::measure([&files, numThreads]() { decode_all(files, numThreads); }));
+		if(!tSingle.has_value())
+			tSingle = t;
+		std::cout << std::setw(8) << numThreads << std::setw(12) << std::fixed << std::setprecision(2) << t << std::setw(11) << (*tSingle / t) << "x" << std::endl;
+	}
+	return EXIT_SUCCESS;
+}
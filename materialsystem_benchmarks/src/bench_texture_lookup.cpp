@@ -0,0 +1,93 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+// Measures the cost of a texture lookup of the legacy TextureManager for a growing number of textures. The lookups go
+// through msys::TextureIndex, which backs TextureManager::FindTexture (by name) and TextureManager::GetTexture (by path).
+// For comparison, the linear search that GetTexture used before the index existed is measured as well.
+// Usage: bench_texture_lookup
+
+#include "benchmark_util.hpp"
+#include <texturemanager/texture_index.hpp>
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <cstdlib>
+#include <vector>
+#include <string>
+
+static constexpr uint32_t NUM_LOOKUPS = 10'000;
+// The linear search is too slow to be run NUM_LOOKUPS times for large texture counts
+static constexpr uint32_t NUM_LINEAR_LOOKUPS = 100;
+
+static std::vector<std::string> generate_names(uint32_t count)
+{
+	std::vector<std::string> names;
+	names.reserve(count);
+	for(auto i = decltype(count) {0u}; i < count; ++i)
+		names.push_back("models\\props_" + std::to_string(i % 64) + "\\texture_" + std::to_string(i));
+	return names;
+}
+
+static const std::string *find_linear(const std::vector<std::string> &names, const std::string &name, const std::vector<std::string> &extensions)
+{
+	auto nameNoExt = name;
+	ufile::remove_extension_from_filename(nameNoExt, extensions);
+	for(auto &other : names) {
+		auto otherNoExt = other;
+		ufile::remove_extension_from_filename(otherNoExt, extensions);
+		if(FileManager::ComparePath(nameNoExt, otherNoExt))
+			return &other;
+	}
+	return nullptr;
+}
+
+static double to_nanoseconds_per_lookup(std::chrono::nanoseconds t, uint32_t numLookups) { return static_cast<double>(t.count()) / numLookups; }
+
+int main(int argc, char *argv[])
+{
+	std::vector<std::string> extensions;
+	for(auto &format : MaterialManager::get_supported_image_formats())
+		extensions.push_back(format.extension);
+
+	std::cout << std::setw(10) << "textures" << std::setw(16) << "by name (ns)" << std::setw(16) << "by path (ns)" << std::setw(16) << "linear (ns)" << std::endl;
+	std::mt19937 rng {0};
+	auto sink = 0ull;
+	for(auto numTextures : {1'000u, 4'000u, 16'000u, 64'000u}) {
+		auto names = generate_names(numTextures);
+		msys::TextureIndex index {};
+		for(auto i = decltype(names.size()) {0u}; i < names.size(); ++i)
+			index.Add(names[i], i);
+
+		// Look up random textures, as material loading would. GetTexture is usually called with an extension.
+		std::uniform_int_distribution<size_t> dist {0, names.size() - 1};
+		std::vector<std::string> lookupNames;
+		std::vector<std::string> lookupPaths;
+		lookupNames.reserve(NUM_LOOKUPS);
+		lookupPaths.reserve(NUM_LOOKUPS);
+		for(auto i = decltype(NUM_LOOKUPS) {0u}; i < NUM_LOOKUPS; ++i) {
+			auto &name = names[dist(rng)];
+			lookupNames.push_back(name);
+			lookupPaths.push_back(name + ".dds");
+		}
+
+		auto tByName = msys::benchmark::measure([&]() {
+			for(auto &name : lookupNames)
+				sink += index.Find(name).value_or(0);
+		});
+		auto tByPath = msys::benchmark::measure([&]() {
+			for(auto &path : lookupPaths)
+				sink += index.FindByPath(path).value_or(0);
+		});
+		auto tLinear = msys::benchmark::measure(
+		  [&]() {
+			  for(auto i = decltype(NUM_LINEAR_LOOKUPS) {0u}; i < NUM_LINEAR_LOOKUPS; ++i)
+				  sink += (find_linear(names, lookupPaths[i], extensions) != nullptr) ? 1 : 0;
+		  },
+		  1);
+		std::cout << std::setw(10) << numTextures << std::fixed << std::setprecision(1) << std::setw(16) << to_nanoseconds_per_lookup(tByName, NUM_LOOKUPS) << std::setw(16) << to_nanoseconds_per_lookup(tByPath, NUM_LOOKUPS) << std::setw(16)
+		          << to_nanoseconds_per_lookup(tLinear, NUM_LINEAR_LOOKUPS) << std::endl;
+	}
+	// Keeps the lookups from being optimized away
+	return (sink == 0) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,29 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef __MSYS_BENCHMARK_UTIL_HPP__
+#define __MSYS_BENCHMARK_UTIL_HPP__
+
+#include <chrono>
+#include <algorithm>
+#include <functional>
+#include <cinttypes>
+
+namespace msys::benchmark {
+	// Runs the function the specified number of times and returns the fastest run, which is the least affected by
+	// other processes and by caches that haven't been warmed up yet
+	inline std::chrono::nanoseconds measure(const std::function<void()> &f, uint32_t numRuns = 5)
+	{
+		auto best = std::chrono::nanoseconds::max();
+		for(auto i = decltype(numRuns) {0u}; i < numRuns; ++i) {
+			auto t = std::chrono::steady_clock::now();
+			f();
+			best = std::min(best, std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t));
+		}
+		return best;
+	}
+	inline double to_milliseconds(std::chrono::nanoseconds t) { return std::chrono::duration<double, std::milli> {t}.count(); }
+};
+
+#endif
@@ -0,0 +1,296 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+// Offline importer, which converts all VMT/VMAT files of a directory tree to native materials in parallel.
+// Only the CPU conversion paths of the material system are used, so no GPU is required. Conversions that depend on
+// shaders (e.g. self-shadowing bump maps to normal maps) are not available here; materials that require them have to
+// be imported by the client instead.
+
+#include <material_manager2.hpp>
+#include <source_vmt_format_handler.hpp>
+#include <source2_vmat_format_handler.hpp>
+#include <import_cache.hpp>
+#include <fsys/filesystem.h>
+#include <fsys/ifile.hpp>
+#include <sharedutils/util_string.h>
+#include <filesystem>
+#include <algorithm>
+#include <cstdlib>
+#include <array>
+#include <optional>
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <vector>
+#include <string>
+
+namespace {
+	struct Options {
+		std::string sourceDirectory;
+		// Relative to the program directory
+		std::optional<std::string> outputDirectory {};
+		uint32_t threadCount = 0;
+		bool binary = true;
+		bool force = false;
+	};
+
+	enum class SourceFormat : uint8_t { Vmt = 0, Vmat, Count };
+	constexpr std::array<const char *, static_cast<size_t>(SourceFormat::Count)> SOURCE_FORMAT_EXTENSIONS {"vmt", "vmat_c"};
+
+	struct Job {
+		std::filesystem::path sourcePath;
+		// Relative to the program directory, without extension
+		std::string outputPath;
+		SourceFormat format;
+	};
+
+	enum class Result : uint8_t { Converted = 0, Failed };
+
+	using Clock = std::chrono::steady_clock;
+	struct Stats {
+		uint32_t converted = 0;
+		uint32_t skipped = 0;
+		uint32_t failed = 0;
+		// Time spent on the imports of each source format, summed over all threads
+		std::array<Clock::duration, static_cast<size_t>(SourceFormat::Count)> importTime {};
+		std::array<uint32_t, static_cast<size_t>(SourceFormat::Count)> importCount {};
+		std::vector<std::pair<std::string, std::string>> errors;
+	};
+};
+
+static void print_usage()
+{
+	std::cout << "Usage: materialsystem_import <source directory> [options]\n"
+	          << "Converts all VMT and VMAT files of the source directory (recursively) to native materials.\n\n"
+	          << "Options:\n"
+	          << "  -o, --output <dir>   Output directory, relative to the program directory (default: the import directory of the material system)\n"
+	          << "  -j, --threads <n>    Number of worker threads (default: number of hardware threads)\n"
+	          << "  --ascii              Write ASCII materials (pmat) instead of binary materials (pmat_b)\n"
+	          << "  -f, --force          Convert all files, even if the output is newer than the source file\n";
+}
+
+static std::optional<Options> parse_options(int argc, char *argv[])
+{
+	Options options {};
+	for(auto i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		auto hasValue = (i + 1 < argc);
+		if((arg == "-o" || arg == "--output") && hasValue)
+			options.outputDirectory = argv[++i];
+		else if((arg == "-j" || arg == "--threads") && hasValue)
+			options.threadCount = ustring::to_int(argv[++i]);
+		else if(arg == "--ascii")
+			options.binary = false;
+		else if(arg == "-f" || arg == "--force")
+			options.force = true;
+		else if(!arg.empty() && arg.front() != '-' && options.sourceDirectory.empty())
+			options.sourceDirectory = arg;
+		else
+			return {};
+	}
+	if(options.sourceDirectory.empty())
+		return {};
+	return options;
+}
+
+static std::vector<Job> collect_jobs(const std::filesystem::path &sourceDirectory, const std::string &outputDirectory)
+{
+	std::vector<Job> jobs;
+	std::error_code ec;
+	std::filesystem::recursive_directory_iterator it {sourceDirectory, std::filesystem::directory_options::skip_permission_denied, ec};
+	for(; !ec && it != std::filesystem::recursive_directory_iterator {}; it.increment(ec)) {
+		std::error_code ecEntry;
+		if(!it->is_regular_file(ecEntry))
+			continue;
+		auto ext = it->path().extension().string();
+		if(!ext.empty())
+			ext.erase(ext.begin());
+		auto itFormat = std::find_if(SOURCE_FORMAT_EXTENSIONS.begin(), SOURCE_FORMAT_EXTENSIONS.end(), [&ext](const char *formatExt) { return ustring::compare(ext.c_str(), formatExt, false); });
+		if(itFormat == SOURCE_FORMAT_EXTENSIONS.end())
+			continue;
+		auto relPath = it->path().lexically_relative(sourceDirectory);
+		relPath.replace_extension();
+		Job job {};
+		job.sourcePath = it->path();
+		job.outputPath = outputDirectory + '/' + relPath.generic_string();
+		job.format = static_cast<SourceFormat>(itFormat - SOURCE_FORMAT_EXTENSIONS.begin());
+		jobs.push_back(std::move(job));
+	}
+	return jobs;
+}
+
+static bool is_up_to_date(const Job &job, const std::string &ext)
+{
+	std::string absOutputPath;
+	if(!FileManager::FindAbsolutePath(job.outputPath + '.' + ext, absOutputPath))
+		return false;
+	std::error_code ec;
+	auto tOutput = std::filesystem::last_write_time(absOutputPath, ec);
+	if(ec)
+		return false;
+	auto tSource = std::filesystem::last_write_time(job.sourcePath, ec);
+	return !ec && tOutput >= tSource;
+}
+
+static Result import_material(msys::MaterialManager &matManager, const Job &job, std::string &outErr)
+{
+	std::unique_ptr<util::IImportAssetFormatHandler> handler = nullptr;
+	switch(job.format) {
+#ifndef DISABLE_VMT_SUPPORT
+	case SourceFormat::Vmt:
+		handler = std::make_unique<msys::SourceVmtFormatHandler>(matManager);
+		break;
+#endif
+#ifndef DISABLE_VMAT_SUPPORT
+	case SourceFormat::Vmat:
+		handler = std::make_unique<msys::Source2VmatFormatHandler>(matManager);
+		break;
+#endif
+	default:
+		break;
+	}
+	if(!handler) {
+		outErr = "Format is not supported by this build";
+		return Result::Failed;
+	}
+	auto f = FileManager::OpenSystemFile(job.sourcePath.string().c_str(), "rb");
+	if(f == nullptr) {
+		outErr = "Unable to open file";
+		return Result::Failed;
+	}
+	handler->SetFile(std::make_unique<fsys::File>(f));
+	std::string outFilePath;
+	if(!handler->Import(job.outputPath, outFilePath)) {
+		outErr = handler->GetErrorMessage();
+		if(outErr.empty())
+			outErr = "Import failed";
+		return Result::Failed;
+	}
+	return Result::Converted;
+}
+
+static double to_seconds(Clock::duration d) { return std::chrono::duration<double>(d).count(); }
+
+int main(int argc, char *argv[])
+{
+	auto options = parse_options(argc, argv);
+	if(!options) {
+		print_usage();
+		return EXIT_FAILURE;
+	}
+	std::error_code ec;
+	auto sourceDirectory = std::filesystem::absolute(options->sourceDirectory, ec);
+	if(ec || !std::filesystem::is_directory(sourceDirectory, ec)) {
+		std::cerr << "Source directory '" << options->sourceDirectory << "' does not exist." << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	auto matManager = msys::MaterialManager::Create();
+	matManager->SetImportFormat(options->binary ? util::AssetFormatType::Binary : util::AssetFormatType::Text);
+	auto ext = matManager->GetImportFileExtension();
+	auto outputDirectory = options->outputDirectory.has_value() ? *options->outputDirectory : matManager->GetImportDirectory().GetString();
+
+	// Stage 1: Collect the source files
+	auto tStart = Clock::now();
+	auto jobs = collect_jobs(sourceDirectory, outputDirectory);
+	auto tScan = Clock::now() - tStart;
+
+	// Stage 2: Import them in parallel. Every worker pulls the next job from a shared counter, so
+	// expensive materials don't hold up the jobs behind them.
+	auto threadCount = options->threadCount;
+	if(threadCount == 0)
+		threadCount = umath::max(std::thread::hardware_concurrency(), 1u);
+	threadCount = umath::min(threadCount, umath::max(static_cast<uint32_t>(jobs.size()), 1u));
+
+	// Material managers are not thread-safe, so every worker imports through its own manager. They're created here,
+	// since their construction initializes the shared caches of the material system.
+	std::vector<std::shared_ptr<msys::MaterialManager>> workerMatManagers;
+	workerMatManagers.reserve(threadCount);
+	workerMatManagers.push_back(matManager);
+	while(workerMatManagers.size() < threadCount) {
+		auto workerMatManager = msys::MaterialManager::Create();
+		workerMatManager->SetImportFormat(matManager->GetImportFormat());
+		workerMatManagers.push_back(workerMatManager);
+	}
+
+	tStart = Clock::now();
+	Stats stats {};
+	std::mutex statsMutex;
+	std::atomic<size_t> nextJob = 0;
+	std::atomic<size_t> numCompleted = 0;
+	std::vector<std::thread> threads;
+	threads.reserve(threadCount);
+	for(auto i = decltype(threadCount) {0u}; i < threadCount; ++i) {
+		threads.push_back(std::thread {[&, i]() {
+			auto &workerMatManager = *workerMatManagers[i];
+			Stats localStats {};
+			for(auto jobIdx = nextJob++; jobIdx < jobs.size(); jobIdx = nextJob++) {
+				auto &job = jobs[jobIdx];
+				auto formatIdx = static_cast<size_t>(job.format);
+				if(!options->force && is_up_to_date(job, ext)) {
+					++localStats.skipped;
+					++numCompleted;
+					continue;
+				}
+				std::string err;
+				auto t = Clock::now();
+				auto result = import_material(workerMatManager, job, err);
+				localStats.importTime[formatIdx] += Clock::now() - t;
+				++localStats.importCount[formatIdx];
+				if(result == Result::Converted)
+					++localStats.converted;
+				else {
+					++localStats.failed;
+					localStats.errors.push_back({job.sourcePath.generic_string(), std::move(err)});
+				}
+				++numCompleted;
+			}
+
+			std::scoped_lock lock {statsMutex};
+			stats.converted += localStats.converted;
+			stats.skipped += localStats.skipped;
+			stats.failed += localStats.failed;
+			for(size_t j = 0; j < stats.importTime.size(); ++j) {
+				stats.importTime[j] += localStats.importTime[j];
+				stats.importCount[j] += localStats.importCount[j];
+			}
+			stats.errors.insert(stats.errors.end(), std::make_move_iterator(localStats.errors.begin()), std::make_move_iterator(localStats.errors.end()));
+		}});
+	}
+	while(numCompleted < jobs.size()) {
+		std::this_thread::sleep_for(std::chrono::milliseconds {500});
+		std::cout << "\rImporting... " << numCompleted << "/" << jobs.size() << std::flush;
+	}
+	for(auto &thread : threads)
+		thread.join();
+	auto tImport = Clock::now() - tStart;
+	if(!jobs.empty())
+		std::cout << "\r";
+
+	// Stage 3: Persist the import cache, so unchanged files can be skipped by the next run (or the client)
+	tStart = Clock::now();
+	auto &importCache = msys::get_import_cache();
+	if(importCache.IsDirty())
+		importCache.Save(msys::get_import_cache_path());
+	auto tCache = Clock::now() - tStart;
+
+	for(auto &[path, err] : stats.errors)
+		std::cerr << "Failed to import '" << path << "': " << err << std::endl;
+
+	std::cout << std::fixed << std::setprecision(2);
+	std::cout << "Converted: " << stats.converted << ", skipped: " << stats.skipped << ", failed: " << stats.failed << " (" << jobs.size() << " files, output: " << outputDirectory << ", format: " << ext << ")" << std::endl;
+	std::cout << "Scan: " << to_seconds(tScan) << "s" << std::endl;
+	std::cout << "Import: " << to_seconds(tImport) << "s on " << threadCount << " thread(s)" << std::endl;
+	for(size_t i = 0; i < stats.importTime.size(); ++i) {
+		if(stats.importCount[i] == 0)
+			continue;
+		auto t = to_seconds(stats.importTime[i]);
+		std::cout << "  " << SOURCE_FORMAT_EXTENSIONS[i] << ": " << stats.importCount[i] << " file(s), " << t << "s total, " << (t / stats.importCount[i]) * 1'000.0 << "ms per file" << std::endl;
+	}
+	std::cout << "Import cache: " << to_seconds(tCache) << "s" << std::endl;
+	return (stats.failed > 0) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,134 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "test_util.hpp"
+#include <import_cache.hpp>
+#include <fsys/filesystem.h>
+#include <filesystem>
+#include <string>
+
+static const std::string TEST_DIRECTORY = "cache/tests/import_cache/";
+
+static bool write_file(const std::string &filePath, const std::string &contents)
+{
+	FileManager::CreatePath(TEST_DIRECTORY.c_str());
+	auto f = FileManager::OpenFile<VFilePtrReal>(filePath.c_str(), "wb");
+	if(f == nullptr)
+		return false;
+	return f->Write(contents.data(), contents.size()) == contents.size();
+}
+static void remove_file(const std::string &filePath) { std::filesystem::remove(FileManager::GetProgramPath() + '/' + filePath); }
+
+static void test_keys()
+{
+	std::string data = "source";
+	auto key = msys::ImportCache::ComputeKey(data.data(), data.size(), "converter");
+	MSYS_EXPECT(key == msys::ImportCache::ComputeKey(data.data(), data.size(), "converter"));
+	// Settings that affect the output are part of the converter name, see CMaterialManager::GetDerivedTextureKey
+	MSYS_EXPECT(key != msys::ImportCache::ComputeKey(data.data(), data.size(), "converter_downscale_512x512"));
+	std::string other = "other";
+	MSYS_EXPECT(key != msys::ImportCache::ComputeKey(other.data(), other.size(), "converter"));
+
+	auto str = msys::ImportCache::KeyToString(key);
+	MSYS_EXPECT(str.length() == 16);
+	MSYS_EXPECT(str.find_first_not_of("0123456789abcdef") == std::string::npos);
+	MSYS_EXPECT(str != msys::ImportCache::KeyToString(key + 1));
+	MSYS_EXPECT(msys::ImportCache::KeyToString(0x0123'4567'89ab'cdefull) == "0123456789abcdef");
+}
+
+static void test_cache_path()
+{
+	// The cache must not be written into the material directory, which may be watched for changes
+	MSYS_EXPECT(msys::get_import_cache_path().rfind("cache/", 0) == 0);
+}
+
+static void test_verification()
+{
+	auto filePath = TEST_DIRECTORY + "output.dds";
+	MSYS_EXPECT(write_file(filePath, "generated"));
+
+	msys::ImportCache cache {};
+	constexpr uint64_t key = 1;
+	MSYS_EXPECT(cache.Store(key, {{"output"}, {filePath}}));
+	auto entry = cache.Find(key);
+	MSYS_EXPECT(entry.has_value());
+	if(entry.has_value()) {
+		MSYS_EXPECT(entry->assets.size() == 1 && entry->assets.front() == "output");
+		MSYS_EXPECT(entry->fileHashes.size() == 1);
+	}
+	MSYS_EXPECT(!cache.Find(key + 1).has_value());
+
+	// Modified outputs invalidate the entry
+	MSYS_EXPECT(write_file(filePath, "modified"));
+	MSYS_EXPECT(!cache.Find(key).has_value());
+
+	// Removed outputs invalidate the entry
+	MSYS_EXPECT(cache.Store(key, {{"output"}, {filePath}}));
+	MSYS_EXPECT(cache.Find(key).has_value());
+	remove_file(filePath);
+	MSYS_EXPECT(!cache.Find(key).has_value());
+
+	// Entries can't be stored for files that don't exist
+	MSYS_EXPECT(!cache.Store(key, {{"output"}, {filePath}}));
+	MSYS_EXPECT(cache.GetEntryCount() == 1);
+}
+
+static void test_save_load()
+{
+	auto filePath = TEST_DIRECTORY + "saved.dds";
+	auto cacheFilePath = TEST_DIRECTORY + msys::ImportCache::FILE_NAME;
+	MSYS_EXPECT(write_file(filePath, "generated"));
+
+	constexpr uint64_t key = 2;
+	{
+		msys::ImportCache cache {};
+		MSYS_EXPECT(cache.Store(key, {{"saved"}, {filePath}}));
+		MSYS_EXPECT(cache.IsDirty());
+		MSYS_EXPECT(cache.Save(cacheFilePath));
+		MSYS_EXPECT(!cache.IsDirty());
+	}
+
+	msys::ImportCache cache {};
+	MSYS_EXPECT(cache.Load(cacheFilePath));
+	MSYS_EXPECT(cache.GetEntryCount() == 1);
+	MSYS_EXPECT(cache.Find(key).has_value());
+
+	// The stored hashes have to survive the round trip
+	MSYS_EXPECT(write_file(filePath, "modified"));
+	MSYS_EXPECT(!cache.Find(key).has_value());
+
+	remove_file(filePath);
+	remove_file(cacheFilePath);
+}
+
+static void test_restore()
+{
+	auto filePath = TEST_DIRECTORY + "primary.pmat";
+	auto copyFilePath = TEST_DIRECTORY + "copy.pmat";
+	MSYS_EXPECT(write_file(filePath, "material"));
+
+	msys::ImportCache cache {};
+	constexpr uint64_t key = 3;
+	MSYS_EXPECT(cache.Store(key, {{}, {filePath}}));
+	MSYS_EXPECT(cache.Restore(key, filePath));
+	MSYS_EXPECT(cache.Restore(key, copyFilePath));
+	MSYS_EXPECT(FileManager::Exists(copyFilePath));
+	MSYS_EXPECT(!cache.Restore(key + 1, copyFilePath));
+
+	MSYS_EXPECT(write_file(filePath, "modified"));
+	MSYS_EXPECT(!cache.Restore(key, copyFilePath));
+
+	remove_file(filePath);
+	remove_file(copyFilePath);
+}
+
+int main(int argc, char *argv[])
+{
+	test_keys();
+	test_cache_path();
+	test_verification();
+	test_save_load();
+	test_restore();
+	return msys::test::get_exit_code();
+}
@@ -0,0 +1,91 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "test_util.hpp"
+#include <material_manager2.hpp>
+#include <material.h>
+#include <textureinfo.h>
+#include <datasystem.h>
+#include <string>
+
+static std::shared_ptr<Material> create_material(msys::MaterialManager &manager)
+{
+	auto data = std::make_shared<ds::Block>(*manager.CreateDataSettings());
+	data->AddValue("vector4", "color_factor", "1 1 1 1");
+	data->AddValue("float", "alpha_cutoff", "0.5");
+	data->AddData(Material::ALBEDO_MAP_IDENTIFIER, std::make_shared<ds::Texture>(*manager.CreateDataSettings(), "tests/albedo"));
+	return manager.CreateMaterial("pbr", data);
+}
+
+static void test_shared_until_modified()
+{
+	auto manager = msys::MaterialManager::Create();
+	auto mat = create_material(*manager);
+	auto copy = mat->Copy();
+	MSYS_EXPECT(copy != nullptr);
+	if(!copy)
+		return;
+	MSYS_EXPECT(copy->GetDataBlock() == mat->GetDataBlock());
+	MSYS_EXPECT(mat->IsDataBlockShared() && copy->IsDataBlockShared());
+	MSYS_EXPECT(copy->GetShaderIdentifier() == mat->GetShaderIdentifier());
+	MSYS_EXPECT(copy->GetColorFactor() == mat->GetColorFactor());
+}
+
+static void test_modified_copy()
+{
+	auto manager = msys::MaterialManager::Create();
+	auto mat = create_material(*manager);
+	auto copy = mat->Copy();
+	if(!copy)
+		return;
+	auto originalData = mat->GetDataBlock();
+
+	// Through a setter
+	copy->SetColorFactor({0.f, 0.5f, 1.f, 1.f});
+	MSYS_EXPECT(copy->GetDataBlock() != originalData);
+	MSYS_EXPECT(copy->GetColorFactor() == Vector4(0.f, 0.5f, 1.f, 1.f));
+	MSYS_EXPECT(mat->GetColorFactor() == Vector4(1.f, 1.f, 1.f, 1.f));
+	MSYS_EXPECT(mat->GetDataBlock() == originalData);
+
+	// Through the mutable data block
+	copy->GetMutableDataBlock()->AddValue("float", "alpha_cutoff", "0.25");
+	copy->GetMutableDataBlock()->AddValue("bool", "copy_only", "1");
+	MSYS_EXPECT(copy->GetAlphaCutoff() == 0.25f);
+	MSYS_EXPECT(mat->GetAlphaCutoff() == 0.5f);
+	MSYS_EXPECT(copy->GetDataBlock()->GetValue("copy_only") != nullptr);
+	MSYS_EXPECT(mat->GetDataBlock()->GetValue("copy_only") == nullptr);
+
+	// Textures are copied along with the block, so loading a texture into the copy doesn't affect the original
+	auto *copyTexInfo = copy->GetTextureInfo(Material::ALBEDO_MAP_IDENTIFIER);
+	auto *texInfo = mat->GetTextureInfo(Material::ALBEDO_MAP_IDENTIFIER);
+	MSYS_EXPECT(copyTexInfo != nullptr && texInfo != nullptr && copyTexInfo != texInfo);
+	if(copyTexInfo && texInfo) {
+		copyTexInfo->texture = std::make_shared<int>(0);
+		MSYS_EXPECT(texInfo->texture == nullptr);
+	}
+}
+
+static void test_modified_original()
+{
+	auto manager = msys::MaterialManager::Create();
+	auto mat = create_material(*manager);
+	auto copy = mat->Copy();
+	if(!copy)
+		return;
+	auto copyData = copy->GetDataBlock();
+	mat->SetColorFactor({0.f, 0.f, 0.f, 1.f});
+	MSYS_EXPECT(copy->GetDataBlock() == copyData);
+	MSYS_EXPECT(copy->GetColorFactor() == Vector4(1.f, 1.f, 1.f, 1.f));
+	// The original has switched to its own block, so the copy doesn't have to copy its block anymore
+	copyData = nullptr;
+	MSYS_EXPECT(!copy->IsDataBlockShared());
+}
+
+int main(int argc, char *argv[])
+{
+	test_shared_until_modified();
+	test_modified_copy();
+	test_modified_original();
+	return msys::test::get_exit_code();
+}
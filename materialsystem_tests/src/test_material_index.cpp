@@ -0,0 +1,85 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "test_util.hpp"
+#include <material_manager2.hpp>
+#include <material.h>
+#include <datasystem.h>
+#include <unordered_set>
+#include <algorithm>
+#include <limits>
+#include <vector>
+#include <string>
+
+static constexpr uint32_t NUM_MATERIALS = 64;
+
+static std::shared_ptr<Material> create_material(msys::MaterialManager &manager)
+{
+	auto data = std::make_shared<ds::Block>(*manager.CreateDataSettings());
+	data->AddValue("vector4", "color_factor", "1 1 1 1");
+	return manager.CreateMaterial("pbr", data);
+}
+
+static void create_materials(msys::MaterialManager &manager, std::vector<std::shared_ptr<Material>> &outMaterials)
+{
+	for(auto i = decltype(NUM_MATERIALS) {0u}; i < NUM_MATERIALS; ++i)
+		outMaterials.push_back(create_material(manager));
+}
+
+static bool has_unique_indices(const std::vector<std::shared_ptr<Material>> &materials, uint32_t indexCount)
+{
+	std::unordered_set<MaterialIndex> indices;
+	for(auto &mat : materials) {
+		if(mat->GetIndex() >= indexCount || !indices.insert(mat->GetIndex()).second)
+			return false;
+	}
+	return true;
+}
+
+static void test_index_reuse()
+{
+	auto manager = msys::MaterialManager::Create();
+	std::vector<std::shared_ptr<Material>> materials;
+	create_materials(*manager, materials);
+	auto indexCount = manager->GetMaterialIndexCount();
+	MSYS_EXPECT(indexCount >= NUM_MATERIALS);
+	MSYS_EXPECT(has_unique_indices(materials, indexCount));
+
+	// Materials that are loaded and unloaded constantly must not make the index range grow
+	for(auto i = 0u; i < 16; ++i) {
+		materials.clear();
+		manager->ClearUnused();
+		create_materials(*manager, materials);
+		MSYS_EXPECT(manager->GetMaterialIndexCount() == indexCount);
+		MSYS_EXPECT(has_unique_indices(materials, indexCount));
+	}
+
+	// Freed indices are re-used lowest first
+	auto lowest = materials.front()->GetIndex();
+	for(auto &mat : materials)
+		lowest = std::min(lowest, mat->GetIndex());
+	materials.erase(std::remove_if(materials.begin(), materials.end(), [lowest](const std::shared_ptr<Material> &mat) { return mat->GetIndex() == lowest; }), materials.end());
+	manager->ClearUnused();
+	auto mat = create_material(*manager);
+	MSYS_EXPECT(mat->GetIndex() == lowest);
+	MSYS_EXPECT(manager->GetSortKeys().size() <= indexCount);
+}
+
+static void test_material_outlives_manager()
+{
+	auto manager = msys::MaterialManager::Create();
+	auto mat = create_material(*manager);
+	MSYS_EXPECT(mat->GetIndex() != std::numeric_limits<MaterialIndex>::max());
+	manager = nullptr;
+	// The material must not try to release its index with the destroyed manager
+	MSYS_EXPECT(mat->GetIndex() == std::numeric_limits<MaterialIndex>::max());
+	mat = nullptr;
+}
+
+int main(int argc, char *argv[])
+{
+	test_index_reuse();
+	test_material_outlives_manager();
+	return msys::test::get_exit_code();
+}
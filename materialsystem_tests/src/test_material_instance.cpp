@@ -0,0 +1,101 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "test_util.hpp"
+#include <material_manager2.hpp>
+#include <material_instance.hpp>
+#include <material.h>
+#include <textureinfo.h>
+#include <datasystem.h>
+#include <string>
+
+static std::shared_ptr<Material> create_material(msys::MaterialManager &manager, const std::string &colorFactor = "1 1 1 1")
+{
+	auto data = std::make_shared<ds::Block>(*manager.CreateDataSettings());
+	data->AddValue("vector4", "color_factor", colorFactor);
+	data->AddValue("float", "alpha_cutoff", "0.5");
+	data->AddData(Material::ALBEDO_MAP_IDENTIFIER, std::make_shared<ds::Texture>(*manager.CreateDataSettings(), "tests/albedo"));
+	data->AddData(Material::NORMAL_MAP_IDENTIFIER, std::make_shared<ds::Texture>(*manager.CreateDataSettings(), "tests/normal"));
+	return manager.CreateMaterial("pbr", data);
+}
+
+static const std::string &get_texture_name(const Material &mat, const std::string &key)
+{
+	static std::string empty;
+	auto *texInfo = mat.GetTextureInfo(key);
+	return texInfo ? texInfo->name : empty;
+}
+
+static void test_instance_of_textured_parent()
+{
+	auto manager = msys::MaterialManager::Create();
+	auto parent = create_material(*manager);
+	auto parentData = parent->GetDataBlock();
+	auto instance = manager->CreateMaterialInstance(*parent);
+	auto &mat = instance->GetMaterial();
+	MSYS_EXPECT(mat != nullptr);
+	if(!mat)
+		return;
+	MSYS_EXPECT(mat.get() != parent.get());
+	MSYS_EXPECT(mat->GetShaderIdentifier() == parent->GetShaderIdentifier());
+	// Without any overrides the block of the parent is shared
+	MSYS_EXPECT(mat->GetDataBlock() == parentData);
+	MSYS_EXPECT(get_texture_name(*mat, Material::ALBEDO_MAP_IDENTIFIER) == get_texture_name(*parent, Material::ALBEDO_MAP_IDENTIFIER));
+
+	instance->SetColorFactor({1.f, 0.f, 0.f, 1.f});
+	instance->SetTexture(Material::ALBEDO_MAP_IDENTIFIER, "tests/albedo_red");
+	MSYS_EXPECT(mat->GetDataBlock() != parentData);
+	MSYS_EXPECT(mat->GetColorFactor() == Vector4(1.f, 0.f, 0.f, 1.f));
+	MSYS_EXPECT(get_texture_name(*mat, Material::ALBEDO_MAP_IDENTIFIER) != get_texture_name(*parent, Material::ALBEDO_MAP_IDENTIFIER));
+	MSYS_EXPECT(get_texture_name(*mat, Material::NORMAL_MAP_IDENTIFIER) == get_texture_name(*parent, Material::NORMAL_MAP_IDENTIFIER));
+
+	// The parent is unaffected by the overrides
+	MSYS_EXPECT(parent->GetDataBlock() == parentData);
+	MSYS_EXPECT(parent->GetColorFactor() == Vector4(1.f, 1.f, 1.f, 1.f));
+	MSYS_EXPECT(get_texture_name(*parent, Material::ALBEDO_MAP_IDENTIFIER).find("albedo_red") == std::string::npos);
+
+	// Changes of the parent are picked up, the overrides are kept
+	parent->SetBloomColorFactor({0.f, 1.f, 0.f, 1.f});
+	instance->Update();
+	MSYS_EXPECT(parent->GetBloomColorFactor().has_value() && mat->GetBloomColorFactor() == parent->GetBloomColorFactor());
+	MSYS_EXPECT(mat->GetColorFactor() == Vector4(1.f, 0.f, 0.f, 1.f));
+	MSYS_EXPECT(get_texture_name(*mat, Material::ALBEDO_MAP_IDENTIFIER).find("albedo_red") != std::string::npos);
+
+	instance->ClearOverrides();
+	MSYS_EXPECT(mat->GetColorFactor() == parent->GetColorFactor());
+	MSYS_EXPECT(get_texture_name(*mat, Material::ALBEDO_MAP_IDENTIFIER) == get_texture_name(*parent, Material::ALBEDO_MAP_IDENTIFIER));
+}
+
+static void test_assign_changes_keeps_other()
+{
+	auto manager = msys::MaterialManager::Create();
+	auto mat = create_material(*manager);
+	auto *texInfo = mat->GetTextureInfo(Material::ALBEDO_MAP_IDENTIFIER);
+	MSYS_EXPECT(texInfo != nullptr);
+	if(!texInfo)
+		return;
+	auto texture = std::make_shared<int>(0);
+	texInfo->texture = texture;
+
+	// Same textures, different parameters, e.g. a reloaded material file
+	auto other = create_material(*manager, "0 0 0 1");
+	auto otherData = other->GetDataBlock();
+	auto changes = mat->AssignChanges(*other);
+	MSYS_EXPECT(changes == Material::ChangeFlags::ParametersBit);
+	MSYS_EXPECT(mat->GetColorFactor() == Vector4(0.f, 0.f, 0.f, 1.f));
+	// The loaded texture has been kept, but not written into the other material
+	texInfo = mat->GetTextureInfo(Material::ALBEDO_MAP_IDENTIFIER);
+	MSYS_EXPECT(texInfo != nullptr && texInfo->texture == texture);
+	auto *otherTexInfo = other->GetTextureInfo(Material::ALBEDO_MAP_IDENTIFIER);
+	MSYS_EXPECT(otherTexInfo != nullptr && otherTexInfo->texture == nullptr);
+	MSYS_EXPECT(other->GetDataBlock() == otherData);
+	MSYS_EXPECT(mat->GetDataBlock() != otherData);
+}
+
+int main(int argc, char *argv[])
+{
+	test_instance_of_textured_parent();
+	test_assign_changes_keeps_other();
+	return msys::test::get_exit_code();
+}
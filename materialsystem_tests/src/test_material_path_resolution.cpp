@@ -0,0 +1,87 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "test_util.hpp"
+#include <materialmanager.h>
+#include <material_manager2.hpp>
+#include <directory_index.hpp>
+#include <fsys/filesystem.h>
+#include <sharedutils/util_file.h>
+#include <filesystem>
+#include <string>
+
+static const std::string TEST_DIRECTORY = "tests/path_resolution/";
+
+static std::string get_absolute_path(const std::string &path) { return FileManager::GetProgramPath() + '/' + MaterialManager::GetRootMaterialLocation() + '/' + path; }
+static bool write_file(const std::string &path)
+{
+	auto filePath = MaterialManager::GetRootMaterialLocation() + '/' + path;
+	FileManager::CreatePath(ufile::get_path_from_filename(filePath).c_str());
+	auto f = FileManager::OpenFile<VFilePtrReal>(filePath.c_str(), "w");
+	if(f == nullptr)
+		return false;
+	f->WriteString("\"pbr\"\n{\n}\n");
+	return true;
+}
+
+static void test_directory_index_initialization()
+{
+	std::filesystem::remove_all(get_absolute_path(TEST_DIRECTORY));
+	MSYS_EXPECT(write_file(TEST_DIRECTORY + "existing.pmat"));
+	// The index is built when the first material manager is created, so files that were created in an earlier session are included
+	auto matManager = msys::MaterialManager::Create();
+	auto &dirIndex = msys::get_material_directory_index();
+	MSYS_EXPECT(dirIndex.IsActive());
+	MSYS_EXPECT(dirIndex.Exists(msys::DirectoryIndex::NormalizePath(TEST_DIRECTORY + "existing.pmat")));
+	MaterialManager manager {};
+	auto resolved = manager.ResolveMaterialPath(TEST_DIRECTORY + "existing");
+	MSYS_EXPECT(resolved->exists && resolved->extension == "pmat");
+	std::filesystem::remove_all(get_absolute_path(TEST_DIRECTORY));
+	msys::notify_material_file_removed(TEST_DIRECTORY + "existing.pmat");
+}
+
+static void test_invalidation()
+{
+	std::filesystem::remove_all(get_absolute_path(TEST_DIRECTORY));
+	MaterialManager manager {};
+	auto created = manager.ResolveMaterialPath(TEST_DIRECTORY + "created");
+	auto other = manager.ResolveMaterialPath(TEST_DIRECTORY + "other");
+	MSYS_EXPECT(!created->exists && !other->exists);
+	// Cache hits return the same result
+	MSYS_EXPECT(manager.ResolveMaterialPath(TEST_DIRECTORY + "created") == created);
+
+	MSYS_EXPECT(write_file(TEST_DIRECTORY + "created.pmat"));
+	msys::notify_material_file_created(TEST_DIRECTORY + "created.pmat");
+	auto resolved = manager.ResolveMaterialPath(TEST_DIRECTORY + "created");
+	MSYS_EXPECT(resolved != created && resolved->exists && resolved->extension == "pmat");
+	// The old result is unchanged
+	MSYS_EXPECT(!created->exists);
+	// Names of other materials are still cached
+	MSYS_EXPECT(manager.ResolveMaterialPath(TEST_DIRECTORY + "other") == other);
+
+	std::filesystem::remove(get_absolute_path(TEST_DIRECTORY + "created.pmat"));
+	msys::notify_material_file_removed(TEST_DIRECTORY + "created.pmat");
+	MSYS_EXPECT(!manager.ResolveMaterialPath(TEST_DIRECTORY + "created")->exists);
+	std::filesystem::remove_all(get_absolute_path(TEST_DIRECTORY));
+}
+
+static void test_size_limit()
+{
+	MaterialManager manager {};
+	auto first = manager.ResolveMaterialPath(TEST_DIRECTORY + "0");
+	for(auto i = 1u; i <= MaterialManager::MAX_PATH_RESOLUTION_CACHE_SIZE; ++i)
+		manager.ResolveMaterialPath(TEST_DIRECTORY + std::to_string(i));
+	auto last = manager.ResolveMaterialPath(TEST_DIRECTORY + std::to_string(MaterialManager::MAX_PATH_RESOLUTION_CACHE_SIZE));
+	// The oldest name has been evicted, the newest one is still cached
+	MSYS_EXPECT(manager.ResolveMaterialPath(TEST_DIRECTORY + std::to_string(MaterialManager::MAX_PATH_RESOLUTION_CACHE_SIZE)) == last);
+	MSYS_EXPECT(manager.ResolveMaterialPath(TEST_DIRECTORY + "0") != first);
+}
+
+int main(int argc, char *argv[])
+{
+	test_directory_index_initialization();
+	test_invalidation();
+	test_size_limit();
+	return msys::test::get_exit_code();
+}
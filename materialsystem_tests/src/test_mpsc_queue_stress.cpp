@@ -0,0 +1,99 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+// Stress test for msys::MpscQueue, which is used to hand decoded textures from the load threads to the main thread.
+// Several producers push concurrently while a single consumer pops. Every item has to be popped exactly once, and the items
+// of each producer have to be popped in the order in which they were pushed.
+// The test doesn't rely on sleeps or timing, so it can also be run under ThreadSanitizer (-fsanitize=thread).
+
+#include "test_util.hpp"
+#include <texturemanager/mpsc_queue.hpp>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <cinttypes>
+
+static constexpr uint32_t NUM_PRODUCERS = 8;
+static constexpr uint32_t NUM_ITEMS_PER_PRODUCER = 200'000;
+
+struct Item {
+	uint32_t producer = 0;
+	uint32_t sequence = 0;
+};
+
+static void test_single_thread()
+{
+	msys::MpscQueue<uint32_t> queue {};
+	MSYS_EXPECT(queue.IsEmpty());
+	uint32_t item;
+	MSYS_EXPECT(!queue.Pop(item));
+	for(uint32_t i = 0; i < 16; ++i)
+		queue.Push(i);
+	MSYS_EXPECT(!queue.IsEmpty());
+	for(uint32_t i = 0; i < 16; ++i)
+		MSYS_EXPECT(queue.Pop(item) && item == i);
+	MSYS_EXPECT(queue.IsEmpty());
+	MSYS_EXPECT(!queue.Pop(item));
+
+	// Items that are still in the queue are released by the destructor
+	msys::MpscQueue<std::vector<uint32_t>> queueWithItems {};
+	queueWithItems.Push(std::vector<uint32_t>(64));
+}
+
+static void test_concurrent_producers()
+{
+	msys::MpscQueue<Item> queue {};
+	std::atomic<bool> start = false;
+	std::vector<std::thread> producers;
+	producers.reserve(NUM_PRODUCERS);
+	for(uint32_t producer = 0; producer < NUM_PRODUCERS; ++producer) {
+		producers.push_back(std::thread {[&queue, &start, producer]() {
+			// Start all producers at once to maximize contention
+			while(!start.load(std::memory_order_acquire))
+				std::this_thread::yield();
+			for(uint32_t i = 0; i < NUM_ITEMS_PER_PRODUCER; ++i)
+				queue.Push({producer, i});
+		}});
+	}
+	start.store(true, std::memory_order_release);
+
+	// Next expected sequence number per producer
+	std::vector<uint32_t> nextSequence(NUM_PRODUCERS, 0);
+	uint64_t numPopped = 0;
+	uint32_t numOutOfOrder = 0;
+	uint32_t numInvalid = 0;
+	constexpr auto numTotal = static_cast<uint64_t>(NUM_PRODUCERS) * NUM_ITEMS_PER_PRODUCER;
+	Item item;
+	while(numPopped < numTotal) {
+		if(!queue.Pop(item)) {
+			std::this_thread::yield();
+			continue;
+		}
+		++numPopped;
+		if(item.producer >= NUM_PRODUCERS) {
+			++numInvalid;
+			continue;
+		}
+		if(item.sequence != nextSequence[item.producer])
+			++numOutOfOrder;
+		nextSequence[item.producer] = item.sequence + 1;
+	}
+	for(auto &t : producers)
+		t.join();
+
+	MSYS_EXPECT(numInvalid == 0);
+	MSYS_EXPECT(numOutOfOrder == 0);
+	for(auto seq : nextSequence)
+		MSYS_EXPECT(seq == NUM_ITEMS_PER_PRODUCER);
+	// All producers have finished, so nothing else may be left in the queue
+	MSYS_EXPECT(queue.IsEmpty());
+	MSYS_EXPECT(!queue.Pop(item));
+}
+
+int main(int argc, char *argv[])
+{
+	test_single_thread();
+	test_concurrent_producers();
+	return msys::test::get_exit_code();
+}
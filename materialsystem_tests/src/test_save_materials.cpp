@@ -0,0 +1,83 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "test_util.hpp"
+#include <material_manager2.hpp>
+#include <material.h>
+#include <textureinfo.h>
+#include <datasystem.h>
+#include <fsys/filesystem.h>
+#include <fsys/ifile.hpp>
+#include <filesystem>
+#include <vector>
+#include <string>
+
+static const std::string TEST_DIRECTORY = "cache/tests/save_materials/";
+static constexpr uint32_t NUM_MATERIALS = 256;
+
+static std::string get_file_name(uint32_t i, const char *ext) { return TEST_DIRECTORY + "material_" + std::to_string(i) + '.' + ext; }
+
+static bool load_material_file(msys::MaterialManager &manager, const std::string &fileName, std::string &outShader, std::shared_ptr<ds::Block> &outData)
+{
+	auto f = filemanager::open_file(fileName, filemanager::FileMode::Read | filemanager::FileMode::Binary);
+	if(!f)
+		return false;
+	return msys::load_pmat_data(manager, std::make_unique<fsys::File>(f), outShader, outData);
+}
+
+static void test_save_many()
+{
+	std::filesystem::remove_all(FileManager::GetProgramPath() + '/' + TEST_DIRECTORY);
+	auto manager = msys::MaterialManager::Create();
+	// More threads than cores, to make concurrent saves likely
+	manager->SetWorkerThreadCount(16);
+
+	std::vector<std::shared_ptr<Material>> materials;
+	std::vector<Material *> ptrs;
+	std::vector<std::string> fileNames;
+	for(auto i = decltype(NUM_MATERIALS) {0u}; i < NUM_MATERIALS; ++i) {
+		auto dataSettings = manager->CreateDataSettings();
+		auto data = std::make_shared<ds::Block>(*dataSettings);
+		data->AddValue("int", "index", std::to_string(i));
+		data->AddData(Material::ALBEDO_MAP_IDENTIFIER, std::make_shared<ds::Texture>(*dataSettings, "tests/albedo_" + std::to_string(i)));
+		materials.push_back(manager->CreateMaterial("pbr", data));
+		ptrs.push_back(materials.back().get());
+		// Binary and text formats
+		fileNames.push_back(get_file_name(i, (i % 2 == 0) ? Material::FORMAT_MATERIAL_BINARY : Material::FORMAT_MATERIAL_ASCII));
+	}
+	// Invalid entries only fail themselves
+	ptrs.push_back(nullptr);
+	fileNames.push_back(TEST_DIRECTORY + "invalid.pmat");
+
+	std::vector<std::string> errors;
+	auto numSaved = manager->SaveMaterials(ptrs, fileNames, true, &errors);
+	MSYS_EXPECT(numSaved == NUM_MATERIALS);
+	MSYS_EXPECT(errors.size() == ptrs.size());
+	if(errors.size() != ptrs.size())
+		return;
+	for(auto i = decltype(NUM_MATERIALS) {0u}; i < NUM_MATERIALS; ++i)
+		MSYS_EXPECT(errors[i].empty());
+	MSYS_EXPECT(!errors.back().empty());
+
+	for(auto i = decltype(NUM_MATERIALS) {0u}; i < NUM_MATERIALS; ++i) {
+		std::string shader;
+		std::shared_ptr<ds::Block> data = nullptr;
+		MSYS_EXPECT(load_material_file(*manager, fileNames[i], shader, data));
+		if(!data)
+			continue;
+		MSYS_EXPECT(shader == "pbr");
+		int32_t index = -1;
+		MSYS_EXPECT(data->GetInt("index", &index) && index == static_cast<int32_t>(i));
+		auto &tex = data->GetValue(Material::ALBEDO_MAP_IDENTIFIER);
+		MSYS_EXPECT(tex != nullptr && static_cast<ds::Texture &>(*tex).GetString() == "tests/albedo_" + std::to_string(i));
+	}
+	MSYS_EXPECT(!FileManager::Exists(TEST_DIRECTORY + "invalid.pmat"));
+	std::filesystem::remove_all(FileManager::GetProgramPath() + '/' + TEST_DIRECTORY);
+}
+
+int main(int argc, char *argv[])
+{
+	test_save_many();
+	return msys::test::get_exit_code();
+}
@@ -0,0 +1,31 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef __MSYS_TEST_UTIL_HPP__
+#define __MSYS_TEST_UTIL_HPP__
+
+#include <iostream>
+#include <cstdlib>
+#include <cstdint>
+
+namespace msys::test {
+	inline uint32_t g_numFailures = 0;
+	inline void expect(bool condition, const char *expression, const char *file, int line)
+	{
+		if(condition)
+			return;
+		++g_numFailures;
+		std::cerr << file << ":" << line << ": Check failed: " << expression << std::endl;
+	}
+	inline int get_exit_code()
+	{
+		if(g_numFailures > 0)
+			std::cerr << g_numFailures << " check(s) failed!" << std::endl;
+		return (g_numFailures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+};
+
+#define MSYS_EXPECT(expr) msys::test::expect(static_cast<bool>(expr), #expr, __FILE__, __LINE__)
+
+#endif